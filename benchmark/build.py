@@ -29,6 +29,7 @@ benchmarks = [
     #"test_array_allocation.cpp",
     #"test_png_encoding1.cpp",
     #"test_png_encoding2.cpp",
+    "test_png_encoding3.cpp",
     #"test_to_string1.cpp",
     #"test_to_string2.cpp",
     #"test_to_bool.cpp",
@@ -39,6 +40,8 @@ benchmarks = [
     #"test_polygon_clipping_rendering.cpp",
     "test_proj_transform1.cpp",
     "test_expression_parse.cpp",
+    "test_expression_eval.cpp",
+    "test_symbolizer_properties.cpp",
     "test_face_ptr_creation.cpp",
     "test_font_registration.cpp",
     "test_rendering.cpp",
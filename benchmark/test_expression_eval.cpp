@@ -0,0 +1,101 @@
+#include "bench_framework.hpp"
+#include <mapnik/unicode.hpp>
+#include <mapnik/boolean.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/util/variant.hpp>
+
+#include <vector>
+
+// evaluates a set of rule-like filters against one feature, either by
+// visiting the expression tree or through compiled_expression
+class test : public benchmark::test_case
+{
+    mapnik::feature_ptr feature_;
+    mapnik::attributes vars_;
+    std::vector<mapnik::expression_ptr> exprs_;
+    std::vector<mapnik::compiled_expression> compiled_;
+    bool use_compiled_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       feature_(),
+       vars_(),
+       exprs_(),
+       compiled_(),
+       use_compiled_(*params.get<mapnik::boolean_type>("compiled",true))
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("class");
+        ctx->push("oneway");
+        ctx->push("layer");
+        ctx->push("name");
+        feature_ = mapnik::feature_factory::create(ctx,1);
+        mapnik::transcoder tr("utf-8");
+        feature_->put("class",tr.transcode("path"));
+        feature_->put("oneway",mapnik::value_integer(1));
+        feature_->put("layer",mapnik::value_integer(2));
+        feature_->put("name",tr.transcode("Main Street"));
+        for (std::size_t i = 0; i < 40; ++i)
+        {
+            std::string s = "([class]='class" + std::to_string(i) + "') and ([oneway]=1) and ([layer]+1>" + std::to_string(i % 4) + ")";
+            exprs_.push_back(mapnik::parse_expression(s));
+        }
+        exprs_.push_back(mapnik::parse_expression("((([mapnik::geometry_type]=2) and ([oneway]=1)) and ([class]='path'))"));
+        for (mapnik::expression_ptr const& expr : exprs_)
+        {
+            compiled_.emplace_back(expr);
+            compiled_.back().bind(ctx);
+        }
+    }
+    bool validate() const
+    {
+        for (std::size_t i = 0; i < exprs_.size(); ++i)
+        {
+            mapnik::value_type expected = mapnik::util::apply_visitor(
+                mapnik::evaluate<mapnik::feature_impl,mapnik::value_type,mapnik::attributes>(*feature_,vars_),*exprs_[i]);
+            mapnik::value_type result = compiled_[i].evaluate(*feature_,vars_);
+            if (expected != result)
+            {
+                std::clog << result << " != " << expected << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator()() const
+    {
+        std::size_t matches = 0;
+        for (std::size_t i=0;i<iterations_;++i)
+        {
+            if (use_compiled_)
+            {
+                for (mapnik::compiled_expression const& expr : compiled_)
+                {
+                    if (expr.evaluate(*feature_,vars_).to_bool()) ++matches;
+                }
+            }
+            else
+            {
+                for (mapnik::expression_ptr const& expr : exprs_)
+                {
+                    if (mapnik::util::apply_visitor(
+                            mapnik::evaluate<mapnik::feature_impl,mapnik::value_type,mapnik::attributes>(*feature_,vars_),*expr).to_bool()) ++matches;
+                }
+            }
+        }
+        return matches > 0;
+    }
+};
+
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    test test_runner(params);
+    return run(test_runner,*params.get<mapnik::boolean_type>("compiled",true) ? "expr eval (compiled)" : "expr eval (visitor)");
+}
@@ -0,0 +1,61 @@
+#include "bench_framework.hpp"
+#include "compare_images.hpp"
+#include <mapnik/value_types.hpp>
+#include <memory>
+#include <string>
+
+// encodes a 1024px true color image, optionally deflating row bands in
+// parallel (png32:p=N)
+class test : public benchmark::test_case
+{
+    std::shared_ptr<image_rgba8> im_;
+    std::string format_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       im_(),
+       format_("png32:z=9")
+    {
+        mapnik::value_integer encode_threads = *params.get<mapnik::value_integer>("encode_threads",4);
+        if (encode_threads > 1)
+        {
+            format_ += ":p=" + std::to_string(encode_threads);
+        }
+        std::string filename("./benchmark/data/multicolor.png");
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(filename,"png"));
+        if (!reader.get())
+        {
+            throw mapnik::image_reader_exception("Failed to load: " + filename);
+        }
+        image_rgba8 tile(reader->width(),reader->height());
+        reader->read(0,0,tile);
+        // repeat the sample image to metatile size
+        im_ = std::make_shared<image_rgba8>(1024,1024);
+        for (unsigned y = 0; y < im_->height(); ++y)
+        {
+            for (unsigned x = 0; x < im_->width(); ++x)
+            {
+                (*im_)(x,y) = tile(x % tile.width(), y % tile.height());
+            }
+        }
+    }
+    bool validate() const
+    {
+        std::string expected("./benchmark/data/multicolor-png32-expected.png");
+        std::string actual("./benchmark/data/multicolor-png32-actual.png");
+        mapnik::save_to_file(*im_,expected,"png32:z=9");
+        mapnik::save_to_file(*im_,actual,format_);
+        return benchmark::compare_images(actual,expected);
+    }
+    bool operator()() const
+    {
+        std::string out;
+        for (std::size_t i=0;i<iterations_;++i) {
+            out.clear();
+            out = mapnik::save_to_string(*im_,format_);
+        }
+        return true;
+    }
+};
+
+BENCHMARK(test,"encoding 1024px png32")
@@ -0,0 +1,63 @@
+#include "bench_framework.hpp"
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/expression.hpp>
+
+// looks up the properties agg_renderer reads for every feature of a
+// line layer: constants set in the style, defaults and one expression
+class test : public benchmark::test_case
+{
+    mapnik::feature_ptr feature_;
+    mapnik::attributes vars_;
+    mapnik::line_symbolizer sym_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       feature_(),
+       vars_(),
+       sym_()
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("width");
+        feature_ = mapnik::feature_factory::create(ctx,1);
+        feature_->put("width",mapnik::value_double(2.5));
+        mapnik::put(sym_, mapnik::keys::stroke, mapnik::color("steelblue"));
+        mapnik::put(sym_, mapnik::keys::stroke_width, mapnik::parse_expression("[width] * 2"));
+        mapnik::put(sym_, mapnik::keys::stroke_opacity, 0.8);
+        mapnik::put(sym_, mapnik::keys::stroke_linejoin, mapnik::ROUND_JOIN);
+        mapnik::put(sym_, mapnik::keys::stroke_linecap, mapnik::ROUND_CAP);
+        mapnik::put(sym_, mapnik::keys::smooth, 0.5);
+        mapnik::put(sym_, mapnik::keys::clip, false);
+        mapnik::put(sym_, mapnik::keys::comp_op, mapnik::multiply);
+    }
+    bool validate() const
+    {
+        return mapnik::get<mapnik::value_double, mapnik::keys::stroke_width>(sym_, *feature_, vars_) == 5.0 &&
+            mapnik::get<mapnik::line_join_enum, mapnik::keys::stroke_linejoin>(sym_, *feature_, vars_) == mapnik::ROUND_JOIN &&
+            mapnik::get<mapnik::value_double, mapnik::keys::offset>(sym_, *feature_, vars_) == 0.0;
+    }
+    bool operator()() const
+    {
+        double sum = 0;
+        for (std::size_t i=0;i<iterations_;++i)
+        {
+            sum += mapnik::get<mapnik::color, mapnik::keys::stroke>(sym_, *feature_, vars_).alpha();
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::stroke_gamma>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::gamma_method_enum, mapnik::keys::stroke_gamma_method>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::composite_mode_e, mapnik::keys::comp_op>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_bool, mapnik::keys::clip>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::stroke_width>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::stroke_opacity>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::offset>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::simplify_tolerance>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::value_double, mapnik::keys::smooth>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::line_rasterizer_enum, mapnik::keys::line_rasterizer>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::line_join_enum, mapnik::keys::stroke_linejoin>(sym_, *feature_, vars_);
+            sum += mapnik::get<mapnik::line_cap_enum, mapnik::keys::stroke_linecap>(sym_, *feature_, vars_);
+        }
+        return sum > 0;
+    }
+};
+
+BENCHMARK(test,"line symbolizer properties")
@@ -247,6 +247,17 @@ void export_layer()
                       ">>> lyr.cache_features = True # set to True to enable feature caching\n"
             )
 
+        .add_property("shared_feature_cache",
+                      &layer::shared_feature_cache,
+                      &layer::set_shared_feature_cache,
+                      "Get/Set whether features are kept in the feature cache shared across renders\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> lyr.shared_feature_cache\n"
+                      "False # False by default\n"
+                      ">>> lyr.shared_feature_cache = True # set to True to reuse features of neighbouring tiles\n"
+            )
+
         .add_property("datasource",
                       &layer::datasource,
                       &layer::set_datasource,
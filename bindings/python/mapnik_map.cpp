@@ -469,6 +469,42 @@ void export_map()
                       "2\n"
             )
 
+        .add_property("query_threads",
+                      &Map::query_threads,
+                      &Map::set_query_threads,
+                      "Get/Set the number of threads used to query layer\n"
+                      "datasources concurrently before rendering.\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> m.query_threads\n"
+                      "0 # serial by default\n"
+                      ">>> m.query_threads = 4\n"
+            )
+
+        .add_property("filter_threads",
+                      &Map::filter_threads,
+                      &Map::set_filter_threads,
+                      "Get/Set the number of threads used to apply\n"
+                      "style image filters.\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> m.filter_threads\n"
+                      "0 # serial by default\n"
+                      ">>> m.filter_threads = 4\n"
+            )
+
+        .add_property("warp_threads",
+                      &Map::warp_threads,
+                      &Map::set_warp_threads,
+                      "Get/Set the number of threads used to reproject\n"
+                      "rasters into the map projection.\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> m.warp_threads\n"
+                      "0 # serial by default\n"
+                      ">>> m.warp_threads = 4\n"
+            )
+
         .add_property("height",
                       &Map::height,
                       &Map::set_height,
@@ -40,6 +40,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid.hpp>
 #include <mapnik/grid/grid_util.hpp>
+#include <mapnik/grid/grid_utf.hpp>
 #include <mapnik/grid/grid_view.hpp>
 #include <mapnik/value_error.hpp>
 #include <mapnik/feature.hpp>
@@ -57,61 +58,7 @@ void grid2utf(T const& grid_type,
                      boost::python::list& l,
                      std::vector<typename T::lookup_type>& key_order)
 {
-    using keys_type = std::map< typename T::lookup_type, typename T::value_type>;
-    using keys_iterator = typename keys_type::iterator;
-
-    typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::feature_key_type::const_iterator feature_pos;
-
-    keys_type keys;
-    // start counting at utf8 codepoint 32, aka space character
-    std::uint16_t codepoint = 32;
-
-    unsigned array_size = data.width();
-    for (unsigned y = 0; y < data.height(); ++y)
-    {
-        std::uint16_t idx = 0;
-        const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
-        typename T::value_type const* row = data.getRow(y);
-        for (unsigned x = 0; x < data.width(); ++x)
-        {
-            typename T::value_type feature_id = row[x];
-            feature_pos = feature_keys.find(feature_id);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                keys_iterator key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    if (feature_id == mapnik::grid::base_mask)
-                    {
-                        keys[""] = codepoint;
-                        key_order.push_back("");
-                    }
-                    else
-                    {
-                        keys[val] = codepoint;
-                        key_order.push_back(val);
-                    }
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
-        }
-        l.append(boost::python::object(
-                     boost::python::handle<>(
-                         PyUnicode_FromUnicode(line.get(), array_size))));
-    }
+    mapnik::grid2utf<T>(grid_type,l,key_order,1);
 }
 
 
@@ -121,60 +68,23 @@ void grid2utf(T const& grid_type,
                      std::vector<typename T::lookup_type>& key_order,
                      unsigned int resolution)
 {
-    using keys_type = std::map< typename T::lookup_type, typename T::value_type>;
-    using keys_iterator = typename keys_type::iterator;
-
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::feature_key_type::const_iterator feature_pos;
-
-    keys_type keys;
-    // start counting at utf8 codepoint 32, aka space character
-    std::uint16_t codepoint = 32;
+    mapnik::utf_grid utf;
+    mapnik::grid2utf(grid_type,utf,resolution);
 
-    unsigned array_size = std::ceil(grid_type.width()/static_cast<float>(resolution));
-    for (unsigned y = 0; y < grid_type.height(); y=y+resolution)
+    unsigned array_size = utf.width;
+    const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
+    std::uint16_t const* codes = utf.codes.data();
+    for (unsigned y = 0; y < utf.height; ++y)
     {
-        std::uint16_t idx = 0;
-        const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
-        mapnik::grid::value_type const* row = grid_type.getRow(y);
-        for (unsigned x = 0; x < grid_type.width(); x=x+resolution)
+        for (unsigned x = 0; x < array_size; ++x)
         {
-            typename T::value_type feature_id = row[x];
-            feature_pos = feature_keys.find(feature_id);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                keys_iterator key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    if (feature_id == mapnik::grid::base_mask)
-                    {
-                        keys[""] = codepoint;
-                        key_order.push_back("");
-                    }
-                    else
-                    {
-                        keys[val] = codepoint;
-                        key_order.push_back(val);
-                    }
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
+            line[x] = static_cast<Py_UNICODE>(*codes++);
         }
         l.append(boost::python::object(
                      boost::python::handle<>(
                          PyUnicode_FromUnicode(line.get(), array_size))));
     }
+    key_order.insert(key_order.end(), utf.keys.begin(), utf.keys.end());
 }
 
 
@@ -265,18 +175,20 @@ void write_features(T const& grid_type,
 
         bool found = false;
         boost::python::dict feat;
-        mapnik::feature_ptr feature = feat_itr->second;
+        mapnik::grid_feature const& feature = feat_itr->second;
+        std::size_t index = 0;
         for ( std::string const& attr : attributes )
         {
             if (attr == "__id__")
             {
-                feat[attr.c_str()] = feature->id();
+                feat[attr.c_str()] = feature.id;
             }
-            else if (feature->has_key(attr))
+            else if (index < feature.has.size() && feature.has[index])
             {
                 found = true;
-                feat[attr.c_str()] = feature->get(attr);
+                feat[attr.c_str()] = feature.values[index];
             }
+            ++index;
         }
 
         if (found)
@@ -167,6 +167,7 @@ private:
     const std::unique_ptr<rasterizer> ras_ptr;
     gamma_method_enum gamma_method_;
     double gamma_;
+    unsigned filter_threads_;
     renderer_common common_;
     void setup(Map const& m);
 };
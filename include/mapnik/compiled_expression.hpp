@@ -0,0 +1,125 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_COMPILED_EXPRESSION_HPP
+#define MAPNIK_COMPILED_EXPRESSION_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Flattened form of an expression tree for repeated evaluation.
+//
+// Nodes are stored in postfix order in a single vector, constant
+// sub-expressions are folded at construction time and `and`/`or`
+// short-circuit explicitly. Attribute names are resolved to column
+// indices of a feature context via bind(); names missing from the
+// bound context fall back to a lookup by name so results are always
+// identical to the `evaluate` visitor.
+class MAPNIK_DECL compiled_expression
+{
+public:
+    enum class opcode : std::uint8_t
+    {
+        constant,
+        attribute,
+        global_attribute,
+        geometry_type,
+        negate,
+        plus,
+        minus,
+        mult,
+        div,
+        mod,
+        less,
+        less_equal,
+        greater,
+        greater_equal,
+        equal_to,
+        not_equal_to,
+        logical_not,
+        logical_and,
+        logical_or,
+        regex_match,
+        regex_replace,
+        unary_call,
+        binary_call
+    };
+
+    struct instruction
+    {
+        opcode op;
+        // child instructions for operators and calls,
+        // table index for constants and attributes
+        std::size_t arg0;
+        std::size_t arg1;
+        // table index of regex and function call nodes
+        std::size_t aux;
+    };
+
+    explicit compiled_expression(expression_ptr const& expr);
+
+    // Resolve attribute names against `ctx`, no-op if already bound to it.
+    void bind(context_ptr const& ctx);
+
+    value_type evaluate(feature_impl const& feature, attributes const& vars) const;
+
+    std::vector<instruction> const& code() const
+    {
+        return code_;
+    }
+
+private:
+    friend struct compile_expression;
+
+    value_type eval(std::size_t pc, feature_impl const& feature, attributes const& vars) const;
+    value_type const& operand(std::size_t pc, feature_impl const& feature,
+                              attributes const& vars, value_type & tmp) const;
+
+    expression_ptr expr_; // keeps regex and function call nodes alive
+    std::vector<instruction> code_;
+    std::vector<value_type> constants_;
+    std::vector<std::string> names_;
+    std::vector<std::size_t> columns_;
+    std::vector<std::string> globals_;
+    std::vector<regex_match_node const*> regex_match_;
+    std::vector<regex_replace_node const*> regex_replace_;
+    std::vector<unary_function_call const*> unary_calls_;
+    std::vector<binary_function_call const*> binary_calls_;
+    context_ptr ctx_;
+};
+
+}
+
+#endif // MAPNIK_COMPILED_EXPRESSION_HPP
@@ -120,6 +120,13 @@ public:
     virtual box2d<double> envelope() const = 0;
     virtual boost::optional<geometry_t> get_geometry_type() const = 0;
     virtual layer_descriptor get_descriptor() const = 0;
+    /*!
+     * @brief Whether features keep the same id in every query
+     *
+     * Datasources numbering features per query return false, which keeps
+     * their features out of caches that tell features apart by id.
+     */
+    virtual bool has_stable_ids() const { return false; }
     virtual ~datasource() {}
 protected:
     parameters params_;
@@ -78,6 +78,7 @@ public:
     }
 
     inline size_type size() const { return mapping_.size(); }
+    inline const_iterator find(key_type const& name) const { return mapping_.find(name);}
     inline const_iterator begin() const { return mapping_.begin();}
     inline const_iterator end() const { return mapping_.end();}
 
@@ -189,7 +190,7 @@ public:
         data_ = data;
     }
 
-    inline context_ptr context() const
+    inline context_ptr const& context() const
     {
         return ctx_;
     }
@@ -0,0 +1,135 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_FEATURE_CACHE_HPP
+#define MAPNIK_FEATURE_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/featureset.hpp>
+#include <mapnik/feature_style_processor_context.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+class datasource;
+class query;
+
+// decoded features of one cell with their envelopes
+using feature_cell = std::vector<std::pair<feature_ptr, box2d<double> > >;
+using feature_cell_ptr = std::shared_ptr<feature_cell const>;
+
+struct feature_cache_key
+{
+    // parameters of the datasource
+    std::string datasource;
+    // zoom band and the parts of the query other than its extent
+    std::string query;
+    // cell of the grid laid over the zoom band
+    std::int64_t x;
+    std::int64_t y;
+
+    bool operator==(feature_cache_key const& rhs) const
+    {
+        return x == rhs.x && y == rhs.y &&
+            query == rhs.query &&
+            datasource == rhs.datasource;
+    }
+};
+
+struct feature_cache_key_hash
+{
+    std::size_t operator()(feature_cache_key const& key) const;
+};
+
+// Process wide LRU cache of features returned by vector datasources, shared
+// by all renders so neighbouring tiles and metatiles of one zoom level don't
+// query and decode the same features again. Queries are answered from cells
+// of a grid of cell_size() pixels at the query resolution; each cell holds
+// the features whose envelope intersects it. The cells a query misses are
+// fetched together with one datasource query over their extent. Datasources are identified by their parameters, so only those
+// created through the datasource_cache (with a "type" parameter) are cached,
+// and never memory datasources. A feature returned by several cells is told
+// apart by its id and envelope, so only datasources declaring stable ids
+// (e.g. postgis with a key_field) are cached.
+// The capacity is a budget in bytes of decoded features.
+class MAPNIK_DECL feature_cache :
+        public singleton<feature_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<feature_cache>;
+public:
+    // features of ds for q assembled from cached cells, querying ds for
+    // missing cells; empty when the query can't be answered from the cache
+    featureset_ptr features(datasource const& ds, query const& q,
+                            processor_context_ptr const& ctx = processor_context_ptr());
+    // drop the cells of a datasource whose data changed, all of them or
+    // those intersecting an extent in the datasource projection
+    void invalidate(datasource const& ds);
+    void invalidate(datasource const& ds, box2d<double> const& extent);
+    void clear();
+    // number of cached cells
+    std::size_t size() const;
+    // bytes of cached features
+    std::size_t memory_usage() const;
+    // maximum bytes of cached features, 0 disables the cache
+    void set_capacity(std::size_t capacity);
+    std::size_t capacity() const;
+    // width and height of cells in pixels
+    void set_cell_size(unsigned cell_size);
+    unsigned cell_size() const;
+    // cells found in and missing from the cache since the last reset
+    std::size_t hits() const;
+    std::size_t misses() const;
+    void reset_stats();
+private:
+    feature_cache();
+    // cell and its extent, cost is its size in bytes
+    util::lru_cache<feature_cache_key, std::pair<feature_cell_ptr, box2d<double> >, feature_cache_key_hash> cells_;
+    unsigned cell_size_;
+#ifdef MAPNIK_THREADSAFE
+    // guards cell_size_
+    mutable std::mutex mutex_;
+#endif
+};
+
+}
+
+#endif // MAPNIK_FEATURE_CACHE_HPP
@@ -37,6 +37,7 @@ namespace mapnik
 {
 
 class Map;
+class request;
 class layer;
 class projection;
 class proj_transform;
@@ -62,6 +63,12 @@ public:
      */
     void apply(double scale_denom_override=0.0);
 
+    /*!
+     * \brief apply renderer to all map layers for the dimensions, extent
+     *  and buffer of a request instead of those of the map.
+     */
+    void apply(request const& req, double scale_denom_override=0.0);
+
     /*!
      * \brief apply renderer to a single layer, providing pre-populated set of query attribute names.
      */
@@ -84,6 +91,19 @@ public:
                         std::set<std::string>& names);
 
 private:
+    /*!
+     * \brief query and render all visible layers, in parallel when the map
+     *  sets query threads.
+     */
+    void apply_to_layers(Processor & p,
+                         projection const& proj,
+                         double scale,
+                         double scale_denom,
+                         unsigned width,
+                         unsigned height,
+                         box2d<double> const& extent,
+                         int buffer_size);
+
     /*!
      * \brief renders a featureset with the given styles.
      */
@@ -107,6 +127,11 @@ private:
                        int buffer_size,
                        std::set<std::string>& names);
 
+    /*!
+     * \brief pull all features of prepared featuresets into memory.
+     */
+    void fetch_material(layer_rendering_material & mat);
+
     /*!
      * \brief render features list queued when they are available.
      */
@@ -39,14 +39,19 @@
 #include <mapnik/rule_cache.hpp>
 #include <mapnik/attribute_collector.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
 #include <mapnik/scale_denominator.hpp>
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/request.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/util/parallel_for.hpp>
 #include <mapnik/util/variant.hpp>
 #include <mapnik/symbolizer_dispatch.hpp>
 
 // stl
+#include <deque>
 #include <vector>
 #include <stdexcept>
 
@@ -96,6 +101,51 @@ void feature_style_processor<Processor>::apply(double scale_denom)
         scale_denom = mapnik::scale_denominator(m_.scale(),proj.is_geographic());
     scale_denom *= p.scale_factor(); // FIXME - we might want to comment this out
 
+    apply_to_layers(p,
+                    proj,
+                    m_.scale(),
+                    scale_denom,
+                    m_.width(),
+                    m_.height(),
+                    m_.get_current_extent(),
+                    m_.buffer_size());
+
+    p.end_map_processing(m_);
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::apply(request const& req, double scale_denom)
+{
+    Processor & p = static_cast<Processor&>(*this);
+    p.start_map_processing(m_);
+
+    projection proj(m_.srs(),true);
+    if (scale_denom <= 0.0)
+        scale_denom = mapnik::scale_denominator(req.scale(),proj.is_geographic());
+    scale_denom *= p.scale_factor();
+
+    apply_to_layers(p,
+                    proj,
+                    req.scale(),
+                    scale_denom,
+                    req.width(),
+                    req.height(),
+                    req.extent(),
+                    req.buffer_size());
+
+    p.end_map_processing(m_);
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::apply_to_layers(Processor & p,
+                                                         projection const& proj,
+                                                         double scale,
+                                                         double scale_denom,
+                                                         unsigned width,
+                                                         unsigned height,
+                                                         box2d<double> const& extent,
+                                                         int buffer_size)
+{
     // Asynchronous query supports:
     // This is a two steps process,
     // first we setup all queries at layer level
@@ -103,36 +153,91 @@ void feature_style_processor<Processor>::apply(double scale_denom)
     // do the actual rendering
 
     std::vector<layer_rendering_material_ptr> mat_list;
+    // per layer copies of the map projection for parallel queries,
+    // referenced by the materials until they are rendered
+    std::deque<projection> projs;
 
-    // Define processing context map used by datasources
-    // implementing asynchronous queries
-    feature_style_context_map ctx_map;
-
-    for ( layer const& lyr : m_.layers() )
+    unsigned query_threads = m_.query_threads();
+    if (query_threads > 1)
     {
-        if (lyr.visible(scale_denom))
+        // Parallel query mode: datasource queries and feature fetching for
+        // all visible layers run concurrently on a bounded set of workers,
+        // rendering below still happens in layer order.
+        // projections hold a proj context that can't be shared between
+        // threads, so each task transforms through its own copy of the
+        // map projection, initialized lazily on its worker
+        std::vector<layer_rendering_material_ptr> pending;
+        for ( layer const& lyr : m_.layers() )
         {
-            std::set<std::string> names;
-            layer_rendering_material_ptr mat = std::make_shared<layer_rendering_material>(lyr, proj);
+            if (lyr.visible(scale_denom))
+            {
+                projs.emplace_back(m_.srs(), true);
+                pending.push_back(std::make_shared<layer_rendering_material>(lyr, projs.back()));
+            }
+        }
 
-            prepare_layer(*mat,
+        util::parallel_for(pending.size(), query_threads, [&](std::size_t i)
+        {
+            // processing contexts are not thread safe so each task gets its own
+            feature_style_context_map ctx_map;
+            std::set<std::string> names;
+            layer_rendering_material & mat = *pending[i];
+            prepare_layer(mat,
                           ctx_map,
                           p,
-                          m_.scale(),
+                          scale,
                           scale_denom,
-                          m_.width(),
-                          m_.height(),
-                          m_.get_current_extent(),
-                          m_.buffer_size(),
+                          width,
+                          height,
+                          extent,
+                          buffer_size,
                           names);
+            if (!mat.active_styles_.empty())
+            {
+                fetch_material(mat);
+            }
+        });
 
-            // Store active material
+        for ( layer_rendering_material_ptr const& mat : pending )
+        {
             if (!mat->active_styles_.empty())
             {
                 mat_list.push_back(mat);
             }
         }
     }
+    else
+    {
+        // Define processing context map used by datasources
+        // implementing asynchronous queries
+        feature_style_context_map ctx_map;
+
+        for ( layer const& lyr : m_.layers() )
+        {
+            if (lyr.visible(scale_denom))
+            {
+                std::set<std::string> names;
+                layer_rendering_material_ptr mat = std::make_shared<layer_rendering_material>(lyr, proj);
+
+                prepare_layer(*mat,
+                              ctx_map,
+                              p,
+                              scale,
+                              scale_denom,
+                              width,
+                              height,
+                              extent,
+                              buffer_size,
+                              names);
+
+                // Store active material
+                if (!mat->active_styles_.empty())
+                {
+                    mat_list.push_back(mat);
+                }
+            }
+        }
+    }
 
     for ( layer_rendering_material_ptr mat : mat_list )
     {
@@ -141,8 +246,6 @@ void feature_style_processor<Processor>::apply(double scale_denom)
             render_material(*mat,p);
         }
     }
-
-    p.end_map_processing(m_);
 }
 
 template <typename Processor>
@@ -427,20 +530,50 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
 
     bool cache_features = lay.cache_features() && active_styles.size() > 1;
 
+    // layers using the shared feature cache are answered from cells kept
+    // across renders, unless the query can't be cached
+    auto query_features = [&]() -> featureset_ptr
+    {
+        if (lay.shared_feature_cache())
+        {
+            featureset_ptr features = feature_cache::instance().features(*ds, q, current_ctx);
+            if (features) return features;
+        }
+        return ds->features_with_context(q,current_ctx);
+    };
+
     std::vector<featureset_ptr> & featureset_ptr_list = mat.featureset_ptr_list_;
     if (!group_by.empty() || cache_features)
     {
-        featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
+        featureset_ptr_list.push_back(query_features());
     }
     else
     {
         for(std::size_t i = 0; i < active_styles.size(); ++i)
         {
-            featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
+            featureset_ptr_list.push_back(query_features());
         }
     }
 }
 
+template <typename Processor>
+void feature_style_processor<Processor>::fetch_material(layer_rendering_material & mat)
+{
+    for (featureset_ptr & features : mat.featureset_ptr_list_)
+    {
+        if (features)
+        {
+            std::shared_ptr<featureset_buffer> buffer = std::make_shared<featureset_buffer>();
+            feature_ptr feature;
+            while ((feature = features->next()))
+            {
+                buffer->push(feature);
+            }
+            buffer->prepare();
+            features = buffer;
+        }
+    }
+}
 
 template <typename Processor>
 void feature_style_processor<Processor>::render_material(layer_rendering_material & mat,
@@ -573,16 +706,26 @@ void feature_style_processor<Processor>::render_style(
         return;
     }
     mapnik::attributes vars = p.variables();
+    // compile rule filters once per style pass, attribute lookups
+    // are resolved against the context of the features being rendered
+    std::vector<compiled_expression> filters;
+    filters.reserve(rc.get_if_rules().size());
+    for (rule const* r : rc.get_if_rules())
+    {
+        filters.emplace_back(r->get_filter());
+    }
     feature_ptr feature;
     bool was_painted = false;
     while ((feature = features->next()))
     {
         bool do_else = true;
         bool do_also = false;
+        std::size_t index = 0;
         for (rule const* r : rc.get_if_rules() )
         {
-            expression_ptr const& expr = r->get_filter();
-            value_type result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*feature,vars),*expr);
+            compiled_expression & filter = filters[index++];
+            filter.bind(feature->context());
+            value_type result = filter.evaluate(*feature,vars);
             if (result.to_bool())
             {
                 was_painted = true;
@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/vertex_vector.hpp>
+#include <mapnik/vertex_array.hpp>
 #include <mapnik/box2d.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
@@ -85,6 +86,12 @@ public:
     {
         return cont_.size();
     }
+
+    void reserve(size_type size)
+    {
+        cont_.reserve(size);
+    }
+
     void push_vertex(coord_type x, coord_type y, CommandType c)
     {
         cont_.push_back(x,y,c);
@@ -177,7 +184,7 @@ box2d<double> envelope(Geometry const& geom)
     return va.envelope();
 }
 
-using geometry_type = geometry<double,vertex_vector>;
+using geometry_type = geometry<double,vertex_array>;
 using vertex_adapter = detail::vertex_adapter<geometry_type>;
 
 }
@@ -31,7 +31,6 @@
 #include <mapnik/global.hpp>
 #include <mapnik/value.hpp>
 #include <mapnik/feature.hpp>
-#include <mapnik/feature_factory.hpp>
 #include <mapnik/util/conversions.hpp>
 
 // stl
@@ -53,7 +52,7 @@ public:
     using lookup_type = std::string;
     // mapping between pixel id and key
     using feature_key_type = std::map<value_type, lookup_type>;
-    using feature_type = std::map<lookup_type, mapnik::feature_ptr>;
+    using feature_type = std::map<lookup_type, grid_feature>;
     static const value_type base_mask;
 
 private:
@@ -66,7 +65,6 @@ private:
     std::set<std::string> names_;
     feature_key_type f_keys_;
     feature_type features_;
-    mapnik::context_ptr ctx_;
 
 public:
 
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GRID_UTF_HPP
+#define MAPNIK_GRID_UTF_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapnik {
+
+// UTFGrid of a hit grid: one codepoint per sampled pixel, row major, and
+// the feature keys in codepoint order. Codepoints start at 32 and skip
+// '"' and '\', the key of empty pixels is "".
+struct utf_grid
+{
+    unsigned width = 0;
+    unsigned height = 0;
+    std::vector<std::uint16_t> codes;
+    std::vector<std::string> keys;
+};
+
+// Encode every resolution-th pixel of each resolution-th row of a grid
+template <typename T>
+MAPNIK_DECL void grid2utf(T const& grid, utf_grid & utf, unsigned resolution = 1);
+
+// Append the UTFGrid JSON of a grid to json, as
+// {"grid":[rows],"keys":[keys],"data":{key:{field:value}}}.
+// The data of features holds the grid fields they have, when
+// add_features is set. Reusing a reserved string avoids allocations.
+template <typename T>
+MAPNIK_DECL void grid_encode_utf(T const& grid, std::string & json,
+                                 bool add_features = true, unsigned resolution = 1);
+
+}
+
+#endif // MAPNIK_GRID_UTF_HPP
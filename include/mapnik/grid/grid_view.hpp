@@ -39,6 +39,16 @@
 
 namespace mapnik {
 
+// attributes of a feature kept by a hit grid, in the order of the grid
+// fields when the feature was added; has[i] is false for fields missing
+// from the feature
+struct grid_feature
+{
+    value_integer id;
+    std::vector<value> values;
+    std::vector<bool> has;
+};
+
 template <typename T>
 class hit_grid_view
 {
@@ -48,7 +58,7 @@ public:
     using pixel_type = typename T::pixel_type;
     using lookup_type = std::string;
     using feature_key_type = std::map<value_type, lookup_type>;
-    using feature_type = std::map<std::string, mapnik::feature_ptr>;
+    using feature_type = std::map<std::string, grid_feature>;
 
     hit_grid_view(unsigned x, unsigned y,
                   unsigned width, unsigned height,
@@ -138,6 +138,66 @@ class hextree : private util::noncopyable
         return 255 * std::pow(b/255, g);
     }
 
+    // index of the closest color in sorted_pal_
+    unsigned find_nearest(unsigned val, byte a) const
+    {
+        rgba c(val);
+        int dr, dg, db, da;
+        int dist, newdist;
+
+        // find closest match based on mean of r,g,b,a
+        std::vector<rgba>::const_iterator pit =
+            std::lower_bound(sorted_pal_.begin(),sorted_pal_.end(), c, rgba::mean_sort_cmp());
+        unsigned ind = pit-sorted_pal_.begin();
+        if (ind == sorted_pal_.size())
+            ind--;
+        dr = sorted_pal_[ind].r - c.r;
+        dg = sorted_pal_[ind].g - c.g;
+        db = sorted_pal_[ind].b - c.b;
+        da = sorted_pal_[ind].a - a;
+        dist = dr*dr + dg*dg + db*db + da*da;
+        int poz = ind;
+
+        // search neighbour positions in both directions for better match
+        for (int i = poz - 1; i >= 0; i--)
+        {
+            dr = sorted_pal_[i].r - c.r;
+            dg = sorted_pal_[i].g - c.g;
+            db = sorted_pal_[i].b - c.b;
+            da = sorted_pal_[i].a - a;
+            // stop criteria based on properties of used sorting
+            if (((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist))
+            {
+                break;
+            }
+            newdist = dr*dr + dg*dg + db*db + da*da;
+            if (newdist < dist)
+            {
+                ind = i;
+                dist = newdist;
+            }
+        }
+        for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
+        {
+            dr = sorted_pal_[i].r - c.r;
+            dg = sorted_pal_[i].g - c.g;
+            db = sorted_pal_[i].b - c.b;
+            da = sorted_pal_[i].a - a;
+            // stop criteria based on properties of used sorting
+            if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
+            {
+                break;
+            }
+            newdist = dr*dr + dg*dg + db*db + da*da;
+            if (newdist < dist)
+            {
+                ind = i;
+                dist = newdist;
+            }
+        }
+        return ind;
+    }
+
 public:
     explicit hextree(unsigned max_colors=256, double g=2.0)
         : max_colors_(max_colors),
@@ -239,7 +299,6 @@ public:
     int quantize(unsigned val) const
     {
         byte a = preprocessAlpha(U2ALPHA(val));
-        unsigned ind=0;
         if (a < InsertPolicy::MIN_ALPHA || colors_ == 0)
         {
             return 0;
@@ -249,63 +308,11 @@ public:
             return pal_remap_[has_holes_?1:0];
         }
 
+        unsigned ind;
         rgba_hash_table::iterator it = color_hashmap_.find(val);
         if (it == color_hashmap_.end())
         {
-            rgba c(val);
-            int dr, dg, db, da;
-            int dist, newdist;
-
-            // find closest match based on mean of r,g,b,a
-            std::vector<rgba>::const_iterator pit =
-                std::lower_bound(sorted_pal_.begin(),sorted_pal_.end(), c, rgba::mean_sort_cmp());
-            ind = pit-sorted_pal_.begin();
-            if (ind == sorted_pal_.size())
-                ind--;
-            dr = sorted_pal_[ind].r - c.r;
-            dg = sorted_pal_[ind].g - c.g;
-            db = sorted_pal_[ind].b - c.b;
-            da = sorted_pal_[ind].a - a;
-            dist = dr*dr + dg*dg + db*db + da*da;
-            int poz = ind;
-
-            // search neighbour positions in both directions for better match
-            for (int i = poz - 1; i >= 0; i--)
-            {
-                dr = sorted_pal_[i].r - c.r;
-                dg = sorted_pal_[i].g - c.g;
-                db = sorted_pal_[i].b - c.b;
-                da = sorted_pal_[i].a - a;
-                // stop criteria based on properties of used sorting
-                if (((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist))
-                {
-                    break;
-                }
-                newdist = dr*dr + dg*dg + db*db + da*da;
-                if (newdist < dist)
-                {
-                    ind = i;
-                    dist = newdist;
-                }
-            }
-            for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
-            {
-                dr = sorted_pal_[i].r - c.r;
-                dg = sorted_pal_[i].g - c.g;
-                db = sorted_pal_[i].b - c.b;
-                da = sorted_pal_[i].a - a;
-                // stop criteria based on properties of used sorting
-                if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
-                {
-                    break;
-                }
-                newdist = dr*dr + dg*dg + db*db + da*da;
-                if (newdist < dist)
-                {
-                    ind = i;
-                    dist = newdist;
-                }
-            }
+            ind = find_nearest(val, a);
             //put found index in hash map
             color_hashmap_[val] = ind;
         }
@@ -317,6 +324,22 @@ public:
         return pal_remap_[ind];
     }
 
+    // same as quantize() but without the color cache, so it
+    // can be called from several threads at once
+    int quantize_uncached(unsigned val) const
+    {
+        byte a = preprocessAlpha(U2ALPHA(val));
+        if (a < InsertPolicy::MIN_ALPHA || colors_ == 0)
+        {
+            return 0;
+        }
+        if (colors_ == 1)
+        {
+            return pal_remap_[has_holes_?1:0];
+        }
+        return pal_remap_[find_nearest(val, a)];
+    }
+
     void create_palette(std::vector<rgba> & palette)
     {
         sorted_pal_.clear();
@@ -27,6 +27,7 @@
 //mapnik
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/util/hsl.hpp>
+#include <mapnik/util/parallel_for.hpp>
 
 // boost GIL
 #pragma GCC diagnostic push
@@ -45,6 +46,10 @@
 #include "agg_gradient_lut.h"
 // stl
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <functional>
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -128,282 +133,181 @@ static const float emboss_matrix[] = {-2,-1,0,-1,1,1,0,1,2};
 static const float sharpen_matrix[] = {0,-1,0,-1,5,-1,0,-1,0 };
 static const float edge_detect_matrix[] = {0,1,0,1,-4,1,0,1,0 };
 
-}
-
-using boost::gil::rgba8_image_t;
-using boost::gil::rgba8_view_t;
-
-template <typename Image>
-boost::gil::rgba8_view_t rgba8_view(Image & img)
+// Calls func(begin, end) for consecutive bands of [0, size). With more
+// than one thread the range is cut into a few bands per thread so that
+// uneven rows (e.g. mostly transparent ones) balance out.
+template <typename F>
+void for_each_band(std::size_t size, unsigned threads, F && func)
 {
-    using boost::gil::interleaved_view;
-    using boost::gil::rgba8_pixel_t;
-    return interleaved_view(img.width(), img.height(),
-                            reinterpret_cast<rgba8_pixel_t*>(img.getBytes()),
-                            img.width() * sizeof(rgba8_pixel_t));
-}
-
-template <typename Image>
-struct double_buffer
-{
-    boost::gil::rgba8_image_t   dst_buffer;
-    boost::gil::rgba8_view_t    dst_view;
-    boost::gil::rgba8_view_t    src_view;
-
-    explicit double_buffer(Image & src)
-        : dst_buffer(src.width(), src.height())
-        , dst_view(view(dst_buffer))
-        , src_view(rgba8_view(src)) {}
-
-    ~double_buffer()
+    if (size == 0) return;
+    std::size_t bands = 1;
+    if (threads > 1)
     {
-        copy_pixels(dst_view, src_view);
+        bands = std::min(size, static_cast<std::size_t>(threads) * 4);
     }
-};
-
-template <typename Src, typename Dst, typename Conv>
-void process_channel_impl (Src const& src, Dst & dst, Conv const& k)
-{
-    using boost::gil::bits32f;
-
-    bits32f out_value =
-        k[0]*src[0] + k[1]*src[1] + k[2]*src[2] +
-        k[3]*src[3] + k[4]*src[4] + k[5]*src[5] +
-        k[6]*src[6] + k[7]*src[7] + k[8]*src[8]
-        ;
-    if (out_value < 0) out_value = 0;
-    if (out_value > 255) out_value = 255;
-    dst = out_value;
-}
-
-template <typename Src, typename Dst, typename Conv>
-void process_channel (Src const&, Dst &, Conv const&)
-{
+    util::parallel_for(bands, threads, [&](std::size_t i)
+    {
+        func(size * i / bands, size * (i + 1) / bands);
+    });
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::blur)
+template <typename Src>
+std::uint8_t * row_bytes(Src & src, std::size_t y)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::blur_matrix);
+    return src.getBytes() + y * src.getRowSize();
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::emboss)
+// 3x3 neighbourhood of one demultiplied row. Rows above the first and below
+// the last are mirrored, columns outside the image repeat the border column.
+struct neighbourhood
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::emboss_matrix);
-}
+    std::uint8_t const* above;
+    std::uint8_t const* row;
+    std::uint8_t const* below;
+};
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::sharpen)
+// Widens a row to float, repeating the border pixels on both sides.
+inline void pad_row(std::uint8_t const* row, std::size_t width, float * out)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::sharpen_matrix);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        out[i] = row[i];
+        out[(width + 1) * 4 + i] = row[(width - 1) * 4 + i];
+    }
+    for (std::size_t j = 0; j < width * 4; ++j)
+    {
+        out[j + 4] = row[j];
+    }
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::edge_detect)
+// Applies kernel to every channel of a padded row and then restores
+// alpha; the flat loop over channels is easy for the compiler to vectorize.
+template <typename Kernel>
+void convolve_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                  std::vector<float> & rows, Kernel kernel)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::edge_detect_matrix);
+    std::size_t padded = (width + 2) * 4;
+    rows.resize(padded * 3);
+    pad_row(n.above, width, &rows[0]);
+    pad_row(n.row, width, &rows[padded]);
+    pad_row(n.below, width, &rows[padded * 2]);
+    float const* p0 = &rows[4];
+    float const* p1 = &rows[padded + 4];
+    float const* p2 = &rows[padded * 2 + 4];
+    for (std::size_t j = 0; j < width * 4; ++j)
+    {
+        out[j] = kernel(p0[j - 4], p0[j], p0[j + 4],
+                        p1[j - 4], p1[j], p1[j + 4],
+                        p2[j - 4], p2[j], p2[j + 4]);
+    }
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        out[x * 4 + 3] = n.row[x * 4 + 3];
+    }
 }
 
-
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::sobel)
+struct matrix_kernel
 {
-    using boost::gil::bits32f;
-
-    bits32f x_gradient = (src[2] + 2*src[5] + src[8])
-        - (src[0] + 2*src[3] + src[6]);
-
-    bits32f y_gradient = (src[0] + 2*src[1] + src[2])
-        - (src[6] + 2*src[7] + src[8]);
-
-    bits32f  out_value  = std::sqrt(std::pow(x_gradient,2) + std::pow(y_gradient,2));
-    //bts32f theta = std::atan2(x_gradient,y_gradient);
-    if (out_value < 0) out_value = 0;
-    if (out_value > 255) out_value = 255;
-    dst = out_value;
-}
+    explicit matrix_kernel(float const* k)
+    {
+        std::copy(k, k + 9, k_);
+    }
 
+    std::uint8_t operator() (float c0, float c1, float c2,
+                             float c3, float c4, float c5,
+                             float c6, float c7, float c8) const
+    {
+        float out_value =
+            k_[0]*c0 + k_[1]*c1 + k_[2]*c2 +
+            k_[3]*c3 + k_[4]*c4 + k_[5]*c5 +
+            k_[6]*c6 + k_[7]*c7 + k_[8]*c8
+            ;
+        if (out_value < 0) out_value = 0;
+        if (out_value > 255) out_value = 255;
+        return static_cast<std::uint8_t>(out_value);
+    }
 
+    float k_[9];
+};
 
-template <typename Src, typename Dst, typename Filter>
-void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+struct sobel_kernel
 {
-    using boost::gil::bits32f;
-    using boost::gil::point2;
+    std::uint8_t operator() (float c0, float c1, float c2,
+                             float c3, float /*c4*/, float c5,
+                             float c6, float c7, float c8) const
+    {
+        float x_gradient = (c2 + 2*c5 + c8)
+            - (c0 + 2*c3 + c6);
 
-    // p0 p1 p2
-    // p3 p4 p5
-    // p6 p7 p8
+        float y_gradient = (c0 + 2*c1 + c2)
+            - (c6 + 2*c7 + c8);
 
-    typename Src::xy_locator src_loc = src_view.xy_at(0,0);
-    typename Src::xy_locator::cached_location_t loc00 = src_loc.cache_location(-1,-1);
-    typename Src::xy_locator::cached_location_t loc10 = src_loc.cache_location( 0,-1);
-    typename Src::xy_locator::cached_location_t loc20 = src_loc.cache_location( 1,-1);
-    typename Src::xy_locator::cached_location_t loc01 = src_loc.cache_location(-1, 0);
-    typename Src::xy_locator::cached_location_t loc11 = src_loc.cache_location( 0, 0);
-    typename Src::xy_locator::cached_location_t loc21 = src_loc.cache_location( 1, 0);
-    typename Src::xy_locator::cached_location_t loc02 = src_loc.cache_location(-1, 1);
-    typename Src::xy_locator::cached_location_t loc12 = src_loc.cache_location( 0, 1);
-    typename Src::xy_locator::cached_location_t loc22 = src_loc.cache_location( 1, 1);
+        float out_value  = std::sqrt(std::pow(x_gradient,2) + std::pow(y_gradient,2));
+        if (out_value < 0) out_value = 0;
+        if (out_value > 255) out_value = 255;
+        return static_cast<std::uint8_t>(out_value);
+    }
+};
 
-    typename Src::x_iterator dst_it = dst_view.row_begin(0);
+// per band working memory of the neighbourhood filters
+struct filter_scratch
+{
+    std::vector<int> sums;
+    std::vector<float> rows;
+};
 
-    // top row
-    for (int x = 0 ; x < src_view.width(); ++x)
+inline void filter_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                       filter_scratch & scratch, blur)
+{
+    // the blur matrix is a box filter, so it is applied separably on
+    // integer column sums: 0.1111f times the exact sum of nine 8-bit values
+    // truncates to the same value as the nine rounded float products
+    std::vector<int> & sums = scratch.sums;
+    sums.resize(width * 3);
+    for (std::size_t x = 0; x < width; ++x)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (int i = 0; i < 3; ++i)
+        for (unsigned i = 0; i < 3; ++i)
         {
-            bits32f p[9];
-
-            p[4] = src_loc[loc11][i];
-            p[7] = src_loc[loc12][i];
-
-            if (x == 0)
-            {
-                p[3] = p[4];
-                p[6] = p[7];
-            }
-            else
-            {
-                p[3] = src_loc[loc01][i];
-                p[6] = src_loc[loc02][i];
-            }
-
-            if ( x == src_view.width()-1)
-            {
-                p[5] = p[4];
-                p[8] = p[7];
-            }
-            else
-            {
-                p[5] = src_loc[loc21][i];
-                p[8] = src_loc[loc22][i];
-            }
-
-            p[0] = p[6];
-            p[1] = p[7];
-            p[2] = p[8];
-
-            process_channel(p, (*dst_it)[i], filter);
+            sums[x * 3 + i] = n.above[x * 4 + i] + n.row[x * 4 + i] + n.below[x * 4 + i];
         }
-        ++src_loc.x();
-        ++dst_it;
     }
-    // carrige-return
-    src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
-
-    // 1... height-1 rows
-    for (int y = 1; y<src_view.height()-1; ++y)
+    for (std::size_t x = 0; x < width; ++x)
     {
-        for (int x = 0; x < src_view.width(); ++x)
+        std::size_t x0 = (x == 0) ? x : x - 1;
+        std::size_t x2 = (x + 1 == width) ? x : x + 1;
+        for (unsigned i = 0; i < 3; ++i)
         {
-            (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-            for (int i = 0; i < 3; ++i)
-            {
-                bits32f p[9];
-
-                p[1] = src_loc[loc10][i];
-                p[4] = src_loc[loc11][i];
-                p[7] = src_loc[loc12][i];
-
-                if (x == 0)
-                {
-                    p[0] = p[1];
-                    p[3] = p[4];
-                    p[6] = p[7];
-                }
-                else
-                {
-                    p[0] = src_loc[loc00][i];
-                    p[3] = src_loc[loc01][i];
-                    p[6] = src_loc[loc02][i];
-                }
-
-                if ( x == src_view.width() - 1)
-                {
-                    p[2] = p[1];
-                    p[5] = p[4];
-                    p[8] = p[7];
-                }
-                else
-                {
-                    p[2] = src_loc[loc20][i];
-                    p[5] = src_loc[loc21][i];
-                    p[8] = src_loc[loc22][i];
-                }
-                process_channel(p, (*dst_it)[i], filter);
-            }
-            ++dst_it;
-            ++src_loc.x();
+            int sum = sums[x0 * 3 + i] + sums[x * 3 + i] + sums[x2 * 3 + i];
+            float out_value = blur_matrix[0] * sum;
+            if (out_value > 255) out_value = 255;
+            out[x * 4 + i] = static_cast<std::uint8_t>(out_value);
         }
-        // carrige-return
-        src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
+        out[x * 4 + 3] = n.row[x * 4 + 3];
     }
+}
 
-    // bottom row
-    //src_loc = src_view.xy_at(0,src_view.height()-1);
-    for (int x = 0 ; x < src_view.width(); ++x)
-    {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (int i = 0; i < 3; ++i)
-        {
-            bits32f p[9];
-
-            p[1] = src_loc[loc10][i];
-            p[4] = src_loc[loc11][i];
-
-            if (x == 0)
-            {
-                p[0] = p[1];
-                p[3] = p[4];
-            }
-            else
-            {
-                p[0] = src_loc[loc00][i];
-                p[3] = src_loc[loc01][i];
-            }
-
-            if ( x == src_view.width()-1)
-            {
-                p[2] = p[1];
-                p[5] = p[4];
-
-            }
-            else
-            {
-                p[2] = src_loc[loc20][i];
-                p[5] = src_loc[loc21][i];
-            }
+inline void filter_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                       filter_scratch & scratch, emboss)
+{
+    convolve_row(n, out, width, scratch.rows, matrix_kernel(emboss_matrix));
+}
 
-            p[6] = p[0];
-            p[7] = p[1];
-            p[8] = p[2];
-            process_channel(p, (*dst_it)[i], filter);
-        }
-        ++src_loc.x();
-        ++dst_it;
-    }
+inline void filter_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                       filter_scratch & scratch, sharpen)
+{
+    convolve_row(n, out, width, scratch.rows, matrix_kernel(sharpen_matrix));
 }
 
-template <typename Src, typename Filter>
-void apply_filter(Src & src, Filter const& filter)
+inline void filter_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                       filter_scratch & scratch, edge_detect)
 {
-    {
-        demultiply_alpha(src);
-        double_buffer<Src> tb(src);
-        apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
-    } // ensure ~double_buffer() is called before premultiplying
-    premultiply_alpha(src);
+    convolve_row(n, out, width, scratch.rows, matrix_kernel(edge_detect_matrix));
 }
 
-template <typename Src>
-void apply_filter(Src & src, agg_stack_blur const& op)
+inline void filter_row(neighbourhood const& n, std::uint8_t * out, std::size_t width,
+                       filter_scratch & scratch, sobel)
 {
-    agg::rendering_buffer buf(src.getBytes(),src.width(),src.height(), src.getRowSize());
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+    convolve_row(n, out, width, scratch.rows, sobel_kernel());
 }
 
 inline double channel_delta(double source, double match)
@@ -419,23 +323,24 @@ inline uint8_t apply_alpha_shift(double source, double match, double alpha)
     return static_cast<uint8_t>(std::floor((source*255.0)+.5));
 }
 
-template <typename Src>
-void apply_filter(Src & src, color_to_alpha const& op)
+// Per-pixel filters work on one premultiplied rgba8 row at a time, which
+// lets consecutive ones run back to back while the row is still in cache.
+
+struct color_to_alpha_row
 {
-    using namespace boost::gil;
-    rgba8_view_t src_view = rgba8_view(src);
-    double cr = static_cast<double>(op.color.red())/255.0;
-    double cg = static_cast<double>(op.color.green())/255.0;
-    double cb = static_cast<double>(op.color.blue())/255.0;
-    for (int y=0; y<src_view.height(); ++y)
+    explicit color_to_alpha_row(color_to_alpha const& op)
+        : cr(static_cast<double>(op.color.red())/255.0),
+          cg(static_cast<double>(op.color.green())/255.0),
+          cb(static_cast<double>(op.color.blue())/255.0) {}
+
+    void operator() (std::uint8_t * p, std::size_t width) const
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-        for (int x=0; x<src_view.width(); ++x)
+        for (std::size_t x = 0; x < width; ++x, p += 4)
         {
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t & a = get_color(src_it[x], alpha_t());
+            uint8_t & r = p[0];
+            uint8_t & g = p[1];
+            uint8_t & b = p[2];
+            uint8_t & a = p[3];
             double sr = static_cast<double>(r)/255.0;
             double sg = static_cast<double>(g)/255.0;
             double sb = static_cast<double>(b)/255.0;
@@ -475,223 +380,436 @@ void apply_filter(Src & src, color_to_alpha const& op)
             }
         }
     }
-}
 
-template <typename Src>
-void apply_filter(Src & src, colorize_alpha const& op)
+    double cr;
+    double cg;
+    double cb;
+};
+
+struct colorize_alpha_row
 {
-    using namespace boost::gil;
-    std::size_t size = op.size();
-    if (op.size() == 1)
+    // the one stop case is a gradient of a single color, so both
+    // are served from the same 256 entry lookup table
+    explicit colorize_alpha_row(colorize_alpha const& op)
+        : single(op.size() == 1),
+          lut()
     {
-        // no interpolation if only one stop
-        mapnik::filter::color_stop const& stop = op[0];
-        mapnik::color const& c = stop.color;
-        rgba8_view_t src_view = rgba8_view(src);
-        for (int y=0; y<src_view.height(); ++y)
+        if (single)
+        {
+            mapnik::color const& c = op[0].color;
+            lut.assign(256, agg::rgba8(c.red(), c.green(), c.blue()));
+        }
+        else if (op.size() > 1)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-            for (int x=0; x<src_view.width(); ++x)
+            // interpolate multiple stops
+            agg::gradient_lut<agg::color_interpolator<agg::rgba8> > grad_lut;
+            double step = 1.0/(op.size()-1);
+            double offset = 0.0;
+            for ( mapnik::filter::color_stop const& stop : op)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                if ( a > 0)
+                mapnik::color const& c = stop.color;
+                double stop_offset = stop.offset;
+                if (stop_offset == 0)
                 {
-                    r = (c.red() * a + 255) >> 8;
-                    g = (c.green() * a + 255) >> 8;
-                    b = (c.blue() * a + 255) >> 8;
+                    stop_offset = offset;
                 }
+                grad_lut.add_color(stop_offset, agg::rgba(c.red()/256.0,
+                                                          c.green()/256.0,
+                                                          c.blue()/256.0,
+                                                          c.alpha()/256.0));
+                offset += step;
             }
-        }
-    }
-    else if (size > 1)
-    {
-        // interpolate multiple stops
-        agg::gradient_lut<agg::color_interpolator<agg::rgba8> > grad_lut;
-        double step = 1.0/(size-1);
-        double offset = 0.0;
-        for ( mapnik::filter::color_stop const& stop : op)
-        {
-            mapnik::color const& c = stop.color;
-            double stop_offset = stop.offset;
-            if (stop_offset == 0)
+            if (grad_lut.build_lut())
             {
-                stop_offset = offset;
+                lut.reserve(256);
+                for (unsigned i = 0; i < 256; ++i)
+                {
+                    lut.push_back(grad_lut[i]);
+                }
             }
-            grad_lut.add_color(stop_offset, agg::rgba(c.red()/256.0,
-                                                      c.green()/256.0,
-                                                      c.blue()/256.0,
-                                                      c.alpha()/256.0));
-            offset += step;
         }
-        if (grad_lut.build_lut())
+    }
+
+    bool empty() const
+    {
+        return lut.empty();
+    }
+
+    void operator() (std::uint8_t * p, std::size_t width) const
+    {
+        for (std::size_t x = 0; x < width; ++x, p += 4)
         {
-            rgba8_view_t src_view = rgba8_view(src);
-            for (int y=0; y<src_view.height(); ++y)
+            uint8_t & r = p[0];
+            uint8_t & g = p[1];
+            uint8_t & b = p[2];
+            uint8_t a = p[3];
+            if ( a > 0)
             {
-                rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-                for (int x=0; x<src_view.width(); ++x)
+                agg::rgba8 const& c = lut[a];
+                r = (c.r * a + 255) >> 8;
+                g = (c.g * a + 255) >> 8;
+                b = (c.b * a + 255) >> 8;
+                if (!single)
                 {
-                    uint8_t & r = get_color(src_it[x], red_t());
-                    uint8_t & g = get_color(src_it[x], green_t());
-                    uint8_t & b = get_color(src_it[x], blue_t());
-                    uint8_t & a = get_color(src_it[x], alpha_t());
-                    if ( a > 0)
-                    {
-                        agg::rgba8 c = grad_lut[a];
-                        r = (c.r * a + 255) >> 8;
-                        g = (c.g * a + 255) >> 8;
-                        b = (c.b * a + 255) >> 8;
-                        if (r>a) r=a;
-                        if (g>a) g=a;
-                        if (b>a) b=a;
-        #if 0
-                        // rainbow
-                        r = 0;
-                        g = 0;
-                        b = 0;
-                        if (a < 64)
-                        {
-                            g = a * 4;
-                            b = 255;
-                        }
-                        else if (a >= 64 && a < 128)
-                        {
-                            g = 255;
-                            b = 255 - ((a - 64) * 4);
-                        }
-                        else if (a >= 128 && a < 192)
-                        {
-                            r = (a - 128) * 4;
-                            g = 255;
-                        }
-                        else // >= 192
-                        {
-                            r = 255;
-                            g = 255 - ((a - 192) * 4);
-                        }
-                        r = (r * a + 255) >> 8;
-                        g = (g * a + 255) >> 8;
-                        b = (b * a + 255) >> 8;
-        #endif
-                    }
+                    if (r>a) r=a;
+                    if (g>a) g=a;
+                    if (b>a) b=a;
                 }
             }
         }
     }
-}
 
-template <typename Src>
-void apply_filter(Src & src, scale_hsla const& transform)
+    bool single;
+    std::vector<agg::rgba8> lut;
+};
+
+struct scale_hsla_row
 {
-    using namespace boost::gil;
-    bool tinting = !transform.is_identity();
-    bool set_alpha = !transform.is_alpha_identity();
-    // todo - filters be able to report if they
-    // should be run to avoid overhead of temp buffer
-    if (tinting || set_alpha)
+    explicit scale_hsla_row(scale_hsla const& op)
+        : transform(op),
+          tinting(!op.is_identity()),
+          set_alpha(!op.is_alpha_identity()) {}
+
+    bool empty() const
     {
-        rgba8_view_t src_view = rgba8_view(src);
-        for (int y=0; y<src_view.height(); ++y)
+        return !tinting && !set_alpha;
+    }
+
+    void operator() (std::uint8_t * p, std::size_t width) const
+    {
+        for (std::size_t x = 0; x < width; ++x, p += 4)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-            for (int x=0; x<src_view.width(); ++x)
+            uint8_t & r = p[0];
+            uint8_t & g = p[1];
+            uint8_t & b = p[2];
+            uint8_t & a = p[3];
+            double r2 = static_cast<double>(r)/255.0;
+            double g2 = static_cast<double>(g)/255.0;
+            double b2 = static_cast<double>(b)/255.0;
+            double a2 = static_cast<double>(a)/255.0;
+            // demultiply
+            if (a2 <= 0.0)
+            {
+                r = g = b = 0;
+                continue;
+            }
+            else
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                double r2 = static_cast<double>(r)/255.0;
-                double g2 = static_cast<double>(g)/255.0;
-                double b2 = static_cast<double>(b)/255.0;
-                double a2 = static_cast<double>(a)/255.0;
-                // demultiply
-                if (a2 <= 0.0)
+                r2 /= a2;
+                g2 /= a2;
+                b2 /= a2;
+            }
+            if (set_alpha)
+            {
+                a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
+                if (a2 <= 0)
                 {
-                    r = g = b = 0;
+                    r = g = b = a = 0;
                     continue;
                 }
+                else if (a2 > 1)
+                {
+                    a2 = 1;
+                    a = 255;
+                }
                 else
                 {
-                    r2 /= a2;
-                    g2 /= a2;
-                    b2 /= a2;
+                    a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
                 }
-                if (set_alpha)
+            }
+            if (tinting)
+            {
+                double h;
+                double s;
+                double l;
+                rgb2hsl(r2,g2,b2,h,s,l);
+                double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
+                double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
+                double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
+                if (h2 > 1) { h2 = 1; }
+                else if (h2 < 0) { h2 = 0; }
+                if (s2 > 1) { s2 = 1; }
+                else if (s2 < 0) { s2 = 0; }
+                if (l2 > 1) { l2 = 1; }
+                else if (l2 < 0) { l2 = 0; }
+                hsl2rgb(h2,s2,l2,r2,g2,b2);
+            }
+            // premultiply
+            r2 *= a2;
+            g2 *= a2;
+            b2 *= a2;
+            r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
+            g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
+            b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
+            // all color values must be <= alpha
+            if (r>a) r=a;
+            if (g>a) g=a;
+            if (b>a) b=a;
+        }
+    }
+
+    scale_hsla transform;
+    bool tinting;
+    bool set_alpha;
+};
+
+struct gray_row
+{
+    void operator() (std::uint8_t * p, std::size_t width) const
+    {
+        for (std::size_t x = 0; x < width; ++x, p += 4)
+        {
+            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
+            uint8_t v = uint8_t((4915 * p[0] + 9667 * p[1] + 1802 * p[2] + 8192) >> 14);
+            p[0] = p[1] = p[2] = v;
+        }
+    }
+};
+
+struct invert_row
+{
+    void operator() (std::uint8_t * p, std::size_t width) const
+    {
+        for (std::size_t x = 0; x < width; ++x, p += 4)
+        {
+            // we only work with premultiplied source,
+            // thus all color values must be <= alpha
+            uint8_t a = p[3];
+            p[0] = a - p[0];
+            p[1] = a - p[1];
+            p[2] = a - p[2];
+        }
+    }
+};
+
+using row_stage = std::function<void(std::uint8_t *, std::size_t)>;
+
+// Appends the row function of a per-pixel filter to `stages` and returns
+// true; returns false for filters that need a pixel's neighbours.
+struct row_stage_visitor
+{
+    explicit row_stage_visitor(std::vector<row_stage> & stages)
+        : stages_(stages) {}
+
+    template <typename T>
+    bool operator() (T const&) const
+    {
+        return false;
+    }
+
+    bool operator() (color_to_alpha const& op) const
+    {
+        stages_.emplace_back(color_to_alpha_row(op));
+        return true;
+    }
+
+    bool operator() (colorize_alpha const& op) const
+    {
+        colorize_alpha_row stage(op);
+        if (!stage.empty()) stages_.emplace_back(std::move(stage));
+        return true;
+    }
+
+    bool operator() (scale_hsla const& op) const
+    {
+        scale_hsla_row stage(op);
+        if (!stage.empty()) stages_.emplace_back(std::move(stage));
+        return true;
+    }
+
+    bool operator() (gray const&) const
+    {
+        stages_.emplace_back(gray_row());
+        return true;
+    }
+
+    bool operator() (invert const&) const
+    {
+        stages_.emplace_back(invert_row());
+        return true;
+    }
+
+    std::vector<row_stage> & stages_;
+};
+
+// Runs all stages over each row before moving on to the next one.
+template <typename Src>
+void apply_row_stages(Src & src, std::vector<row_stage> const& stages, unsigned threads)
+{
+    if (stages.empty()) return;
+    std::size_t width = src.width();
+    for_each_band(src.height(), threads, [&](std::size_t y0, std::size_t y1)
+    {
+        for (std::size_t y = y0; y < y1; ++y)
+        {
+            std::uint8_t * row = row_bytes(src, y);
+            for (row_stage const& stage : stages)
+            {
+                stage(row, width);
+            }
+        }
+    });
+}
+
+template <typename Src, typename Stage>
+void apply_row_stage(Src & src, Stage const& stage, unsigned threads)
+{
+    std::size_t width = src.width();
+    for_each_band(src.height(), threads, [&](std::size_t y0, std::size_t y1)
+    {
+        for (std::size_t y = y0; y < y1; ++y)
+        {
+            stage(row_bytes(src, y), width);
+        }
+    });
+}
+
+}
+
+template <typename Image>
+boost::gil::rgba8_view_t rgba8_view(Image & img)
+{
+    using boost::gil::interleaved_view;
+    using boost::gil::rgba8_pixel_t;
+    return interleaved_view(img.width(), img.height(),
+                            reinterpret_cast<rgba8_pixel_t*>(img.getBytes()),
+                            img.width() * sizeof(rgba8_pixel_t));
+}
+
+template <typename Image>
+struct double_buffer
+{
+    boost::gil::rgba8_image_t   dst_buffer;
+    boost::gil::rgba8_view_t    dst_view;
+    boost::gil::rgba8_view_t    src_view;
+
+    explicit double_buffer(Image & src)
+        : dst_buffer(src.width(), src.height())
+        , dst_view(view(dst_buffer))
+        , src_view(rgba8_view(src)) {}
+
+    ~double_buffer()
+    {
+        copy_pixels(dst_view, src_view);
+    }
+};
+
+// 3x3 neighbourhood filters (blur, emboss, sharpen, edge-detect, sobel)
+// work on demultiplied colors, keep alpha and return a premultiplied image.
+template <typename Src, typename Filter>
+void apply_filter(Src & src, Filter const& filter, unsigned threads = 1)
+{
+    using multiplier = agg::multiplier_rgba<agg::rgba8, agg::order_rgba>;
+    std::size_t width = src.width();
+    std::size_t height = src.height();
+    if (src.get_premultiplied())
+    {
+        detail::for_each_band(height, threads, [&](std::size_t y0, std::size_t y1)
+        {
+            for (std::size_t y = y0; y < y1; ++y)
+            {
+                std::uint8_t * p = detail::row_bytes(src, y);
+                for (std::size_t x = 0; x < width; ++x, p += 4)
                 {
-                    a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
-                    if (a2 <= 0)
-                    {
-                        r = g = b = a = 0;
-                        continue;
-                    }
-                    else if (a2 > 1)
-                    {
-                        a2 = 1;
-                        a = 255;
-                    }
-                    else
-                    {
-                        a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
-                    }
+                    multiplier::demultiply(p);
                 }
-                if (tinting)
+            }
+        });
+    }
+    if (width > 0 && height > 0)
+    {
+        std::vector<std::uint8_t> dst(width * height * 4);
+        detail::for_each_band(height, threads, [&](std::size_t y0, std::size_t y1)
+        {
+            detail::filter_scratch scratch;
+            for (std::size_t y = y0; y < y1; ++y)
+            {
+                std::size_t above = (y > 0) ? y - 1 : std::min(y + 1, height - 1);
+                std::size_t below = (y + 1 < height) ? y + 1 : (y > 0 ? y - 1 : y);
+                detail::neighbourhood n = { detail::row_bytes(src, above),
+                                            detail::row_bytes(src, y),
+                                            detail::row_bytes(src, below) };
+                detail::filter_row(n, &dst[y * width * 4], width, scratch, filter);
+            }
+        });
+        detail::for_each_band(height, threads, [&](std::size_t y0, std::size_t y1)
+        {
+            for (std::size_t y = y0; y < y1; ++y)
+            {
+                std::uint8_t * p = detail::row_bytes(src, y);
+                std::copy(&dst[y * width * 4], &dst[(y + 1) * width * 4], p);
+                for (std::size_t x = 0; x < width; ++x, p += 4)
                 {
-                    double h;
-                    double s;
-                    double l;
-                    rgb2hsl(r2,g2,b2,h,s,l);
-                    double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
-                    double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
-                    double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
-                    if (h2 > 1) { h2 = 1; }
-                    else if (h2 < 0) { h2 = 0; }
-                    if (s2 > 1) { s2 = 1; }
-                    else if (s2 < 0) { s2 = 0; }
-                    if (l2 > 1) { l2 = 1; }
-                    else if (l2 < 0) { l2 = 0; }
-                    hsl2rgb(h2,s2,l2,r2,g2,b2);
+                    multiplier::premultiply(p);
                 }
-                // premultiply
-                r2 *= a2;
-                g2 *= a2;
-                b2 *= a2;
-                r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
-                g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
-                b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
-                // all color values must be <= alpha
-                if (r>a) r=a;
-                if (g>a) g=a;
-                if (b>a) b=a;
             }
-        }
+        });
+    }
+    src.set_premultiplied(true);
+}
+
+// Stack blur is separable: rows are blurred in bands of rows, then columns
+// in bands of columns, which gives the same result as one agg call.
+template <typename Src>
+void apply_filter(Src & src, agg_stack_blur const& op, unsigned threads = 1)
+{
+    std::size_t width = src.width();
+    std::size_t height = src.height();
+    unsigned stride = src.getRowSize();
+    if (op.rx > 0)
+    {
+        detail::for_each_band(height, threads, [&](std::size_t y0, std::size_t y1)
+        {
+            agg::rendering_buffer buf(detail::row_bytes(src, y0), width, y1 - y0, stride);
+            agg::pixfmt_rgba32_pre pixf(buf);
+            agg::stack_blur_rgba32(pixf, op.rx, 0);
+        });
+    }
+    if (op.ry > 0)
+    {
+        detail::for_each_band(width, threads, [&](std::size_t x0, std::size_t x1)
+        {
+            agg::rendering_buffer buf(src.getBytes() + x0 * 4, x1 - x0, height, stride);
+            agg::pixfmt_rgba32_pre pixf(buf);
+            agg::stack_blur_rgba32(pixf, 0, op.ry);
+        });
     }
 }
 
 template <typename Src>
-void apply_filter(Src & src, gray const& /*op*/)
+void apply_filter(Src & src, color_to_alpha const& op, unsigned threads = 1)
 {
-    using namespace boost::gil;
+    detail::apply_row_stage(src, detail::color_to_alpha_row(op), threads);
+}
 
-    rgba8_view_t src_view = rgba8_view(src);
+template <typename Src>
+void apply_filter(Src & src, colorize_alpha const& op, unsigned threads = 1)
+{
+    detail::colorize_alpha_row stage(op);
+    if (!stage.empty())
+    {
+        detail::apply_row_stage(src, stage, threads);
+    }
+}
 
-    for (int y=0; y<src_view.height(); ++y)
+template <typename Src>
+void apply_filter(Src & src, scale_hsla const& transform, unsigned threads = 1)
+{
+    // todo - filters be able to report if they
+    // should be run to avoid overhead of temp buffer
+    detail::scale_hsla_row stage(transform);
+    if (!stage.empty())
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-        for (int x=0; x<src_view.width(); ++x)
-        {
-            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t   v = uint8_t((4915 * r + 9667 * g + 1802 * b + 8192) >> 14);
-            r = g = b = v;
-        }
+        detail::apply_row_stage(src, stage, threads);
     }
 }
 
+template <typename Src>
+void apply_filter(Src & src, gray const& /*op*/, unsigned threads = 1)
+{
+    detail::apply_row_stage(src, detail::gray_row(), threads);
+}
+
 template <typename Src, typename Dst>
 void x_gradient_impl(Src const& src_view, Dst const& dst_view)
 {
@@ -721,14 +839,14 @@ void x_gradient_impl(Src const& src_view, Dst const& dst_view)
 }
 
 template <typename Src>
-void apply_filter(Src & src, x_gradient const& /*op*/)
+void apply_filter(Src & src, x_gradient const& /*op*/, unsigned /*threads*/ = 1)
 {
     double_buffer<Src> tb(src);
     x_gradient_impl(tb.src_view, tb.dst_view);
 }
 
 template <typename Src>
-void apply_filter(Src & src, y_gradient const& /*op*/)
+void apply_filter(Src & src, y_gradient const& /*op*/, unsigned /*threads*/ = 1)
 {
     double_buffer<Src> tb(src);
     x_gradient_impl(rotated90ccw_view(tb.src_view),
@@ -736,45 +854,48 @@ void apply_filter(Src & src, y_gradient const& /*op*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, invert const& /*op*/)
+void apply_filter(Src & src, invert const& /*op*/, unsigned threads = 1)
 {
-    using namespace boost::gil;
-
-    rgba8_view_t src_view = rgba8_view(src);
-
-    for (int y=0; y<src_view.height(); ++y)
-    {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-        for (int x=0; x<src_view.width(); ++x)
-        {
-            // we only work with premultiplied source,
-            // thus all color values must be <= alpha
-            uint8_t   a = get_color(src_it[x], alpha_t());
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            r = a - r;
-            g = a - g;
-            b = a - b;
-        }
-    }
+    detail::apply_row_stage(src, detail::invert_row(), threads);
 }
 
 template <typename Src>
 struct filter_visitor
 {
-    filter_visitor(Src & src)
-    : src_(src) {}
+    filter_visitor(Src & src, unsigned threads = 1)
+    : src_(src),
+      threads_(threads) {}
 
     template <typename T>
     void operator () (T const& filter)
     {
-        apply_filter(src_, filter);
+        apply_filter(src_, filter, threads_);
     }
 
     Src & src_;
+    unsigned threads_;
 };
 
+// Applies a chain of filters in order. Runs of consecutive per-pixel
+// filters (e.g. scale-hsla, color-to-alpha, invert) are fused into a
+// single pass over the image; every pass is split into row bands
+// processed on up to `threads` threads.
+template <typename Src>
+void apply_filters(Src & src, std::vector<filter_type> const& filters, unsigned threads = 1)
+{
+    std::vector<detail::row_stage> stages;
+    for (filter_type const& filter : filters)
+    {
+        if (!util::apply_visitor(detail::row_stage_visitor(stages), filter))
+        {
+            detail::apply_row_stages(src, stages, threads);
+            stages.clear();
+            util::apply_visitor(filter_visitor<Src>(src, threads), filter);
+        }
+    }
+    detail::apply_row_stages(src, stages, threads);
+}
+
 struct filter_radius_visitor
 {
     int & radius_;
@@ -62,7 +62,23 @@ struct MAPNIK_DECL image_reader : private util::noncopyable
     virtual boost::optional<box2d<double> > bounding_box() const = 0;
     virtual void read(unsigned x,unsigned y,image_rgba8& image) = 0;
     virtual image_any read(unsigned x, unsigned y, unsigned width, unsigned height) = 0;
+    // Reduced resolution copies stored with the image (e.g. tiff overviews),
+    // ordered by decreasing size. Level 0 is the full resolution image.
+    virtual unsigned levels() const { return 1; }
+    virtual unsigned level_width(unsigned) const { return width(); }
+    virtual unsigned level_height(unsigned) const { return height(); }
+    virtual image_any read_level(unsigned, unsigned x, unsigned y, unsigned width, unsigned height)
+    {
+        return read(x, y, width, height);
+    }
+    // coarsest level decimated by at most `factor` source pixels per level pixel
+    unsigned level_for_factor(double factor) const;
+    // maximum number of threads a reader may use to decode one read
+    virtual void set_threads(unsigned threads) { threads_ = threads; }
+    unsigned threads() const { return threads_; }
     virtual ~image_reader() {}
+protected:
+    unsigned threads_ = 1;
 };
 
 template <typename...Args>
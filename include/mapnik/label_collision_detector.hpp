@@ -32,6 +32,9 @@
 #include <unicode/unistr.h>
 
 // stl
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
 #include <vector>
 
 namespace mapnik
@@ -125,40 +128,132 @@ public:
 };
 
 
-//quad tree based label collision detector so labels dont appear within a given distance
+// grid based label collision detector so labels dont appear within a given distance
+//
+// Labels are kept in one vector and indexed by a uniform grid of cells
+// covering the extent (boxes outside are clamped to the border cells).
+// Repeat keys are interned so the repeat distance check compares integer
+// ids, queries stamp visited labels instead of collecting results, and
+// clear() keeps all allocated storage for the next render.
 class label_collision_detector4 : util::noncopyable
 {
 public:
     struct label
     {
-        label(box2d<double> const& b) : box(b), text() {}
-        label(box2d<double> const& b, mapnik::value_unicode_string const& t) : box(b), text(t) {}
+        label(box2d<double> const& b, unsigned k) : box(b), key(k) {}
 
         box2d<double> box;
-        mapnik::value_unicode_string text;
+        // interned repeat key, 0 for labels without text
+        unsigned key;
     };
 
 private:
-    using tree_t = quad_tree< label >;
-    tree_t tree_;
+    struct unicode_string_hash
+    {
+        std::size_t operator()(mapnik::value_unicode_string const& str) const
+        {
+            return static_cast<std::size_t>(str.hashCode());
+        }
+    };
 
-public:
-    using query_iterator = tree_t::query_iterator;
+    using labels_t = std::vector<label>;
+    using cell_t = std::vector<unsigned>;
+    using keys_t = std::unordered_map<mapnik::value_unicode_string, unsigned, unicode_string_hash>;
+
+    box2d<double> extent_;
+    unsigned columns_;
+    unsigned rows_;
+    double cell_width_;
+    double cell_height_;
+    labels_t labels_;
+    std::vector<cell_t> cells_;
+    std::vector<unsigned> stamps_;
+    unsigned stamp_;
+    keys_t keys_;
+
+    // aim for cells of 64x64 pixels, at most 256 per side
+    static unsigned num_cells(double length)
+    {
+        if (!(length > 0)) return 1;
+        double n = std::ceil(length / 64.0);
+        return n > 256.0 ? 256 : static_cast<unsigned>(n);
+    }
 
-    explicit label_collision_detector4(box2d<double> const& extent)
-        : tree_(extent) {}
+    static unsigned cell_index(double value, double origin, double cell_size, unsigned count)
+    {
+        double pos = (value - origin) / cell_size;
+        if (!(pos > 0)) return 0;
+        if (pos >= count) return count - 1;
+        return static_cast<unsigned>(pos);
+    }
 
-    bool has_placement(box2d<double> const& box)
+    // calls func(label) once for each label in cells overlapping box,
+    // stopping as soon as func returns false
+    template <typename Func>
+    bool for_each_candidate(box2d<double> const& box, Func func)
     {
-        tree_t::query_iterator itr = tree_.query_in_box(box);
-        tree_t::query_iterator end = tree_.query_end();
+        unsigned col0 = cell_index(box.minx(), extent_.minx(), cell_width_, columns_);
+        unsigned col1 = cell_index(box.maxx(), extent_.minx(), cell_width_, columns_);
+        unsigned row0 = cell_index(box.miny(), extent_.miny(), cell_height_, rows_);
+        unsigned row1 = cell_index(box.maxy(), extent_.miny(), cell_height_, rows_);
+        if (++stamp_ == 0)
+        {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            stamp_ = 1;
+        }
+        for (unsigned row = row0; row <= row1; ++row)
+        {
+            for (unsigned col = col0; col <= col1; ++col)
+            {
+                for (unsigned index : cells_[row * columns_ + col])
+                {
+                    if (stamps_[index] == stamp_) continue;
+                    stamps_[index] = stamp_;
+                    if (!func(labels_[index])) return false;
+                }
+            }
+        }
+        return true;
+    }
 
-        for ( ;itr != end; ++itr)
+    void insert_label(box2d<double> const& box, unsigned key)
+    {
+        unsigned index = labels_.size();
+        labels_.emplace_back(box, key);
+        stamps_.push_back(0);
+        unsigned col0 = cell_index(box.minx(), extent_.minx(), cell_width_, columns_);
+        unsigned col1 = cell_index(box.maxx(), extent_.minx(), cell_width_, columns_);
+        unsigned row0 = cell_index(box.miny(), extent_.miny(), cell_height_, rows_);
+        unsigned row1 = cell_index(box.maxy(), extent_.miny(), cell_height_, rows_);
+        for (unsigned row = row0; row <= row1; ++row)
         {
-            if (itr->box.intersects(box)) return false;
+            for (unsigned col = col0; col <= col1; ++col)
+            {
+                cells_[row * columns_ + col].push_back(index);
+            }
         }
+    }
 
-        return true;
+public:
+    using query_iterator = labels_t::const_iterator;
+
+    explicit label_collision_detector4(box2d<double> const& extent)
+        : extent_(extent),
+          columns_(num_cells(extent.width())),
+          rows_(num_cells(extent.height())),
+          cell_width_(extent.width() > 0 ? extent.width() / columns_ : 1.0),
+          cell_height_(extent.height() > 0 ? extent.height() / rows_ : 1.0),
+          labels_(),
+          cells_(columns_ * rows_),
+          stamps_(),
+          stamp_(0),
+          keys_() {}
+
+    bool has_placement(box2d<double> const& box)
+    {
+        return for_each_candidate(box, [&box](label const& lab) {
+                return !lab.box.intersects(box);
+            });
     }
 
     bool has_placement(box2d<double> const& box, double margin)
@@ -168,17 +263,9 @@ public:
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
 
-        tree_t::query_iterator itr = tree_.query_in_box(margin_box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for (;itr != end; ++itr)
-        {
-            if (itr->box.intersects(margin_box))
-            {
-                return false;
-            }
-        }
-        return true;
+        return for_each_candidate(margin_box, [&margin_box](label const& lab) {
+                return !lab.box.intersects(margin_box);
+            });
     }
 
     bool has_placement(box2d<double> const& box, double margin, mapnik::value_unicode_string const& text, double repeat_distance)
@@ -188,6 +275,19 @@ public:
             return has_placement(box, margin);
         }
 
+        // empty text repeats labels inserted without text, like any other text
+        unsigned key = 0;
+        if (!text.isEmpty())
+        {
+            keys_t::const_iterator key_itr = keys_.find(text);
+            if (key_itr == keys_.end())
+            {
+                // no label with this text yet, only the margin matters
+                return has_placement(box, margin);
+            }
+            key = key_itr->second;
+        }
+
         box2d<double> repeat_box(box.minx() - repeat_distance, box.miny() - repeat_distance,
                                  box.maxx() + repeat_distance, box.maxy() + repeat_distance);
 
@@ -196,42 +296,38 @@ public:
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
 
-        tree_t::query_iterator itr = tree_.query_in_box(repeat_box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
-        {
-            if (itr->box.intersects(margin_box) || (text == itr->text && itr->box.intersects(repeat_box)))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return for_each_candidate(repeat_box, [&](label const& lab) {
+                return !(lab.box.intersects(margin_box) || (key == lab.key && lab.box.intersects(repeat_box)));
+            });
     }
 
     void insert(box2d<double> const& box)
     {
-        tree_.insert(label(box), box);
+        insert_label(box, 0);
     }
 
     void insert(box2d<double> const& box, mapnik::value_unicode_string const& text)
     {
-        tree_.insert(label(box, text), box);
+        unsigned key = text.isEmpty() ? 0 : keys_.emplace(text, keys_.size() + 1).first->second;
+        insert_label(box, key);
     }
 
     void clear()
     {
-        tree_.clear();
+        for (cell_t & cell : cells_) cell.clear();
+        labels_.clear();
+        stamps_.clear();
+        stamp_ = 0;
+        keys_.clear();
     }
 
     box2d<double> const& extent() const
     {
-        return tree_.extent();
+        return extent_;
     }
 
-    query_iterator begin() { return tree_.query_in_box(extent()); }
-    query_iterator end() { return tree_.query_end(); }
+    query_iterator begin() const { return labels_.begin(); }
+    query_iterator end() const { return labels_.end(); }
 };
 }
 
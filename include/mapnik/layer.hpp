@@ -170,6 +170,17 @@ public:
      */
     bool cache_features() const;
 
+    /*!
+     * @param shared_feature_cache Set whether this layer's features are kept in the
+     * feature_cache shared across renders.
+     */
+    void set_shared_feature_cache(bool shared_feature_cache);
+
+    /*!
+     * @return whether this layer's features are kept in the feature_cache shared across renders
+     */
+    bool shared_feature_cache() const;
+
     /*!
      * @param column Set the field rendering of this layer is grouped by.
      */
@@ -213,6 +224,7 @@ private:
     bool queryable_;
     bool clear_label_cache_;
     bool cache_features_;
+    bool shared_feature_cache_;
     std::string group_by_;
     std::vector<std::string> styles_;
     datasource_ptr ds_;
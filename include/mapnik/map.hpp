@@ -86,6 +86,9 @@ private:
     unsigned height_;
     std::string srs_;
     int buffer_size_;
+    unsigned query_threads_;
+    unsigned filter_threads_;
+    unsigned warp_threads_;
     boost::optional<color> background_;
     boost::optional<std::string> background_image_;
     composite_mode_e background_image_comp_op_;
@@ -365,6 +368,47 @@ public:
      */
     int buffer_size() const;
 
+    /*! \brief Set the number of threads used to query layer datasources
+     *
+     *  When greater than one, datasource queries and feature fetching for
+     *  all visible layers run concurrently before rendering, which still
+     *  happens in layer order. Requires a thread safe build.
+     *  @param threads Maximum number of concurrent layer queries (0 or 1 = serial).
+     */
+    void set_query_threads(unsigned threads);
+
+    /*! \brief Get the number of threads used to query layer datasources
+     *  @return Thread count as unsigned
+     */
+    unsigned query_threads() const;
+
+    /*! \brief Set the number of threads used to apply style image filters
+     *
+     *  Image filters and direct image filters are applied to row bands of
+     *  the style buffer concurrently. Requires a thread safe build.
+     *  @param threads Maximum number of filter threads (0 or 1 = serial).
+     */
+    void set_filter_threads(unsigned threads);
+
+    /*! \brief Get the number of threads used to apply style image filters
+     *  @return Thread count as unsigned
+     */
+    unsigned filter_threads() const;
+
+    /*! \brief Set the number of threads used to reproject rasters
+     *
+     *  Raster symbolizers warping a raster into the map projection
+     *  rasterize row bands of the output concurrently. Requires a thread
+     *  safe build.
+     *  @param threads Maximum number of warp threads (0 or 1 = serial).
+     */
+    void set_warp_threads(unsigned threads);
+
+    /*! \brief Get the number of threads used to reproject rasters
+     *  @return Thread count as unsigned
+     */
+    unsigned warp_threads() const;
+
     /*! \brief Set the map maximum extent.
      *  @param box The bounding box for the maximum extent.
      */
@@ -27,17 +27,76 @@
 #include <mapnik/utils.hpp>
 #include <mapnik/config.hpp>
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/image.hpp>
 
 // boost
 #include <boost/unordered_map.hpp>
 #include <memory>
 #include <boost/optional.hpp>
 
+// stl
+#include <atomic>
+#include <string>
+
 namespace mapnik
 {
 
 struct marker;
 
+// Pre-rasterized (premultiplied) SVG marker. The image origin is placed at
+// (x, y) pixels relative to the whole pixel part of the marker position.
+struct marker_sprite
+{
+    image_rgba8 image;
+    int x = 0;
+    int y = 0;
+    // set when the marker does not fit a sprite and must be rendered directly
+    bool direct = false;
+};
+
+using marker_sprite_ptr = std::shared_ptr<marker_sprite const>;
+
+struct marker_sprite_key
+{
+    // marker file
+    std::string path;
+    // evaluated style overrides, unset where the marker's own style applies
+    boost::optional<unsigned> fill;
+    boost::optional<double> fill_opacity;
+    boost::optional<unsigned> stroke;
+    boost::optional<double> stroke_width;
+    boost::optional<double> stroke_opacity;
+    // linear part of the marker transform
+    double sx;
+    double shy;
+    double shx;
+    double sy;
+    // subpixel offset in 1/16 pixel
+    int dx;
+    int dy;
+    double opacity;
+    double gamma;
+    int gamma_method;
+
+    bool operator==(marker_sprite_key const& rhs) const
+    {
+        return sx == rhs.sx && shy == rhs.shy && shx == rhs.shx && sy == rhs.sy &&
+            dx == rhs.dx && dy == rhs.dy &&
+            opacity == rhs.opacity &&
+            gamma == rhs.gamma && gamma_method == rhs.gamma_method &&
+            fill == rhs.fill && fill_opacity == rhs.fill_opacity &&
+            stroke == rhs.stroke && stroke_width == rhs.stroke_width &&
+            stroke_opacity == rhs.stroke_opacity &&
+            path == rhs.path;
+    }
+};
+
+struct marker_sprite_key_hash
+{
+    std::size_t operator()(marker_sprite_key const& key) const;
+};
+
 class MAPNIK_DECL marker_cache :
         public singleton <marker_cache, CreateUsingNew>,
         private util::noncopyable
@@ -50,6 +109,10 @@ private:
     boost::unordered_map<std::string, mapnik::marker> marker_cache_;
     bool insert_svg(std::string const& name, std::string const& svg_string);
     boost::unordered_map<std::string,std::string> svg_cache_;
+    // sprites have their own lock so renderers are not held up while
+    // find() loads marker files under the singleton mutex
+    util::lru_cache<marker_sprite_key, marker_sprite_ptr, marker_sprite_key_hash> sprites_;
+    std::atomic<unsigned> sprite_rotation_steps_;
 public:
     std::string known_svg_prefix_;
     std::string known_image_prefix_;
@@ -58,6 +121,18 @@ public:
     bool is_image_uri(std::string const& path);
     marker const& find(std::string const& key, bool update_cache = false);
     void clear();
+    // LRU cache of rasterized SVG markers used by the agg renderer
+    marker_sprite_ptr find_sprite(marker_sprite_key const& key);
+    void insert_sprite(marker_sprite_key const& key, marker_sprite_ptr const& sprite);
+    // maximum number of sprites, 0 disables sprites and markers are
+    // always rasterized directly
+    void set_sprite_capacity(std::size_t capacity);
+    std::size_t sprite_capacity() const;
+    // markers rotated along their placement are drawn from sprites at
+    // the nearest of this many rotations per turn; 0 keeps rotations
+    // exact, so only markers at the same angle share a sprite
+    void set_sprite_rotation_steps(unsigned steps);
+    unsigned sprite_rotation_steps() const;
 };
 
 }
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_METATILE_HPP
+#define MAPNIK_METATILE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/attribute.hpp>
+
+// stl
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+class Map;
+class rgba_palette;
+
+// A block of up to size x size tiles of the spherical mercator tile
+// pyramid which is rendered in a single pass and then cut into tiles.
+// The block is aligned to multiples of size, so every tile z/x/y
+// belongs to exactly one metatile.
+class MAPNIK_DECL metatile
+{
+public:
+    metatile(unsigned z,
+             unsigned x,
+             unsigned y,
+             unsigned size = 8,
+             unsigned tile_size = 256);
+    // coordinates of the top left tile
+    unsigned z() const;
+    unsigned x() const;
+    unsigned y() const;
+    // number of tiles across and down, smaller than size at low zoom
+    unsigned columns() const;
+    unsigned rows() const;
+    unsigned tile_size() const;
+    // size of the metatile image in pixels
+    unsigned width() const;
+    unsigned height() const;
+    // extent in spherical mercator
+    box2d<double> extent() const;
+private:
+    unsigned z_;
+    unsigned x_;
+    unsigned y_;
+    unsigned columns_;
+    unsigned rows_;
+    unsigned tile_size_;
+};
+
+struct MAPNIK_DECL metatile_tile
+{
+    metatile_tile(unsigned z_, unsigned x_, unsigned y_, unsigned tile_size)
+        : z(z_), x(x_), y(y_), image(tile_size, tile_size), encoded() {}
+    unsigned z;
+    unsigned x;
+    unsigned y;
+    image_rgba8 image;
+    // only set when render_metatile is given a format
+    std::string encoded;
+};
+
+// Renders the metatile with the agg renderer, querying every layer once
+// for the buffered extent of the whole block, and returns its tiles in
+// row major order. Labels are placed once for the block, so they are
+// consistent across tile edges. The map srs is expected to be spherical
+// mercator. If format is not empty each tile is also encoded with
+// save_to_string (e.g. "png8", "jpeg").
+MAPNIK_DECL std::vector<metatile_tile> render_metatile(Map const& map,
+                                                       metatile const& mt,
+                                                       attributes const& vars = attributes(),
+                                                       double scale_factor = 1.0,
+                                                       std::string const& format = "");
+
+// Same as above, but every tile is encoded with one fixed palette
+// (format e.g. "png8"). With a single encoding thread (p=1, the default)
+// colors quantized for one tile are looked up from the palette's cache
+// for the rest of the block. With p>1 rows are quantized in parallel
+// without that cache, which is not thread safe, so only the palette is
+// shared between tiles.
+MAPNIK_DECL std::vector<metatile_tile> render_metatile(Map const& map,
+                                                       metatile const& mt,
+                                                       std::string const& format,
+                                                       rgba_palette const& palette,
+                                                       attributes const& vars = attributes(),
+                                                       double scale_factor = 1.0);
+
+}
+
+#endif // MAPNIK_METATILE_HPP
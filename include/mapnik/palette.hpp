@@ -114,12 +114,16 @@ public:
     const std::vector<unsigned>& alphaTable() const;
 
     unsigned char quantize(unsigned c) const;
+    // same as quantize() but without the color cache, so it
+    // can be called from several threads at once
+    unsigned char quantize_uncached(unsigned c) const;
 
     bool valid() const;
     std::string to_string() const;
 
 private:
     void parse(std::string const& pal, palette_type type);
+    unsigned char find_nearest(unsigned c) const;
 
 private:
     std::vector<rgba> sorted_pal_;
@@ -29,12 +29,19 @@
 #include <mapnik/hextree.hpp>
 #include <mapnik/miniz_png.hpp>
 #include <mapnik/image.hpp>
+#include <mapnik/util/parallel_for.hpp>
 
 // zlib
 #include <zlib.h>  // for Z_DEFAULT_COMPRESSION
 
 // boost
 
+// stl
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 extern "C"
 {
@@ -50,6 +57,7 @@ struct png_options {
     int compression;
     int strategy;
     int trans_mode;
+    int threads;
     double gamma;
     bool paletted;
     bool use_hextree;
@@ -59,6 +67,7 @@ struct png_options {
         compression(Z_DEFAULT_COMPRESSION),
         strategy(Z_DEFAULT_STRATEGY),
         trans_mode(-1),
+        threads(1),
         gamma(-1),
         paletted(true),
         use_hextree(true),
@@ -79,12 +88,173 @@ void flush_data (png_structp png_ptr)
     out->flush();
 }
 
+template <typename T>
+void write_png_chunk(T & file, char const* type, unsigned char const* data, std::size_t length)
+{
+    unsigned char header[8];
+    header[0] = static_cast<unsigned char>(length >> 24);
+    header[1] = static_cast<unsigned char>(length >> 16);
+    header[2] = static_cast<unsigned char>(length >> 8);
+    header[3] = static_cast<unsigned char>(length);
+    std::memcpy(header + 4, type, 4);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    if (length > 0) crc = crc32(crc, data, length);
+    unsigned char footer[4];
+    footer[0] = static_cast<unsigned char>(crc >> 24);
+    footer[1] = static_cast<unsigned char>(crc >> 16);
+    footer[2] = static_cast<unsigned char>(crc >> 8);
+    footer[3] = static_cast<unsigned char>(crc);
+    file.write(reinterpret_cast<char const*>(header), 8);
+    if (length > 0) file.write(reinterpret_cast<char const*>(data), length);
+    file.write(reinterpret_cast<char const*>(footer), 4);
+}
+
+// Writes a true color png using opts.threads workers, pigz style: the
+// filtered rows are split into bands which are deflated in parallel,
+// each primed with the last 32k of the previous band as dictionary and
+// ended on a byte boundary with a sync flush, so the bands concatenate
+// into a single standard zlib stream. Each band goes in its own IDAT.
+template <typename T1, typename T2>
+void save_as_png_parallel(T1 & file,
+                          T2 const& image,
+                          png_options const& opts)
+{
+    unsigned width = image.width();
+    unsigned height = image.height();
+    bool strip_alpha = (opts.trans_mode == 0);
+    std::size_t pixel_size = strip_alpha ? 3 : 4;
+    std::size_t row_size = 1 + width * pixel_size;
+    std::size_t num_bands = std::max(1u, std::min(static_cast<unsigned>(opts.threads), height));
+    std::size_t band_rows = (height + num_bands - 1) / num_bands;
+    num_bands = (height + band_rows - 1) / band_rows;
+    if (num_bands == 0) num_bands = 1;
+
+    // filter type None, as in the libpng path
+    std::vector<unsigned char> raw(row_size * height);
+    util::parallel_for(height, opts.threads, [&](std::size_t y)
+    {
+        unsigned char * out = &raw[y * row_size];
+        *out++ = 0;
+        unsigned char const* row = reinterpret_cast<unsigned char const*>(image.getRow(y));
+        if (strip_alpha)
+        {
+            for (unsigned x = 0; x < width; ++x)
+            {
+                *out++ = row[x * 4];
+                *out++ = row[x * 4 + 1];
+                *out++ = row[x * 4 + 2];
+            }
+        }
+        else
+        {
+            std::memcpy(out, row, width * 4);
+        }
+    });
+
+    std::vector<std::vector<unsigned char> > bands(num_bands);
+    std::vector<uLong> checksums(num_bands);
+    util::parallel_for(num_bands, opts.threads, [&](std::size_t i)
+    {
+        std::size_t start = i * band_rows * row_size;
+        std::size_t end = std::min((i + 1) * band_rows, static_cast<std::size_t>(height)) * row_size;
+        bool last = (i + 1 == num_bands);
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, opts.compression, Z_DEFLATED, -15, 8, opts.strategy) != Z_OK)
+        {
+            throw std::runtime_error("png: failed to initialize deflate");
+        }
+        if (i > 0)
+        {
+            std::size_t dict_size = std::min(start, static_cast<std::size_t>(32768));
+            deflateSetDictionary(&stream, &raw[start - dict_size], dict_size);
+        }
+        std::vector<unsigned char> & out = bands[i];
+        out.resize(deflateBound(&stream, end - start) + 16);
+        stream.next_in = const_cast<unsigned char*>(&raw[0] + start);
+        stream.avail_in = end - start;
+        stream.next_out = &out[0];
+        stream.avail_out = out.size();
+        int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        bool done = false;
+        while (!done)
+        {
+            int ret = deflate(&stream, flush);
+            if (ret == Z_STREAM_ERROR)
+            {
+                deflateEnd(&stream);
+                throw std::runtime_error("png: deflate failed");
+            }
+            done = last ? (ret == Z_STREAM_END) : (stream.avail_out > 0);
+            if (!done && stream.avail_out == 0)
+            {
+                std::size_t used = out.size();
+                out.resize(out.size() * 2);
+                stream.next_out = &out[0] + used;
+                stream.avail_out = out.size() - used;
+            }
+        }
+        out.resize(out.size() - stream.avail_out);
+        deflateEnd(&stream);
+        checksums[i] = adler32(adler32(0L, Z_NULL, 0), &raw[0] + start, end - start);
+    });
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<char const*>(signature), 8);
+    unsigned char ihdr[13];
+    ihdr[0] = static_cast<unsigned char>(width >> 24);
+    ihdr[1] = static_cast<unsigned char>(width >> 16);
+    ihdr[2] = static_cast<unsigned char>(width >> 8);
+    ihdr[3] = static_cast<unsigned char>(width);
+    ihdr[4] = static_cast<unsigned char>(height >> 24);
+    ihdr[5] = static_cast<unsigned char>(height >> 16);
+    ihdr[6] = static_cast<unsigned char>(height >> 8);
+    ihdr[7] = static_cast<unsigned char>(height);
+    ihdr[8] = 8;
+    ihdr[9] = strip_alpha ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    write_png_chunk(file, "IHDR", ihdr, 13);
+
+    // zlib header with the level hint of the compression used
+    unsigned level_hint = 2;
+    if (opts.compression == 0 || opts.compression == 1) level_hint = 0;
+    else if (opts.compression >= 2 && opts.compression <= 5) level_hint = 1;
+    else if (opts.compression >= 7) level_hint = 3;
+    unsigned zheader = (0x78 << 8) | (level_hint << 6);
+    if (zheader % 31 != 0) zheader += 31 - (zheader % 31);
+    uLong checksum = checksums[0];
+    for (std::size_t i = 1; i < num_bands; ++i)
+    {
+        std::size_t length = std::min((i + 1) * band_rows, static_cast<std::size_t>(height)) * row_size - i * band_rows * row_size;
+        checksum = adler32_combine(checksum, checksums[i], length);
+    }
+    bands.front().insert(bands.front().begin(), { static_cast<unsigned char>(zheader >> 8),
+                                                  static_cast<unsigned char>(zheader & 0xff) });
+    bands.back().insert(bands.back().end(), { static_cast<unsigned char>(checksum >> 24),
+                                              static_cast<unsigned char>(checksum >> 16),
+                                              static_cast<unsigned char>(checksum >> 8),
+                                              static_cast<unsigned char>(checksum) });
+    for (std::vector<unsigned char> const& band : bands)
+    {
+        write_png_chunk(file, "IDAT", band.data(), band.size());
+    }
+    write_png_chunk(file, "IEND", nullptr, 0);
+}
+
 template <typename T1, typename T2>
 void save_as_png(T1 & file,
                 T2 const& image,
                 png_options const& opts)
 
 {
+    if (opts.threads > 1 && !opts.use_miniz && image.width() > 0 && image.height() > 0)
+    {
+        save_as_png_parallel(file, image, opts);
+        return;
+    }
     if (opts.use_miniz)
     {
         MiniZ::PNGWriter writer(opts.compression,opts.strategy);
@@ -586,6 +756,99 @@ void save_as_png8_oct(T1 & file,
 }
 
 
+// Maps colors to palette indices through a small direct mapped cache in
+// front of the quantizer, rendered images repeat few colors. When not
+// shared the quantizer's own color cache, which is not thread safe, is
+// bypassed so that each thread can use its own palette_lookup.
+template <typename T>
+class palette_lookup
+{
+public:
+    palette_lookup(T const& tree, bool shared)
+        : tree_(tree),
+          shared_(shared),
+          keys_(cache_size, 0),
+          values_(cache_size, 0)
+    {
+        // 0 hashes to slot 0 and 1 does not, so no slot starts out valid
+        keys_[0] = 1;
+    }
+
+    byte operator() (unsigned val)
+    {
+        unsigned slot = (val * 2654435761u) >> (32 - cache_bits);
+        if (keys_[slot] != val)
+        {
+            keys_[slot] = val;
+            values_[slot] = lookup(val);
+        }
+        return values_[slot];
+    }
+
+private:
+    static const unsigned cache_bits = 12;
+    static const unsigned cache_size = 1 << cache_bits;
+
+    byte lookup(unsigned val) const
+    {
+        return shared_ ? tree_.quantize(val) : tree_.quantize_uncached(val);
+    }
+
+    T const& tree_;
+    bool shared_;
+    std::vector<unsigned> keys_;
+    std::vector<byte> values_;
+};
+
+// Writes the palette index of every pixel to out with 8 or 4 bits per
+// pixel. With threads > 1 the rows are mapped in bands concurrently.
+template <typename T, typename Quantizer>
+void quantize_rows(T const& image,
+                   Quantizer const& tree,
+                   image_gray8 & out,
+                   unsigned bits_per_pixel,
+                   int threads)
+{
+    unsigned width = image.width();
+    unsigned height = image.height();
+    if (width == 0 || height == 0) return;
+    std::size_t num_bands = 1;
+    if (threads > 1)
+    {
+        num_bands = std::min(static_cast<std::size_t>(height), static_cast<std::size_t>(threads) * 4);
+    }
+    util::parallel_for(num_bands, threads, [&](std::size_t i)
+    {
+        palette_lookup<Quantizer> lookup(tree, num_bands == 1);
+        unsigned y0 = height * i / num_bands;
+        unsigned y1 = height * (i + 1) / num_bands;
+        for (unsigned y = y0; y < y1; ++y)
+        {
+            mapnik::image_rgba8::pixel_type const * row = image.getRow(y);
+            mapnik::image_gray8::pixel_type  * row_out = out.getRow(y);
+            unsigned prev = row[0];
+            byte index = lookup(prev);
+            for (unsigned x = 0; x < width; ++x)
+            {
+                unsigned val = row[x];
+                if (val != prev)
+                {
+                    prev = val;
+                    index = lookup(val);
+                }
+                if (bits_per_pixel == 8)
+                {
+                    row_out[x] = index;
+                }
+                else
+                {
+                    row_out[x>>1] |= (x%2 == 0) ? byte(index<<4) : index;
+                }
+            }
+        }
+    });
+}
+
 template <typename T1, typename T2, typename T3>
 void save_as_png8(T1 & file,
                   T2 const& image,
@@ -601,15 +864,7 @@ void save_as_png8(T1 & file,
     {
         // >16 && <=256 colors -> write 8-bit color depth
         image_gray8 reduced_image(width, height);
-        for (unsigned y = 0; y < height; ++y)
-        {
-            mapnik::image_rgba8::pixel_type const * row = image.getRow(y);
-            mapnik::image_gray8::pixel_type  * row_out = reduced_image.getRow(y);
-            for (unsigned x = 0; x < width; ++x)
-            {
-                row_out[x] = tree.quantize(row[x]);
-            }
-        }
+        quantize_rows(image, tree, reduced_image, 8, opts.threads);
         save_as_png(file, palette, reduced_image, width, height, 8, alphaTable, opts);
     }
     else if (palette.size() == 1)
@@ -627,22 +882,7 @@ void save_as_png8(T1 & file,
         unsigned image_width  = ((width + 7) >> 1) & ~3U; // 4-bit image, round up to 32-bit boundary
         unsigned image_height = height;
         image_gray8 reduced_image(image_width, image_height);
-        for (unsigned y = 0; y < height; ++y)
-        {
-            mapnik::image_rgba8::pixel_type const * row = image.getRow(y);
-            mapnik::image_gray8::pixel_type  * row_out = reduced_image.getRow(y);
-            byte index = 0;
-            for (unsigned x = 0; x < width; ++x)
-            {
-
-                index = tree.quantize(row[x]);
-                if (x%2 == 0)
-                {
-                    index = index<<4;
-                }
-                row_out[x>>1] |= index;
-            }
-        }
+        quantize_rows(image, tree, reduced_image, 4, opts.threads);
         save_as_png(file, palette, reduced_image, width, height, 4, alphaTable, opts);
     }
 }
@@ -61,6 +61,7 @@ struct renderer_common : private util::noncopyable
     box2d<double> query_extent_;
     view_transform t_;
     std::shared_ptr<label_collision_detector4> detector_;
+    unsigned warp_threads_;
 
 private:
     renderer_common(Map const &m, unsigned width, unsigned height, double scale_factor,
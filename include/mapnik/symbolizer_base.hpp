@@ -36,10 +36,12 @@
 #include <mapnik/util/variant.hpp>
 
 // stl
+#include <bitset>
 #include <memory>
 #include <vector>
 #include <iosfwd>
 #include <map>
+#include <utility>
 
 namespace agg { struct trans_affine; }
 
@@ -115,13 +117,114 @@ struct strict_value : value_base_type
         : value_base_type(std::move(obj)) {}
 
 };
+
+// Symbolizer properties ordered by key, with a bitmask of the keys present
+// so that looking up a property that is not set, the common case while
+// rendering, is a single bit test rather than a tree search. The mask holds
+// no references into the map, so it stays valid wherever the symbolizer is
+// moved. Exposes the subset of the std::map interface in use.
+class property_map
+{
+public:
+    using container_type = std::map<keys, strict_value>;
+    using key_type = container_type::key_type;
+    using mapped_type = container_type::mapped_type;
+    using value_type = container_type::value_type;
+    using iterator = container_type::iterator;
+    using const_iterator = container_type::const_iterator;
+    using size_type = container_type::size_type;
+
+    property_map()
+        : items_(),
+          present_() {}
+
+    property_map(property_map const& rhs) = default;
+
+    property_map(property_map && rhs)
+        : items_(std::move(rhs.items_)),
+          present_(rhs.present_)
+    {
+        rhs.items_.clear();
+        rhs.present_.reset();
+    }
+
+    property_map & operator=(property_map const& rhs) = default;
+
+    property_map & operator=(property_map && rhs)
+    {
+        items_ = std::move(rhs.items_);
+        present_ = rhs.present_;
+        rhs.items_.clear();
+        rhs.present_.reset();
+        return *this;
+    }
+
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+    size_type size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+
+    iterator find(key_type key)
+    {
+        return present(key) ? items_.find(key) : items_.end();
+    }
+
+    const_iterator find(key_type key) const
+    {
+        return present(key) ? items_.find(key) : items_.end();
+    }
+
+    size_type count(key_type key) const
+    {
+        return present(key) ? 1 : 0;
+    }
+
+    template <typename T>
+    std::pair<iterator, bool> emplace(key_type key, T && val)
+    {
+        std::pair<iterator, bool> result = items_.emplace(key, std::forward<T>(val));
+        present_.set(static_cast<std::size_t>(key));
+        return result;
+    }
+
+    mapped_type & operator[](key_type key)
+    {
+        present_.set(static_cast<std::size_t>(key));
+        return items_[key];
+    }
+
+    size_type erase(key_type key)
+    {
+        if (!present(key)) return 0;
+        present_.reset(static_cast<std::size_t>(key));
+        return items_.erase(key);
+    }
+
+    void clear()
+    {
+        items_.clear();
+        present_.reset();
+    }
+
+private:
+    bool present(key_type key) const
+    {
+        return present_.test(static_cast<std::size_t>(key));
+    }
+
+    container_type items_;
+    std::bitset<static_cast<std::size_t>(keys::MAX_SYMBOLIZER_KEY)> present_;
+};
+
 }
 
 struct MAPNIK_DECL symbolizer_base
 {
     using value_type = detail::strict_value;
     using key_type =  mapnik::keys;
-    using cont_type = std::map<key_type, value_type>;
+    using cont_type = detail::property_map;
     cont_type properties;
 };
 
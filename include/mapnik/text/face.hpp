@@ -35,6 +35,9 @@ extern "C"
 #include FT_STROKER_H
 }
 
+// harfbuzz
+struct hb_font_t;
+
 //stl
 #include <unordered_map>
 #include <memory>
@@ -47,7 +50,7 @@ namespace mapnik
 class font_face : util::noncopyable
 {
 public:
-    font_face(FT_Face face);
+    font_face(FT_Face face, std::string const& file_name);
 
     std::string family_name() const
     {
@@ -64,6 +67,22 @@ public:
         return face_;
     }
 
+    // font file and index of the face within it, together they identify
+    // the face across face managers
+    std::string const& file_name() const
+    {
+        return file_name_;
+    }
+
+    long face_index() const
+    {
+        return face_->face_index;
+    }
+
+    // harfbuzz font for shaping, created on first use and kept for
+    // the lifetime of the face
+    hb_font_t * hb_font();
+
     bool set_character_sizes(double size);
     bool set_unscaled_character_sizes();
 
@@ -73,6 +92,8 @@ public:
 
 private:
     FT_Face face_;
+    std::string file_name_;
+    hb_font_t * hb_font_;
 };
 using face_ptr = std::shared_ptr<font_face>;
 
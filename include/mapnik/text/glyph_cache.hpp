@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_TEXT_GLYPH_CACHE_HPP
+#define MAPNIK_TEXT_GLYPH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// 8 bit coverage of a rasterized glyph, positioned like an FT_BitmapGlyph
+// rendered at the subpixel offset of its key
+struct glyph_bitmap
+{
+    int left = 0;
+    int top = 0;
+    unsigned width = 0;
+    unsigned rows = 0;
+    std::vector<unsigned char> buffer;
+};
+
+using glyph_bitmap_ptr = std::shared_ptr<glyph_bitmap const>;
+
+struct glyph_bitmap_key
+{
+    // face identity, see font_face::file_name() and face_index()
+    std::string font_file;
+    long face_index;
+    unsigned glyph_index;
+    // character size and halo radius in 26.6
+    long size;
+    long halo_radius;
+    // rotation as FT 16.16 matrix
+    long xx;
+    long xy;
+    long yx;
+    long yy;
+    // subpixel offset in 26.6, within [0, 64)
+    int dx;
+    int dy;
+
+    bool operator==(glyph_bitmap_key const& rhs) const
+    {
+        return glyph_index == rhs.glyph_index &&
+            size == rhs.size &&
+            halo_radius == rhs.halo_radius &&
+            xx == rhs.xx && xy == rhs.xy && yx == rhs.yx && yy == rhs.yy &&
+            dx == rhs.dx && dy == rhs.dy &&
+            face_index == rhs.face_index &&
+            font_file == rhs.font_file;
+    }
+};
+
+struct glyph_bitmap_key_hash
+{
+    std::size_t operator()(glyph_bitmap_key const& key) const;
+};
+
+// Process wide LRU cache of glyph and halo bitmaps shared by all agg text
+// renderers, bounded by the memory held in bitmaps. Bitmaps are spread
+// over shards by glyph index, each with its own lock and an equal part
+// of the capacity, so renderers on several threads rarely wait on each
+// other.
+// Subpixel offsets are rounded to 64 / subpixel_steps units and, with
+// rotation_steps > 0, glyph rotations to whole turns / rotation_steps
+// before rasterizing. The defaults (64 subpixel steps, exact rotations)
+// keep output identical to uncached rendering; fewer steps (e.g. 4
+// subpixel and 360 rotation steps) trade exact placement for many more
+// cache hits, notably for labels following lines.
+class MAPNIK_DECL glyph_cache :
+        public singleton<glyph_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<glyph_cache>;
+public:
+    static constexpr std::size_t num_shards = 16;
+    glyph_bitmap_ptr find(glyph_bitmap_key const& key);
+    void insert(glyph_bitmap_key const& key, glyph_bitmap_ptr const& bitmap);
+    void clear();
+    // number of cached bitmaps
+    std::size_t size() const;
+    // approximate bytes held by cached bitmaps and their keys
+    std::size_t memory_usage() const;
+    // maximum memory usage in bytes, 0 disables the cache
+    void set_capacity(std::size_t capacity);
+    std::size_t capacity() const;
+    void set_subpixel_steps(unsigned steps);
+    unsigned subpixel_steps() const;
+    // rotation buckets per turn, 0 keeps rotations exact
+    void set_rotation_steps(unsigned steps);
+    unsigned rotation_steps() const;
+private:
+    glyph_cache();
+    using shard_type = util::lru_cache<glyph_bitmap_key, glyph_bitmap_ptr, glyph_bitmap_key_hash>;
+    shard_type & shard(glyph_bitmap_key const& key);
+    std::array<shard_type, num_shards> shards_;
+    std::atomic<std::size_t> capacity_;
+    std::atomic<unsigned> subpixel_steps_;
+    std::atomic<unsigned> rotation_steps_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_GLYPH_CACHE_HPP
@@ -28,9 +28,12 @@
 #include <mapnik/text/text_line.hpp>
 #include <mapnik/text/face.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
+#include <mapnik/text/shaping_cache.hpp>
 
 // stl
 #include <list>
+#include <memory>
+#include <string>
 #include <type_traits>
 
 // harfbuzz
@@ -58,6 +61,94 @@ static inline const uint16_t * uchar_to_utf16(const UChar* src)
 
 struct harfbuzz_shaper
 {
+// identifies the faces of a set by font file and face index, names
+// can be shared by different files
+static std::string face_ids(font_face_set & face_set)
+{
+    std::string ids;
+    for (auto const& face : face_set)
+    {
+        ids += face->file_name();
+        ids += '\0';
+        ids += std::to_string(face->face_index());
+        ids += '\0';
+    }
+    return ids;
+}
+
+// Shape one text item with the first face of the set that has all
+// glyphs (or the last face). Metrics are kept unscaled and scaled
+// when the run is added to a line.
+static shaped_run_ptr shape_item(value_unicode_string const& text,
+                                 text_item const& item,
+                                 font_face_set & face_set,
+                                 font_feature_settings const& ff_settings,
+                                 hb_script_t script,
+                                 hb_direction_t direction,
+                                 hb_buffer_t * buffer)
+{
+    // hb_ft fonts take their scale from the face size at creation
+    face_set.set_unscaled_character_sizes();
+    std::size_t num_faces = face_set.size();
+    std::size_t pos = 0;
+    for (auto const& face : face_set)
+    {
+        ++pos;
+        hb_buffer_clear_contents(buffer);
+        hb_buffer_add_utf16(buffer, uchar_to_utf16(text.getBuffer()), text.length(), item.start, item.end - item.start);
+        hb_buffer_set_direction(buffer, direction);
+        hb_buffer_set_script(buffer, script);
+        hb_shape(face->hb_font(), buffer, ff_settings.get_features(), ff_settings.count());
+
+        unsigned num_glyphs = hb_buffer_get_length(buffer);
+
+        hb_glyph_info_t *glyphs = hb_buffer_get_glyph_infos(buffer, nullptr);
+        hb_glyph_position_t *positions = hb_buffer_get_glyph_positions(buffer, nullptr);
+
+        bool font_has_all_glyphs = true;
+        // Check if all glyphs are valid.
+        for (unsigned i=0; i<num_glyphs; ++i)
+        {
+            if (!glyphs[i].codepoint)
+            {
+                font_has_all_glyphs = false;
+                break;
+            }
+        }
+        if (!font_has_all_glyphs && (pos < num_faces))
+        {
+            //Try next font in fontset
+            continue;
+        }
+
+        auto run = std::make_shared<shaped_run>();
+        run->face_index = pos - 1;
+        run->glyphs.reserve(num_glyphs);
+        for (unsigned i=0; i<num_glyphs; ++i)
+        {
+            auto const& glyph_pos = positions[i];
+            auto const& glyph = glyphs[i];
+            glyph_info g(glyph.codepoint, glyph.cluster, item.format_);
+            if (face->glyph_dimensions(g))
+            {
+                shaped_glyph shaped;
+                shaped.glyph_index = glyph.codepoint;
+                shaped.char_index = glyph.cluster;
+                shaped.unscaled_ymin = g.unscaled_ymin;
+                shaped.unscaled_ymax = g.unscaled_ymax;
+                //Overwrite default advance with better value provided by HarfBuzz
+                shaped.unscaled_advance = glyph_pos.x_advance;
+                shaped.unscaled_line_height = g.unscaled_line_height;
+                shaped.unscaled_x_offset = glyph_pos.x_offset;
+                shaped.unscaled_y_offset = glyph_pos.y_offset;
+                run->glyphs.push_back(shaped);
+            }
+        }
+        return run;
+    }
+    return shaped_run_ptr();
+}
+
 static void shape_text(text_line & line,
                        text_itemizer & itemizer,
                        std::map<unsigned,double> & width_map,
@@ -77,73 +168,54 @@ static void shape_text(text_line & line,
     const std::unique_ptr<hb_buffer_t, decltype(hb_buffer_deleter)> buffer(hb_buffer_create(),hb_buffer_deleter);
     hb_buffer_pre_allocate(buffer.get(), length);
     mapnik::value_unicode_string const& text = itemizer.text();
+    shaping_cache & cache = shaping_cache::instance();
 
     for (auto const& text_item : list)
     {
         face_set_ptr face_set = font_manager.get_face_set(text_item.format_->face_name, text_item.format_->fontset);
         double size = text_item.format_->text_size * scale_factor;
-        face_set->set_unscaled_character_sizes();
-        std::size_t num_faces = face_set->size();
-        std::size_t pos = 0;
         font_feature_settings const& ff_settings = text_item.format_->ff_settings;
-        for (auto const& face : *face_set)
+
+        shaping_key key;
+        key.text = text;
+        key.start = text_item.start;
+        key.end = text_item.end;
+        key.size = static_cast<long>(size * 64);
+        key.faces = face_ids(*face_set);
+        key.features = ff_settings.features();
+        key.script = _icu_script_to_script(text_item.script);
+        key.direction = (text_item.dir == UBIDI_RTL)?HB_DIRECTION_RTL:HB_DIRECTION_LTR;
+
+        shaped_run_ptr run = cache.find(key);
+        if (!run)
         {
-            ++pos;
-            hb_buffer_clear_contents(buffer.get());
-            hb_buffer_add_utf16(buffer.get(), uchar_to_utf16(text.getBuffer()), text.length(), text_item.start, text_item.end - text_item.start);
-            hb_buffer_set_direction(buffer.get(), (text_item.dir == UBIDI_RTL)?HB_DIRECTION_RTL:HB_DIRECTION_LTR);
-            hb_buffer_set_script(buffer.get(), _icu_script_to_script(text_item.script));
-            hb_font_t *font(hb_ft_font_create(face->get_face(), nullptr));
-            hb_shape(font, buffer.get(), ff_settings.get_features(), ff_settings.count());
-            hb_font_destroy(font);
-
-            unsigned num_glyphs = hb_buffer_get_length(buffer.get());
-
-            hb_glyph_info_t *glyphs = hb_buffer_get_glyph_infos(buffer.get(), nullptr);
-            hb_glyph_position_t *positions = hb_buffer_get_glyph_positions(buffer.get(), nullptr);
-
-            bool font_has_all_glyphs = true;
-            // Check if all glyphs are valid.
-            for (unsigned i=0; i<num_glyphs; ++i)
-            {
-                if (!glyphs[i].codepoint)
-                {
-                    font_has_all_glyphs = false;
-                    break;
-                }
-            }
-            if (!font_has_all_glyphs && (pos < num_faces))
-            {
-                //Try next font in fontset
-                continue;
-            }
+            run = shape_item(text, text_item, *face_set, ff_settings, key.script, key.direction, buffer.get());
+            if (!run) continue;
+            cache.insert(key, run);
+        }
 
-            std::shared_ptr<value_unicode_string> curr_string(new value_unicode_string());
-            text.extract(text_item.start, text_item.end - text_item.start, *curr_string.get());
-            double max_glyph_height = 0;
-            for (unsigned i=0; i<num_glyphs; ++i)
-            {
-                auto const& pos = positions[i];
-                auto const& glyph = glyphs[i];
-                unsigned char_index = glyph.cluster;
-                glyph_info g(glyph.codepoint,char_index,text_item.format_);
-                g.string_value = curr_string;
-                if (face->glyph_dimensions(g))
-                {
-                    g.face = face;
-                    g.scale_multiplier = size / face->get_face()->units_per_EM;
-                    //Overwrite default advance with better value provided by HarfBuzz
-                    g.unscaled_advance = pos.x_advance;
-                    g.offset.set(pos.x_offset * g.scale_multiplier, pos.y_offset * g.scale_multiplier);
-                    double tmp_height = g.height();
-                    if (tmp_height > max_glyph_height) max_glyph_height = tmp_height;
-                    width_map[char_index] += g.advance();
-                    line.add_glyph(std::move(g), scale_factor);
-                }
-            }
-            line.update_max_char_height(max_glyph_height);
-            break; //When we reach this point the current font had all glyphs.
+        face_ptr const& face = *(face_set->begin() + run->face_index);
+        double scale_multiplier = size / face->get_face()->units_per_EM;
+        std::shared_ptr<value_unicode_string> curr_string(new value_unicode_string());
+        text.extract(text_item.start, text_item.end - text_item.start, *curr_string.get());
+        double max_glyph_height = 0;
+        for (shaped_glyph const& shaped : run->glyphs)
+        {
+            glyph_info g(shaped.glyph_index, shaped.char_index, text_item.format_);
+            g.string_value = curr_string;
+            g.face = face;
+            g.unscaled_ymin = shaped.unscaled_ymin;
+            g.unscaled_ymax = shaped.unscaled_ymax;
+            g.unscaled_advance = shaped.unscaled_advance;
+            g.unscaled_line_height = shaped.unscaled_line_height;
+            g.scale_multiplier = scale_multiplier;
+            g.offset.set(shaped.unscaled_x_offset * scale_multiplier, shaped.unscaled_y_offset * scale_multiplier);
+            double tmp_height = g.height();
+            if (tmp_height > max_glyph_height) max_glyph_height = tmp_height;
+            width_map[shaped.char_index] += g.advance();
+            line.add_glyph(std::move(g), scale_factor);
         }
+        line.update_max_char_height(max_glyph_height);
     }
 }
 };
@@ -86,6 +86,9 @@ public:
     void render(glyph_positions const& positions);
 private:
     pixmap_type & pixmap_;
+    // render through the shared glyph_cache, only valid when
+    // transform_ and halo_transform_ are pure translations
+    void render_cached(glyph_positions const& positions);
     void render_halo(FT_Bitmap_ *bitmap, unsigned rgba, int x, int y,
                      double halo_radius, double opacity,
                      composite_mode_e comp_op);
@@ -0,0 +1,127 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_TEXT_SHAPING_CACHE_HPP
+#define MAPNIK_TEXT_SHAPING_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/value_types.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/text/font_feature_settings.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// icu
+#include <unicode/unistr.h>
+
+// harfbuzz
+#include <harfbuzz/hb.h>
+
+namespace mapnik
+{
+
+// Glyph of a shaped text item. All metrics are in font units
+// (unscaled) and are scaled to the text size when the run is laid out.
+struct shaped_glyph
+{
+    unsigned glyph_index;
+    unsigned char_index;
+    double unscaled_ymin;
+    double unscaled_ymax;
+    double unscaled_advance;
+    double unscaled_line_height;
+    double unscaled_x_offset;
+    double unscaled_y_offset;
+};
+
+struct shaped_run
+{
+    // index of the face in the face set that shaped the item
+    unsigned face_index = 0;
+    std::vector<shaped_glyph> glyphs;
+};
+
+using shaped_run_ptr = std::shared_ptr<shaped_run const>;
+
+struct shaping_key
+{
+    // whole itemized text, shaping uses context around the item
+    value_unicode_string text;
+    unsigned start;
+    unsigned end;
+    // text size in 26.6, runs are not shared between sizes
+    long size;
+    // font file and face index of each face in the face set
+    std::string faces;
+    font_feature_settings::feature_vector features;
+    hb_script_t script;
+    hb_direction_t direction;
+
+    bool operator==(shaping_key const& rhs) const
+    {
+        return start == rhs.start &&
+            end == rhs.end &&
+            size == rhs.size &&
+            script == rhs.script &&
+            direction == rhs.direction &&
+            text == rhs.text &&
+            faces == rhs.faces &&
+            features == rhs.features;
+    }
+};
+
+struct shaping_key_hash
+{
+    std::size_t operator()(shaping_key const& key) const;
+};
+
+// Process wide LRU cache of shaped text items, so labels repeated across
+// features and tiles are only shaped by harfbuzz once.
+class MAPNIK_DECL shaping_cache :
+        public singleton<shaping_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<shaping_cache>;
+public:
+    shaped_run_ptr find(shaping_key const& key);
+    void insert(shaping_key const& key, shaped_run_ptr const& run);
+    void clear();
+    std::size_t size() const;
+    // maximum number of runs, 0 disables the cache
+    void set_capacity(std::size_t capacity);
+    std::size_t capacity() const;
+private:
+    shaping_cache();
+    util::lru_cache<shaping_key, shaped_run_ptr, shaping_key_hash> runs_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_SHAPING_CACHE_HPP
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_TIFF_TILE_CACHE_HPP
+#define MAPNIK_TIFF_TILE_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// decoded pixels of one tiff tile, laid out as read by the tiff reader
+using tiff_tile_ptr = std::shared_ptr<std::vector<std::uint8_t> const>;
+
+struct tiff_tile_key
+{
+    std::string file_name;
+    std::time_t modified;
+    // tiff directory (image or overview) and tile origin in its pixels
+    unsigned directory;
+    unsigned x;
+    unsigned y;
+    // tile expanded to rgba8 instead of raw samples
+    bool rgba;
+
+    bool operator==(tiff_tile_key const& rhs) const
+    {
+        return x == rhs.x && y == rhs.y &&
+            directory == rhs.directory &&
+            rgba == rhs.rgba &&
+            modified == rhs.modified &&
+            file_name == rhs.file_name;
+    }
+};
+
+struct tiff_tile_key_hash
+{
+    std::size_t operator()(tiff_tile_key const& key) const;
+};
+
+// Process wide LRU cache of decoded tiles of tiled tiff files, shared by
+// all tiff readers so repeated renders of the same area skip decompression.
+// The capacity is a budget in bytes of decoded pixels.
+class MAPNIK_DECL tiff_tile_cache :
+        public singleton<tiff_tile_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<tiff_tile_cache>;
+public:
+    tiff_tile_ptr find(tiff_tile_key const& key);
+    void insert(tiff_tile_key const& key, tiff_tile_ptr const& tile);
+    void clear();
+    // number of cached tiles
+    std::size_t size() const;
+    // bytes of cached tiles
+    std::size_t memory_usage() const;
+    // maximum bytes of cached tiles, 0 disables the cache
+    void set_capacity(std::size_t capacity);
+    std::size_t capacity() const;
+private:
+    tiff_tile_cache();
+    util::lru_cache<tiff_tile_key, tiff_tile_ptr, tiff_tile_key_hash> tiles_;
+};
+
+}
+
+#endif // MAPNIK_TIFF_TILE_CACHE_HPP
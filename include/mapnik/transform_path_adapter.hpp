@@ -28,10 +28,12 @@
 #include <mapnik/config.hpp>
 
 #include <cstddef>
+#include <cmath>
+#include <vector>
 
 namespace mapnik  {
 
-template <typename Transform, typename Geometry>
+template <typename Transform, typename Geometry, typename ProjTransform = proj_transform>
 struct transform_path_adapter
 {
     // SFINAE value_type detector
@@ -58,55 +60,62 @@ struct transform_path_adapter
 
     transform_path_adapter(Transform const& t,
                            Geometry & geom,
-                           proj_transform const& prj_trans)
+                           ProjTransform const& prj_trans)
         : t_(&t),
           geom_(geom),
-          prj_trans_(&prj_trans)  {}
+          prj_trans_(&prj_trans),
+          pos_(0),
+          ready_(false) {}
 
     explicit transform_path_adapter(Geometry & geom)
         : t_(0),
           geom_(geom),
-          prj_trans_(0)  {}
+          prj_trans_(0),
+          pos_(0),
+          ready_(false) {}
 
-    void set_proj_trans(proj_transform const& prj_trans)
+    void set_proj_trans(ProjTransform const& prj_trans)
     {
         prj_trans_ = &prj_trans;
+        ready_ = false;
     }
 
     void set_trans(Transform  const& t)
     {
         t_ = &t;
+        ready_ = false;
     }
 
     unsigned vertex(double *x, double *y) const
     {
-        unsigned command;
-        bool ok = false;
-        bool skipped_points = false;
-        while (!ok)
+        if (prj_trans_->equal())
         {
-            command = geom_.vertex(x,y);
-            if (command == SEG_END)
+            // nothing to reproject, stream straight from the source
+            unsigned command = geom_.vertex(x, y);
+            if (command != SEG_END)
             {
-                return command;
-            }
-            double z=0;
-            ok = prj_trans_->backward(*x, *y, z);
-            if (!ok) {
-                skipped_points = true;
+                t_->forward(x, y);
             }
+            return command;
         }
-        if (skipped_points && (command == SEG_LINETO))
+        if (!ready_)
         {
-            command = SEG_MOVETO;
+            transform_path();
         }
-        t_->forward(x,y);
-        return command;
+        if (pos_ >= cmds_.size())
+        {
+            return SEG_END;
+        }
+        *x = xs_[pos_];
+        *y = ys_[pos_];
+        return cmds_[pos_++];
     }
 
     void rewind(unsigned pos) const
     {
         geom_.rewind(pos);
+        pos_ = 0;
+        ready_ = false;
     }
 
     unsigned type() const
@@ -120,9 +129,121 @@ struct transform_path_adapter
     }
 
 private:
+    // Pulls the whole path from the source and transforms it in bulk:
+    // one proj_transform call for all vertices, then one call for the
+    // view transform. If the bulk reprojection fails the path is
+    // re-read and reprojected per vertex, dropping the failed points.
+    void transform_path() const
+    {
+        xs_.clear();
+        ys_.clear();
+        cmds_.clear();
+        pos_ = 0;
+        ready_ = true;
+        double x = 0;
+        double y = 0;
+        unsigned command;
+        while ((command = geom_.vertex(&x,&y)) != SEG_END)
+        {
+            xs_.push_back(x);
+            ys_.push_back(y);
+            cmds_.push_back(command);
+        }
+        if (cmds_.empty()) return;
+        if (!prj_trans_->backward(xs_.data(), ys_.data(), nullptr, static_cast<int>(cmds_.size())))
+        {
+            geom_.rewind(0);
+            transform_path_per_vertex();
+        }
+        else
+        {
+            remove_failed_points();
+        }
+        forward_path(*t_, xs_.data(), ys_.data(), cmds_.size(), 0);
+    }
+
+    // view transforms over whole arrays when Transform provides it
+    template <typename T>
+    static auto forward_path(T const& t, double * xs, double * ys, std::size_t size, int)
+        -> decltype(t.forward(xs, ys, size), void())
+    {
+        t.forward(xs, ys, size);
+    }
+
+    template <typename T>
+    static void forward_path(T const& t, double * xs, double * ys, std::size_t size, long)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            t.forward(xs + i, ys + i);
+        }
+    }
+
+    // proj4 marks points it could not transform in a bulk call with HUGE_VAL
+    void remove_failed_points() const
+    {
+        std::size_t size = cmds_.size();
+        std::size_t count = 0;
+        bool skipped_points = false;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (xs_[i] == HUGE_VAL || ys_[i] == HUGE_VAL)
+            {
+                skipped_points = true;
+                continue;
+            }
+            unsigned char command = cmds_[i];
+            if (skipped_points && (command == SEG_LINETO))
+            {
+                command = SEG_MOVETO;
+            }
+            skipped_points = false;
+            xs_[count] = xs_[i];
+            ys_[count] = ys_[i];
+            cmds_[count] = command;
+            ++count;
+        }
+        xs_.resize(count);
+        ys_.resize(count);
+        cmds_.resize(count);
+    }
+
+    void transform_path_per_vertex() const
+    {
+        xs_.clear();
+        ys_.clear();
+        cmds_.clear();
+        bool skipped_points = false;
+        double x = 0;
+        double y = 0;
+        unsigned command;
+        while ((command = geom_.vertex(&x,&y)) != SEG_END)
+        {
+            double z = 0;
+            if (!prj_trans_->backward(x, y, z))
+            {
+                skipped_points = true;
+                continue;
+            }
+            if (skipped_points && (command == SEG_LINETO))
+            {
+                command = SEG_MOVETO;
+            }
+            skipped_points = false;
+            xs_.push_back(x);
+            ys_.push_back(y);
+            cmds_.push_back(command);
+        }
+    }
+
     Transform const* t_;
     Geometry & geom_;
-    proj_transform const* prj_trans_;
+    ProjTransform const* prj_trans_;
+    mutable std::vector<double> xs_;
+    mutable std::vector<double> ys_;
+    mutable std::vector<unsigned char> cmds_;
+    mutable std::size_t pos_;
+    mutable bool ready_;
 };
 
 
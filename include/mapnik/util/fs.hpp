@@ -27,6 +27,7 @@
 #include <mapnik/config.hpp>
 
 // stl
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,7 @@ MAPNIK_DECL std::string make_absolute(std::string const& filepath, std::string c
 MAPNIK_DECL std::string dirname(std::string const& value);
 MAPNIK_DECL std::string basename(std::string const& value);
 MAPNIK_DECL std::vector<std::string> list_directory(std::string const& value);
+MAPNIK_DECL std::time_t last_write_time(std::string const& value);
 
 }}
 
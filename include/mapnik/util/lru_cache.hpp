@@ -0,0 +1,220 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_LRU_CACHE_HPP
+#define MAPNIK_UTIL_LRU_CACHE_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/unique_lock.hpp>
+#endif
+
+// stl
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <tuple>
+#include <unordered_map>
+
+namespace mapnik { namespace util {
+
+// Least recently used cache of values by key, bounded by the total cost
+// of its entries (e.g. bytes, or 1 per entry to bound their number).
+// Values are handed out by copy, so they are normally shared pointers
+// that stay valid after their entry is evicted; find() returns a default
+// constructed value on a miss. All members are thread safe when built
+// with MAPNIK_THREADSAFE.
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class lru_cache : private util::noncopyable
+{
+    // key, value and cost of an entry
+    using entry_list = std::list<std::tuple<Key, Value, std::size_t> >;
+public:
+    explicit lru_cache(std::size_t capacity = 0)
+        : items_(),
+          index_(),
+          capacity_(capacity),
+          usage_(0),
+          hits_(0),
+          misses_(0) {}
+
+    Value find(Key const& key)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr == index_.end())
+        {
+            ++misses_;
+            return Value();
+        }
+        ++hits_;
+        // move to front as most recently used
+        items_.splice(items_.begin(), items_, itr->second);
+        return std::get<1>(*itr->second);
+    }
+
+    // inserts or replaces the value of key, evicting least recently used
+    // entries beyond the capacity; entries costing more than the whole
+    // capacity are not inserted
+    bool insert(Key const& key, Value const& value, std::size_t cost = 1)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        if (cost > capacity_ || capacity_ == 0) return false;
+        auto itr = index_.find(key);
+        if (itr != index_.end())
+        {
+            usage_ -= std::get<2>(*itr->second);
+            std::get<1>(*itr->second) = value;
+            std::get<2>(*itr->second) = cost;
+            items_.splice(items_.begin(), items_, itr->second);
+        }
+        else
+        {
+            items_.emplace_front(key, value, cost);
+            index_.emplace(key, items_.begin());
+        }
+        usage_ += cost;
+        evict();
+        return true;
+    }
+
+    // drops the entries for which pred(key, value) is true
+    template <typename Predicate>
+    void erase_if(Predicate pred)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        for (auto itr = items_.begin(); itr != items_.end();)
+        {
+            if (pred(std::get<0>(*itr), std::get<1>(*itr)))
+            {
+                usage_ -= std::get<2>(*itr);
+                index_.erase(std::get<0>(*itr));
+                itr = items_.erase(itr);
+            }
+            else ++itr;
+        }
+    }
+
+    void clear()
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        index_.clear();
+        items_.clear();
+        usage_ = 0;
+    }
+
+    // number of entries
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        return items_.size();
+    }
+
+    // total cost of the entries
+    std::size_t usage() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        return usage_;
+    }
+
+    // maximum total cost, 0 disables the cache
+    void set_capacity(std::size_t capacity)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        capacity_ = capacity;
+        evict();
+    }
+
+    std::size_t capacity() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        return capacity_;
+    }
+
+    // lookups that found and missed an entry since the last reset
+    std::size_t hits() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        return hits_;
+    }
+
+    std::size_t misses() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        return misses_;
+    }
+
+    void reset_stats()
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+private:
+    void evict()
+    {
+        while (usage_ > capacity_)
+        {
+            usage_ -= std::get<2>(items_.back());
+            index_.erase(std::get<0>(items_.back()));
+            items_.pop_back();
+        }
+    }
+
+    entry_list items_;
+    std::unordered_map<Key, typename entry_list::iterator, Hash> index_;
+    std::size_t capacity_;
+    std::size_t usage_;
+    std::size_t hits_;
+    std::size_t misses_;
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+};
+
+}}
+
+#endif // MAPNIK_UTIL_LRU_CACHE_HPP
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_PARALLEL_FOR_HPP
+#define MAPNIK_UTIL_PARALLEL_FOR_HPP
+
+// stl
+#include <cstddef>
+#include <exception>
+#include <vector>
+#include <algorithm>
+
+#ifdef MAPNIK_THREADSAFE
+#include <atomic>
+#include <thread>
+#endif
+
+namespace mapnik { namespace util {
+
+// Calls func(i) for every i in [0, count) using at most `threads` workers.
+// Work items are handed out dynamically, so unbalanced tasks (e.g. a slow
+// datasource query next to a fast one) do not stall the others.
+// The calling thread takes part in the work. The first exception thrown
+// by any task (in index order) is rethrown once all workers have joined.
+// Without MAPNIK_THREADSAFE or with threads <= 1 this is a plain loop.
+template <typename F>
+void parallel_for(std::size_t count, unsigned threads, F && func)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::size_t num_workers = std::min(static_cast<std::size_t>(threads), count);
+    if (num_workers > 1)
+    {
+        std::vector<std::exception_ptr> errors(count);
+        std::atomic<std::size_t> next(0);
+        auto worker = [&]()
+        {
+            std::size_t i;
+            while ((i = next++) < count)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(num_workers - 1);
+        for (std::size_t t = 1; t < num_workers; ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread & th : pool)
+        {
+            th.join();
+        }
+        for (std::exception_ptr const& ex : errors)
+        {
+            if (ex) std::rethrow_exception(ex);
+        }
+        return;
+    }
+#endif
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        func(i);
+    }
+}
+
+}}
+
+#endif // MAPNIK_UTIL_PARALLEL_FOR_HPP
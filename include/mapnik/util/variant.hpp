@@ -582,9 +582,16 @@ public:
 
     friend void swap(variant<Types...> & first, variant<Types...> & second)
     {
-        using std::swap; //enable ADL
-        swap(first.type_index, second.type_index);
-        swap(first.data, second.data);
+        // swap through move construction: values holding pointers into
+        // themselves (e.g. std::map) can't be swapped bytewise
+        if (&first == &second) return;
+        variant<Types...> tmp(std::move(first));
+        helper_type::destroy(first.type_index, &first.data);
+        first.type_index = second.type_index;
+        helper_type::move(second.type_index, &second.data, &first.data);
+        helper_type::destroy(second.type_index, &second.data);
+        second.type_index = tmp.type_index;
+        helper_type::move(tmp.type_index, &tmp.data, &second.data);
     }
 
     VARIANT_INLINE variant<Types...>& operator=(variant<Types...> other)
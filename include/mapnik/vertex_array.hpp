@@ -0,0 +1,116 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_VERTEX_ARRAY_HPP
+#define MAPNIK_VERTEX_ARRAY_HPP
+
+// mapnik
+#include <mapnik/vertex.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+namespace mapnik
+{
+
+// Geometry storage keeping all coordinates in one contiguous
+// array (x0,y0,x1,y1,...) and the commands in a parallel byte array.
+// Unlike vertex_vector it can be sized up front with reserve() and
+// exposes both arrays for bulk processing.
+template <typename T>
+class vertex_array : private util::noncopyable
+{
+    using coord_type = T;
+public:
+    // required for iterators support
+    using value_type = std::tuple<unsigned,coord_type,coord_type>;
+    using size_type = std::size_t;
+    using command_size = std::uint8_t;
+private:
+    std::vector<coord_type> vertices_;
+    std::vector<command_size> commands_;
+
+public:
+
+    vertex_array()
+        : vertices_(),
+          commands_() {}
+
+    size_type size() const
+    {
+        return commands_.size();
+    }
+
+    void reserve(size_type size)
+    {
+        vertices_.reserve(size * 2);
+        commands_.reserve(size);
+    }
+
+    void push_back (coord_type x,coord_type y,command_size command)
+    {
+        vertices_.push_back(x);
+        vertices_.push_back(y);
+        commands_.push_back(command);
+    }
+
+    unsigned get_vertex(unsigned pos,coord_type* x,coord_type* y) const
+    {
+        if (pos >= commands_.size()) return SEG_END;
+        const coord_type* vertex = vertices_.data() + (pos << 1);
+        *x = vertex[0];
+        *y = vertex[1];
+        return commands_[pos];
+    }
+
+    void set_command(unsigned pos, unsigned command)
+    {
+        if (pos < commands_.size())
+        {
+            commands_[pos] = command;
+        }
+    }
+
+    // size() * 2 interleaved coordinates
+    coord_type const* vertices() const
+    {
+        return vertices_.data();
+    }
+
+    coord_type * vertices()
+    {
+        return vertices_.data();
+    }
+
+    // size() commands
+    command_size const* commands() const
+    {
+        return commands_.data();
+    }
+};
+
+}
+
+#endif // MAPNIK_VERTEX_ARRAY_HPP
@@ -88,6 +88,15 @@ public:
         return pos_;
     }
 
+    void reserve(size_type size)
+    {
+        size_type blocks = (size + block_mask) >> block_shift;
+        while (num_blocks_ < blocks)
+        {
+            allocate_block(num_blocks_);
+        }
+    }
+
     void push_back (coord_type x,coord_type y,command_size command)
     {
         size_type block = pos_ >> block_shift;
@@ -38,13 +38,18 @@ MAPNIK_DECL void reproject_and_scale_raster(raster & target,
                                             proj_transform const& prj_trans,
                                             double offset_x, double offset_y,
                                             unsigned mesh_size,
-                                            scaling_method_e scaling_method);
+                                            scaling_method_e scaling_method,
+                                            unsigned threads = 1);
 
 
+// Mesh points on the source raster's pixel grid are shared between windows
+// of the same raster through warp_mesh_cache; with threads > 1 bands of
+// target rows are rasterized concurrently.
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                              box2d<double> const& target_ext, box2d<double> const& source_ext,
-                             double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor);
+                             double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
+                             unsigned threads = 1);
 }
 
 #endif // MAPNIK_WARP_HPP
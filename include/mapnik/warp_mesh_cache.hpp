@@ -0,0 +1,114 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_WARP_MESH_CACHE_HPP
+#define MAPNIK_WARP_MESH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Points of a source raster's native pixel grid, one every mesh_size
+// pixels, reprojected into map coordinates of the target projection.
+// A block holds block_size x block_size points, row major.
+struct warp_mesh_block
+{
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+using warp_mesh_block_ptr = std::shared_ptr<warp_mesh_block const>;
+
+struct warp_mesh_key
+{
+    // proj4 parameters of the target (map) and source (layer) projections
+    std::string target_srs;
+    std::string source_srs;
+    // pixel size of the source raster and the offset of its pixel grid
+    // from the origin of the source projection, in pixels
+    double res_x;
+    double res_y;
+    double phase_x;
+    double phase_y;
+    unsigned mesh_size;
+    // block position in the grid, in block_size points
+    std::int64_t block_x;
+    std::int64_t block_y;
+
+    bool operator==(warp_mesh_key const& rhs) const
+    {
+        return block_x == rhs.block_x && block_y == rhs.block_y &&
+            mesh_size == rhs.mesh_size &&
+            res_x == rhs.res_x && res_y == rhs.res_y &&
+            phase_x == rhs.phase_x && phase_y == rhs.phase_y &&
+            target_srs == rhs.target_srs &&
+            source_srs == rhs.source_srs;
+    }
+};
+
+struct warp_mesh_key_hash
+{
+    std::size_t operator()(warp_mesh_key const& key) const;
+};
+
+// Process wide LRU cache of reprojected warp mesh points. The raster and
+// gdal plugins crop each query to a window of the dataset's pixel grid;
+// blocks are laid over that grid rather than over the window, so the
+// windows of neighbouring tiles and repeated renders share their points.
+// The capacity is a budget in bytes of cached points.
+class MAPNIK_DECL warp_mesh_cache :
+        public singleton<warp_mesh_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<warp_mesh_cache>;
+public:
+    static constexpr unsigned block_size = 8;
+    warp_mesh_block_ptr find(warp_mesh_key const& key);
+    void insert(warp_mesh_key const& key, warp_mesh_block_ptr const& block);
+    void clear();
+    // number of cached blocks
+    std::size_t size() const;
+    // bytes of cached blocks
+    std::size_t memory_usage() const;
+    // maximum bytes of cached blocks, 0 disables the cache
+    void set_capacity(std::size_t capacity);
+    std::size_t capacity() const;
+private:
+    warp_mesh_cache();
+    util::lru_cache<warp_mesh_key, warp_mesh_block_ptr, warp_mesh_key_hash> blocks_;
+};
+
+}
+
+#endif // MAPNIK_WARP_MESH_CACHE_HPP
@@ -22,6 +22,8 @@
 
 #include "csv_datasource.hpp"
 #include "csv_utils.hpp"
+#include "csv_featureset.hpp"
+#include "large_csv_featureset.hpp"
 
 // boost
 #include <boost/tokenizer.hpp>
@@ -34,7 +36,6 @@
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/feature_factory.hpp>
 #include <mapnik/geometry.hpp>
-#include <mapnik/memory_featureset.hpp>
 #include <mapnik/wkt/wkt_factory.hpp>
 #include <mapnik/json/geometry_parser.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
@@ -42,6 +43,8 @@
 #include <mapnik/boolean.hpp>
 #include <mapnik/util/trim.hpp>
 #include <mapnik/value_types.hpp>
+#include <mapnik/make_unique.hpp>
+#include <mapnik/util/boost_geometry_adapters.hpp> // boost.geometry - register box2d<double>
 
 // stl
 #include <sstream>
@@ -65,6 +68,7 @@ csv_datasource::csv_datasource(parameters const& params)
     file_length_(0),
     row_limit_(*params.get<mapnik::value_integer>("row_limit", 0)),
     features_(),
+    tree_(nullptr),
     escape_(*params.get<std::string>("escape", "")),
     separator_(*params.get<std::string>("separator", "")),
     quote_(*params.get<std::string>("quote", "")),
@@ -73,7 +77,11 @@ csv_datasource::csv_datasource(parameters const& params)
     strict_(*params.get<mapnik::boolean_type>("strict", false)),
     filesize_max_(*params.get<double>("filesize_max", 20.0)),  // MB
     ctx_(std::make_shared<mapnik::context_type>()),
-    extent_initialized_(false)
+    extent_initialized_(false),
+    cache_features_(true),
+    grammar_(),
+    locator_(),
+    fix_json_quoting_(false)
 {
     /* TODO:
        general:
@@ -87,7 +95,6 @@ csv_datasource::csv_datasource(parameters const& params)
        speed:
        - add properties for wkt/json/lon/lat at parse time
        - add ability to pass 'filter' keyword to drop attributes at layer init
-       - create quad tree on the fly for small/med size files
        - memory map large files for reading
        - smaller features (less memory overhead)
        usability:
@@ -118,6 +125,9 @@ csv_datasource::csv_datasource(parameters const& params)
             filename_ = *base + "/" + *file;
         else
             filename_ = *file;
+        // when disabled only row positions are kept in memory and
+        // rows are parsed again from the file as queries hit them
+        cache_features_ = *params.get<mapnik::boolean_type>("cache_features", true);
     }
     if (!inline_string_.empty())
     {
@@ -152,7 +162,7 @@ void csv_datasource::parse_csv(T & stream,
     stream.seekg(0, std::ios::end);
     file_length_ = stream.tellg();
 
-    if (filesize_max_ > 0)
+    if (cache_features_ && filesize_max_ > 0)
     {
         double file_mb = static_cast<double>(file_length_)/1048576;
 
@@ -250,11 +260,10 @@ void csv_datasource::parse_csv(T & stream,
     MAPNIK_LOG_DEBUG(csv) << "csv_datasource: csv grammar: sep: '" << sep
                           << "' quo: '" << quo << "' esc: '" << esc << "'";
 
-    boost::escaped_list_separator<char> grammer;
     try
     {
-        //  grammer = boost::escaped_list_separator<char>('\\', ',', '\"');
-        grammer = boost::escaped_list_separator<char>(esc, sep, quo);
+        //  grammar_ = boost::escaped_list_separator<char>('\\', ',', '\"');
+        grammar_ = boost::escaped_list_separator<char>(esc, sep, quo);
     }
     catch(std::exception const& ex)
     {
@@ -266,52 +275,16 @@ void csv_datasource::parse_csv(T & stream,
     using Tokenizer = boost::tokenizer< escape_type >;
 
     int line_number(1);
-    bool has_wkt_field = false;
-    bool has_json_field = false;
-    bool has_lat_field = false;
-    bool has_lon_field = false;
-    unsigned wkt_idx(0);
-    unsigned json_idx(0);
-    unsigned lat_idx(0);
-    unsigned lon_idx(0);
 
     if (!manual_headers_.empty())
     {
-        Tokenizer tok(manual_headers_, grammer);
+        Tokenizer tok(manual_headers_, grammar_);
         Tokenizer::iterator beg = tok.begin();
         unsigned idx(0);
         for (; beg != tok.end(); ++beg)
         {
             std::string val = mapnik::util::trim_copy(*beg);
-            std::string lower_val = val;
-            std::transform(lower_val.begin(), lower_val.end(), lower_val.begin(), ::tolower);
-            if (lower_val == "wkt"
-                || (lower_val.find("geom") != std::string::npos))
-            {
-                wkt_idx = idx;
-                has_wkt_field = true;
-            }
-            if (lower_val == "geojson")
-            {
-                json_idx = idx;
-                has_json_field = true;
-            }
-            if (lower_val == "x"
-                || lower_val == "lon"
-                || lower_val == "lng"
-                || lower_val == "long"
-                || (lower_val.find("longitude") != std::string::npos))
-            {
-                lon_idx = idx;
-                has_lon_field = true;
-            }
-            if (lower_val == "y"
-                || lower_val == "lat"
-                || (lower_val.find("latitude") != std::string::npos))
-            {
-                lat_idx = idx;
-                has_lat_field = true;
-            }
+            locator_.detect(val, idx);
             ++idx;
             headers_.push_back(val);
         }
@@ -322,7 +295,7 @@ void csv_datasource::parse_csv(T & stream,
         {
             try
             {
-                Tokenizer tok(csv_line, grammer);
+                Tokenizer tok(csv_line, grammar_);
                 Tokenizer::iterator beg = tok.begin();
                 std::string val;
                 if (beg != tok.end())
@@ -362,35 +335,7 @@ void csv_datasource::parse_csv(T & stream,
                         }
                         else
                         {
-                            std::string lower_val = val;
-                            std::transform(lower_val.begin(), lower_val.end(), lower_val.begin(), ::tolower);
-                            if (lower_val == "wkt"
-                                || (lower_val.find("geom") != std::string::npos))
-                            {
-                                wkt_idx = idx;
-                                has_wkt_field = true;
-                            }
-                            if (lower_val == "geojson")
-                            {
-                                json_idx = idx;
-                                has_json_field = true;
-                            }
-                            if (lower_val == "x"
-                                || lower_val == "lon"
-                                || lower_val == "lng"
-                                || lower_val == "long"
-                                || (lower_val.find("longitude") != std::string::npos))
-                            {
-                                lon_idx = idx;
-                                has_lon_field = true;
-                            }
-                            if (lower_val == "y"
-                                || lower_val == "lat"
-                                || (lower_val.find("latitude") != std::string::npos))
-                            {
-                                lat_idx = idx;
-                                has_lat_field = true;
-                            }
+                            locator_.detect(val, idx);
                             headers_.push_back(val);
                         }
                     }
@@ -407,26 +352,31 @@ void csv_datasource::parse_csv(T & stream,
         }
     }
 
-    if (!has_wkt_field && !has_json_field && (!has_lon_field || !has_lat_field) )
+    if (!locator_.valid())
     {
         throw mapnik::datasource_exception("CSV Plugin: could not detect column headers with the name of wkt, geojson, x/y, or latitude/longitude - this is required for reading geometry data");
     }
 
+    // special handling for varieties of quoting that we will enounter with json
+    // TODO - test with custom "quo" option
+    fix_json_quoting_ = locator_.has_json_field && (quo == "\"");
+
     mapnik::value_integer feature_count(0);
+    mapnik::value_integer feature_id(0);
     bool extent_started = false;
 
-    std::size_t num_headers = headers_.size();
-
     for (std::size_t i = 0; i < headers_.size(); ++i)
     {
         ctx_->push(headers_[i]);
     }
 
     mapnik::transcoder tr(desc_.get_encoding());
+    std::vector<item_type> values;
 
     // handle rare case of a single line of data and user-provided headers
     // where a lack of a newline will mean that std::getline returns false
     bool is_first_row = false;
+    std::size_t row_offset = stream.tellg();
     if (!has_newline)
     {
         stream >> csv_line;
@@ -437,6 +387,8 @@ void csv_datasource::parse_csv(T & stream,
     }
     while (std::getline(stream,csv_line,newline) || is_first_row)
     {
+        std::size_t offset = row_offset;
+        row_offset = stream.tellg();
         is_first_row = false;
         if ((row_limit_ > 0) && (line_number > row_limit_))
         {
@@ -460,340 +412,247 @@ void csv_datasource::parse_csv(T & stream,
 
         try
         {
-            // special handling for varieties of quoting that we will enounter with json
-            // TODO - test with custom "quo" option
-            if (has_json_field && (quo == "\"") && (std::count(csv_line.begin(), csv_line.end(), '"') >= 6))
+            // NOTE: feature id's start at 1 and follow the rows, rows
+            // that fail to parse keep their id but rows without a
+            // geometry give theirs back
+            mapnik::value_integer id = ++feature_id;
+            mapnik::feature_ptr feature = parse_feature(csv_line, id, line_number, tr,
+                                                        (feature_count == 0) ? &desc_ : nullptr);
+            if (!feature)
             {
-                csv_utils::fix_json_quoting(csv_line);
-            }
-
-            Tokenizer tok(csv_line, grammer);
-            Tokenizer::iterator beg = tok.begin();
-
-            unsigned num_fields = std::distance(beg,tok.end());
-            if (num_fields > num_headers)
-            {
-                std::ostringstream s;
-                s << "CSV Plugin: # of columns("
-                  << num_fields << ") > # of headers("
-                  << num_headers << ") parsed for row " << line_number << "\n";
-                throw mapnik::datasource_exception(s.str());
+                --feature_id;
+                continue;
             }
-            else if (num_fields < num_headers)
+            ++feature_count;
+            mapnik::box2d<double> box = feature->envelope();
+            if (!extent_initialized_)
             {
-                std::ostringstream s;
-                s << "CSV Plugin: # of headers("
-                  << num_headers << ") > # of columns("
-                  << num_fields << ") parsed for row " << line_number << "\n";
-                if (strict_)
+                if (!extent_started)
                 {
-                    throw mapnik::datasource_exception(s.str());
+                    extent_started = true;
+                    extent_ = box;
                 }
                 else
                 {
-                    MAPNIK_LOG_WARN(csv) << s.str();
+                    extent_.expand_to_include(box);
                 }
             }
+            if (cache_features_)
+            {
+                values.emplace_back(box, features_.size());
+                features_.push_back(feature);
+            }
+            else
+            {
+                // keep only where to find the row again
+                values.emplace_back(box, rows_.size());
+                rows_.emplace_back(offset, line_length, id);
+            }
+            ++line_number;
+        }
+        catch(mapnik::datasource_exception const& ex )
+        {
+            if (strict_)
+            {
+                throw mapnik::datasource_exception(ex.what());
+            }
+            else
+            {
+                MAPNIK_LOG_ERROR(csv) << ex.what();
+            }
+        }
+        catch(std::exception const& ex)
+        {
+            std::ostringstream s;
+            s << "CSV Plugin: unexpected error parsing line: " << line_number
+              << " - found " << headers_.size() << " with values like: " << csv_line << "\n"
+              << " and got error like: " << ex.what();
+            if (strict_)
+            {
+                throw mapnik::datasource_exception(s.str());
+            }
+            else
+            {
+                MAPNIK_LOG_ERROR(csv) << s.str();
+            }
+        }
+    }
+    if (feature_count < 1)
+    {
+        MAPNIK_LOG_ERROR(csv) << "CSV Plugin: could not parse any lines of data";
+    }
+    // bulk insert initialise r-tree
+    tree_ = std::make_unique<spatial_index_type>(values);
+}
 
-            // NOTE: we use ++feature_count here because feature id's should start at 1;
-            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_,++feature_count));
-            double x(0);
-            double y(0);
-            bool parsed_x = false;
-            bool parsed_y = false;
-            bool parsed_wkt = false;
-            bool parsed_json = false;
-            std::vector<std::string> collected;
-            for (unsigned i = 0; i < num_headers; ++i)
-            {
-                std::string fld_name(headers_.at(i));
-                collected.push_back(fld_name);
-                std::string value;
-                if (beg == tok.end()) // there are more headers than column values for this row
-                {
-                    // add an empty string here to represent a missing value
-                    // not using null type here since nulls are not a csv thing
-                    feature->put(fld_name,tr.transcode(value.c_str()));
-                    if (feature_count == 1)
-                    {
-                        desc_.add_descriptor(mapnik::attribute_descriptor(fld_name,mapnik::String));
-                    }
-                    // continue here instead of break so that all missing values are
-                    // encoded consistenly as empty strings
-                    continue;
-                }
-                else
-                {
-                    value = mapnik::util::trim_copy(*beg);
-                    ++beg;
-                }
+mapnik::feature_ptr csv_datasource::parse_feature(std::string & csv_line,
+                                                  mapnik::value_integer id,
+                                                  int line_number,
+                                                  mapnik::transcoder const& tr,
+                                                  mapnik::layer_descriptor * desc) const
+{
+    using Tokenizer = boost::tokenizer< boost::escaped_list_separator<char> >;
 
-                int value_length = value.length();
+    if (fix_json_quoting_ && (std::count(csv_line.begin(), csv_line.end(), '"') >= 6))
+    {
+        csv_utils::fix_json_quoting(csv_line);
+    }
 
-                // parse wkt
-                if (has_wkt_field)
-                {
-                    if (i == wkt_idx)
-                    {
-                        // skip empty geoms
-                        if (value.empty())
-                        {
-                            break;
-                        }
+    Tokenizer tok(csv_line, grammar_);
+    Tokenizer::iterator beg = tok.begin();
 
-                        if (mapnik::from_wkt(value, feature->paths()))
-                        {
-                            parsed_wkt = true;
-                        }
-                        else
-                        {
-                            std::ostringstream s;
-                            s << "CSV Plugin: expected well known text geometry: could not parse row "
-                              << line_number
-                              << ",column "
-                              << i << " - found: '"
-                              << value << "'";
-                            if (strict_)
-                            {
-                                throw mapnik::datasource_exception(s.str());
-                            }
-                            else
-                            {
-                                MAPNIK_LOG_ERROR(csv) << s.str();
-                            }
-                        }
-                    }
+    std::size_t num_headers = headers_.size();
+    unsigned num_fields = std::distance(beg,tok.end());
+    if (num_fields > num_headers)
+    {
+        std::ostringstream s;
+        s << "CSV Plugin: # of columns("
+          << num_fields << ") > # of headers("
+          << num_headers << ") parsed for row " << line_number << "\n";
+        throw mapnik::datasource_exception(s.str());
+    }
+    else if (num_fields < num_headers)
+    {
+        std::ostringstream s;
+        s << "CSV Plugin: # of headers("
+          << num_headers << ") > # of columns("
+          << num_fields << ") parsed for row " << line_number << "\n";
+        if (strict_)
+        {
+            throw mapnik::datasource_exception(s.str());
+        }
+        else
+        {
+            MAPNIK_LOG_WARN(csv) << s.str();
+        }
+    }
+
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_,id));
+    double x(0);
+    double y(0);
+    bool parsed_x = false;
+    bool parsed_y = false;
+    bool parsed_wkt = false;
+    bool parsed_json = false;
+    std::vector<std::string> collected;
+    for (unsigned i = 0; i < num_headers; ++i)
+    {
+        std::string fld_name(headers_.at(i));
+        collected.push_back(fld_name);
+        std::string value;
+        if (beg == tok.end()) // there are more headers than column values for this row
+        {
+            // add an empty string here to represent a missing value
+            // not using null type here since nulls are not a csv thing
+            feature->put(fld_name,tr.transcode(value.c_str()));
+            if (desc)
+            {
+                desc->add_descriptor(mapnik::attribute_descriptor(fld_name,mapnik::String));
+            }
+            // continue here instead of break so that all missing values are
+            // encoded consistenly as empty strings
+            continue;
+        }
+        else
+        {
+            value = mapnik::util::trim_copy(*beg);
+            ++beg;
+        }
+
+        int value_length = value.length();
+
+        // parse wkt
+        if (locator_.has_wkt_field)
+        {
+            if (i == locator_.wkt_idx)
+            {
+                // skip empty geoms
+                if (value.empty())
+                {
+                    break;
                 }
-                // TODO - support both wkt/geojson columns
-                // at once to create multi-geoms?
-                // parse as geojson
-                else if (has_json_field)
+
+                if (mapnik::from_wkt(value, feature->paths()))
                 {
-                    if (i == json_idx)
-                    {
-                        // skip empty geoms
-                        if (value.empty())
-                        {
-                            break;
-                        }
-                        if (mapnik::json::from_geojson(value, feature->paths()))
-                        {
-                            parsed_json = true;
-                        }
-                        else
-                        {
-                            std::ostringstream s;
-                            s << "CSV Plugin: expected geojson geometry: could not parse row "
-                              << line_number
-                              << ",column "
-                              << i << " - found: '"
-                              << value << "'";
-                            if (strict_)
-                            {
-                                throw mapnik::datasource_exception(s.str());
-                            }
-                            else
-                            {
-                                MAPNIK_LOG_ERROR(csv) << s.str();
-                            }
-                        }
-                    }
+                    parsed_wkt = true;
                 }
                 else
                 {
-                    // longitude
-                    if (i == lon_idx)
+                    std::ostringstream s;
+                    s << "CSV Plugin: expected well known text geometry: could not parse row "
+                      << line_number
+                      << ",column "
+                      << i << " - found: '"
+                      << value << "'";
+                    if (strict_)
                     {
-                        // skip empty geoms
-                        if (value.empty())
-                        {
-                            break;
-                        }
-
-                        if (mapnik::util::string2double(value,x))
-                        {
-                            parsed_x = true;
-                        }
-                        else
-                        {
-                            std::ostringstream s;
-                            s << "CSV Plugin: expected a float value for longitude: could not parse row "
-                              << line_number
-                              << ", column "
-                              << i << " - found: '"
-                              << value << "'";
-                            if (strict_)
-                            {
-                                throw mapnik::datasource_exception(s.str());
-                            }
-                            else
-                            {
-                                MAPNIK_LOG_ERROR(csv) << s.str();
-                            }
-                        }
+                        throw mapnik::datasource_exception(s.str());
                     }
-                    // latitude
-                    else if (i == lat_idx)
+                    else
                     {
-                        // skip empty geoms
-                        if (value.empty())
-                        {
-                            break;
-                        }
-
-                        if (mapnik::util::string2double(value,y))
-                        {
-                            parsed_y = true;
-                        }
-                        else
-                        {
-                            std::ostringstream s;
-                            s << "CSV Plugin: expected a float value for latitude: could not parse row "
-                              << line_number
-                              << ", column "
-                              << i << " - found: '"
-                              << value << "'";
-                            if (strict_)
-                            {
-                                throw mapnik::datasource_exception(s.str());
-                            }
-                            else
-                            {
-                                MAPNIK_LOG_ERROR(csv) << s.str();
-                            }
-                        }
+                        MAPNIK_LOG_ERROR(csv) << s.str();
                     }
                 }
-
-                // now, add attributes, skipping any WKT or JSON fields
-                if ((has_wkt_field) && (i == wkt_idx)) continue;
-                if ((has_json_field) && (i == json_idx)) continue;
-                /* First we detect likely strings,
-                   then try parsing likely numbers,
-                   then try converting to bool,
-                   finally falling back to string type.
-                   An empty string or a string of "null" will be parsed
-                   as a string rather than a true null value.
-                   Likely strings are either empty values, very long values
-                   or values with leading zeros like 001 (which are not safe
-                   to assume are numbers)
-                */
-
-                bool matched = false;
-                bool has_dot = value.find(".") != std::string::npos;
-                if (value.empty() ||
-                    (value_length > 20) ||
-                    (value_length > 1 && !has_dot && value[0] == '0'))
+            }
+        }
+        // TODO - support both wkt/geojson columns
+        // at once to create multi-geoms?
+        // parse as geojson
+        else if (locator_.has_json_field)
+        {
+            if (i == locator_.json_idx)
+            {
+                // skip empty geoms
+                if (value.empty())
                 {
-                    matched = true;
-                    feature->put(fld_name,std::move(tr.transcode(value.c_str())));
-                    if (feature_count == 1)
-                    {
-                        desc_.add_descriptor(mapnik::attribute_descriptor(fld_name,mapnik::String));
-                    }
+                    break;
                 }
-                else if (csv_utils::is_likely_number(value))
+                if (mapnik::json::from_geojson(value, feature->paths()))
                 {
-                    bool has_e = value.find("e") != std::string::npos;
-                    if (has_dot || has_e)
-                    {
-                        double float_val = 0.0;
-                        if (mapnik::util::string2double(value,float_val))
-                        {
-                            matched = true;
-                            feature->put(fld_name,float_val);
-                            if (feature_count == 1)
-                            {
-                                desc_.add_descriptor(
-                                    mapnik::attribute_descriptor(
-                                        fld_name,mapnik::Double));
-                            }
-                        }
-                    }
-                    else
-                    {
-                        mapnik::value_integer int_val = 0;
-                        if (mapnik::util::string2int(value,int_val))
-                        {
-                            matched = true;
-                            feature->put(fld_name,int_val);
-                            if (feature_count == 1)
-                            {
-                                desc_.add_descriptor(
-                                    mapnik::attribute_descriptor(
-                                        fld_name,mapnik::Integer));
-                            }
-                        }
-                    }
+                    parsed_json = true;
                 }
-                if (!matched)
+                else
                 {
-                    // NOTE: we don't use mapnik::util::string2bool
-                    // here because we don't want to treat 'on' and 'off'
-                    // as booleans, only 'true' and 'false'
-                    bool bool_val = false;
-                    std::string lower_val = value;
-                    std::transform(lower_val.begin(), lower_val.end(), lower_val.begin(), ::tolower);
-                    if (lower_val == "true")
-                    {
-                        matched = true;
-                        bool_val = true;
-                    }
-                    else if (lower_val == "false")
-                    {
-                        matched = true;
-                        bool_val = false;
-                    }
-                    if (matched)
+                    std::ostringstream s;
+                    s << "CSV Plugin: expected geojson geometry: could not parse row "
+                      << line_number
+                      << ",column "
+                      << i << " - found: '"
+                      << value << "'";
+                    if (strict_)
                     {
-                        feature->put(fld_name,bool_val);
-                        if (feature_count == 1)
-                        {
-                            desc_.add_descriptor(
-                                mapnik::attribute_descriptor(
-                                    fld_name,mapnik::Boolean));
-                        }
+                        throw mapnik::datasource_exception(s.str());
                     }
                     else
                     {
-                        // fallback to normal string
-                        feature->put(fld_name,std::move(tr.transcode(value.c_str())));
-                        if (feature_count == 1)
-                        {
-                            desc_.add_descriptor(
-                                mapnik::attribute_descriptor(
-                                    fld_name,mapnik::String));
-                        }
+                        MAPNIK_LOG_ERROR(csv) << s.str();
                     }
                 }
             }
-
-            bool null_geom = true;
-            if (has_wkt_field || has_json_field)
+        }
+        else
+        {
+            // longitude
+            if (i == locator_.lon_idx)
             {
-                if (parsed_wkt || parsed_json)
+                // skip empty geoms
+                if (value.empty())
                 {
-                    if (!extent_initialized_)
-                    {
-                        if (!extent_started)
-                        {
-                            extent_started = true;
-                            extent_ = feature->envelope();
-                        }
-                        else
-                        {
-                            extent_.expand_to_include(feature->envelope());
-                        }
-                    }
-                    features_.push_back(feature);
-                    null_geom = false;
+                    break;
+                }
+
+                if (mapnik::util::string2double(value,x))
+                {
+                    parsed_x = true;
                 }
                 else
                 {
                     std::ostringstream s;
-                    s << "CSV Plugin: could not read WKT or GeoJSON geometry "
-                      << "for line " << line_number << " - found " <<  headers_.size()
-                      << " with values like: " << csv_line << "\n";
+                    s << "CSV Plugin: expected a float value for longitude: could not parse row "
+                      << line_number
+                      << ", column "
+                      << i << " - found: '"
+                      << value << "'";
                     if (strict_)
                     {
                         throw mapnik::datasource_exception(s.str());
@@ -801,50 +660,30 @@ void csv_datasource::parse_csv(T & stream,
                     else
                     {
                         MAPNIK_LOG_ERROR(csv) << s.str();
-                        continue;
                     }
                 }
             }
-            else if (has_lat_field || has_lon_field)
+            // latitude
+            else if (i == locator_.lat_idx)
             {
-                if (parsed_x && parsed_y)
+                // skip empty geoms
+                if (value.empty())
                 {
-                    mapnik::geometry_type * pt = new mapnik::geometry_type(mapnik::geometry_type::types::Point);
-                    pt->move_to(x,y);
-                    feature->add_geometry(pt);
-                    features_.push_back(feature);
-                    null_geom = false;
-                    if (!extent_initialized_)
-                    {
-                        if (!extent_started)
-                        {
-                            extent_started = true;
-                            extent_ = feature->envelope();
-                        }
-                        else
-                        {
-                            extent_.expand_to_include(feature->envelope());
-                        }
-                    }
+                    break;
                 }
-                else if (parsed_x || parsed_y)
+
+                if (mapnik::util::string2double(value,y))
+                {
+                    parsed_y = true;
+                }
+                else
                 {
                     std::ostringstream s;
-                    s << "CSV Plugin: does your csv have valid headers?\n";
-                    if (!parsed_x)
-                    {
-                        s << "Could not detect or parse any rows named 'x' or 'longitude' "
-                          << "for line " << line_number << " but found " <<  headers_.size()
-                          << " with values like: " << csv_line << "\n"
-                          << "for: " << boost::algorithm::join(collected, ",") << "\n";
-                    }
-                    if (!parsed_y)
-                    {
-                        s << "Could not detect or parse any rows named 'y' or 'latitude' "
-                          << "for line " << line_number << " but found " <<  headers_.size()
-                          << " with values like: " << csv_line << "\n"
-                          << "for: " << boost::algorithm::join(collected, ",") << "\n";
-                    }
+                    s << "CSV Plugin: expected a float value for latitude: could not parse row "
+                      << line_number
+                      << ", column "
+                      << i << " - found: '"
+                      << value << "'";
                     if (strict_)
                     {
                         throw mapnik::datasource_exception(s.str());
@@ -852,49 +691,165 @@ void csv_datasource::parse_csv(T & stream,
                     else
                     {
                         MAPNIK_LOG_ERROR(csv) << s.str();
-                        continue;
                     }
                 }
             }
+        }
 
-            if (null_geom)
+        // now, add attributes, skipping any WKT or JSON fields
+        if ((locator_.has_wkt_field) && (i == locator_.wkt_idx)) continue;
+        if ((locator_.has_json_field) && (i == locator_.json_idx)) continue;
+        /* First we detect likely strings,
+           then try parsing likely numbers,
+           then try converting to bool,
+           finally falling back to string type.
+           An empty string or a string of "null" will be parsed
+           as a string rather than a true null value.
+           Likely strings are either empty values, very long values
+           or values with leading zeros like 001 (which are not safe
+           to assume are numbers)
+        */
+
+        bool matched = false;
+        bool has_dot = value.find(".") != std::string::npos;
+        if (value.empty() ||
+            (value_length > 20) ||
+            (value_length > 1 && !has_dot && value[0] == '0'))
+        {
+            matched = true;
+            feature->put(fld_name,std::move(tr.transcode(value.c_str())));
+            if (desc)
             {
-                std::ostringstream s;
-                s << "CSV Plugin: could not detect and parse valid lat/lon fields or wkt/json geometry for line "
-                  << line_number;
-                if (strict_)
+                desc->add_descriptor(mapnik::attribute_descriptor(fld_name,mapnik::String));
+            }
+        }
+        else if (csv_utils::is_likely_number(value))
+        {
+            bool has_e = value.find("e") != std::string::npos;
+            if (has_dot || has_e)
+            {
+                double float_val = 0.0;
+                if (mapnik::util::string2double(value,float_val))
                 {
-                    throw mapnik::datasource_exception(s.str());
+                    matched = true;
+                    feature->put(fld_name,float_val);
+                    if (desc)
+                    {
+                        desc->add_descriptor(
+                            mapnik::attribute_descriptor(
+                                fld_name,mapnik::Double));
+                    }
                 }
-                else
+            }
+            else
+            {
+                mapnik::value_integer int_val = 0;
+                if (mapnik::util::string2int(value,int_val))
+                {
+                    matched = true;
+                    feature->put(fld_name,int_val);
+                    if (desc)
+                    {
+                        desc->add_descriptor(
+                            mapnik::attribute_descriptor(
+                                fld_name,mapnik::Integer));
+                    }
+                }
+            }
+        }
+        if (!matched)
+        {
+            // NOTE: we don't use mapnik::util::string2bool
+            // here because we don't want to treat 'on' and 'off'
+            // as booleans, only 'true' and 'false'
+            bool bool_val = false;
+            std::string lower_val = value;
+            std::transform(lower_val.begin(), lower_val.end(), lower_val.begin(), ::tolower);
+            if (lower_val == "true")
+            {
+                matched = true;
+                bool_val = true;
+            }
+            else if (lower_val == "false")
+            {
+                matched = true;
+                bool_val = false;
+            }
+            if (matched)
+            {
+                feature->put(fld_name,bool_val);
+                if (desc)
+                {
+                    desc->add_descriptor(
+                        mapnik::attribute_descriptor(
+                            fld_name,mapnik::Boolean));
+                }
+            }
+            else
+            {
+                // fallback to normal string
+                feature->put(fld_name,std::move(tr.transcode(value.c_str())));
+                if (desc)
                 {
-                    MAPNIK_LOG_ERROR(csv) << s.str();
-                    // with no geometry we will never
-                    // add this feature so drop the count
-                    feature_count--;
-                    continue;
+                    desc->add_descriptor(
+                        mapnik::attribute_descriptor(
+                            fld_name,mapnik::String));
                 }
             }
+        }
+    }
 
-            ++line_number;
+    bool null_geom = true;
+    if (locator_.has_wkt_field || locator_.has_json_field)
+    {
+        if (parsed_wkt || parsed_json)
+        {
+            null_geom = false;
         }
-        catch(mapnik::datasource_exception const& ex )
+        else
         {
+            std::ostringstream s;
+            s << "CSV Plugin: could not read WKT or GeoJSON geometry "
+              << "for line " << line_number << " - found " <<  headers_.size()
+              << " with values like: " << csv_line << "\n";
             if (strict_)
             {
-                throw mapnik::datasource_exception(ex.what());
+                throw mapnik::datasource_exception(s.str());
             }
             else
             {
-                MAPNIK_LOG_ERROR(csv) << ex.what();
+                MAPNIK_LOG_ERROR(csv) << s.str();
+                return mapnik::feature_ptr();
             }
         }
-        catch(std::exception const& ex)
+    }
+    else if (locator_.has_lat_field || locator_.has_lon_field)
+    {
+        if (parsed_x && parsed_y)
+        {
+            mapnik::geometry_type * pt = new mapnik::geometry_type(mapnik::geometry_type::types::Point);
+            pt->move_to(x,y);
+            feature->add_geometry(pt);
+            null_geom = false;
+        }
+        else if (parsed_x || parsed_y)
         {
             std::ostringstream s;
-            s << "CSV Plugin: unexpected error parsing line: " << line_number
-              << " - found " << headers_.size() << " with values like: " << csv_line << "\n"
-              << " and got error like: " << ex.what();
+            s << "CSV Plugin: does your csv have valid headers?\n";
+            if (!parsed_x)
+            {
+                s << "Could not detect or parse any rows named 'x' or 'longitude' "
+                  << "for line " << line_number << " but found " <<  headers_.size()
+                  << " with values like: " << csv_line << "\n"
+                  << "for: " << boost::algorithm::join(collected, ",") << "\n";
+            }
+            if (!parsed_y)
+            {
+                s << "Could not detect or parse any rows named 'y' or 'latitude' "
+                  << "for line " << line_number << " but found " <<  headers_.size()
+                  << " with values like: " << csv_line << "\n"
+                  << "for: " << boost::algorithm::join(collected, ",") << "\n";
+            }
             if (strict_)
             {
                 throw mapnik::datasource_exception(s.str());
@@ -902,13 +857,28 @@ void csv_datasource::parse_csv(T & stream,
             else
             {
                 MAPNIK_LOG_ERROR(csv) << s.str();
+                return mapnik::feature_ptr();
             }
         }
     }
-    if (feature_count < 1)
+
+    if (null_geom)
     {
-        MAPNIK_LOG_ERROR(csv) << "CSV Plugin: could not parse any lines of data";
+        std::ostringstream s;
+        s << "CSV Plugin: could not detect and parse valid lat/lon fields or wkt/json geometry for line "
+          << line_number;
+        if (strict_)
+        {
+            throw mapnik::datasource_exception(s.str());
+        }
+        else
+        {
+            MAPNIK_LOG_ERROR(csv) << s.str();
+            // with no geometry we will never add this feature
+            return mapnik::feature_ptr();
+        }
     }
+    return feature;
 }
 
 const char * csv_datasource::name()
@@ -930,10 +900,24 @@ boost::optional<mapnik::datasource::geometry_t> csv_datasource::get_geometry_typ
 {
     boost::optional<mapnik::datasource::geometry_t> result;
     int multi_type = 0;
-    unsigned num_features = features_.size();
-    for (unsigned i = 0; i < num_features && i < 5; ++i)
+    // sample the first few features
+    csv_featureset::array_type index_array;
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        index_array.emplace_back(box_type(), i);
+    }
+    mapnik::featureset_ptr fs;
+    if (cache_features_)
+    {
+        fs = std::make_shared<csv_featureset>(features_, std::move(index_array));
+    }
+    else
+    {
+        fs = std::make_shared<large_csv_featureset>(filename_, *this, rows_, std::move(index_array));
+    }
+    for (mapnik::feature_ptr feature = fs->next(); feature; feature = fs->next())
     {
-        mapnik::util::to_ds_type(features_[i]->paths(),result);
+        mapnik::util::to_ds_type(feature->paths(),result);
         if (result)
         {
             int type = static_cast<int>(*result);
@@ -953,6 +937,11 @@ mapnik::layer_descriptor csv_datasource::get_descriptor() const
     return desc_;
 }
 
+bool csv_datasource::has_stable_ids() const
+{
+    return true;
+}
+
 mapnik::featureset_ptr csv_datasource::features(mapnik::query const& q) const
 {
     const std::set<std::string>& attribute_names = q.property_names();
@@ -977,10 +966,35 @@ mapnik::featureset_ptr csv_datasource::features(mapnik::query const& q) const
         }
         ++pos;
     }
-    return std::make_shared<mapnik::memory_featureset>(q.get_bbox(),features_);
+    csv_featureset::array_type index_array;
+    if (tree_)
+    {
+        tree_->query(boost::geometry::index::intersects(q.get_bbox()),std::back_inserter(index_array));
+        // return features in file order
+        std::sort(index_array.begin(),index_array.end(),
+                  [] (item_type const& item0, item_type const& item1)
+                  {
+                      return item0.second < item1.second;
+                  });
+    }
+    if (!cache_features_)
+    {
+        return std::make_shared<large_csv_featureset>(filename_, *this, rows_, std::move(index_array));
+    }
+    return std::make_shared<csv_featureset>(features_, std::move(index_array));
 }
 
 mapnik::featureset_ptr csv_datasource::features_at_point(mapnik::coord2d const& pt, double tol) const
 {
-    throw mapnik::datasource_exception("CSV Plugin: features_at_point is not supported yet");
+    mapnik::box2d<double> query_bbox(pt, pt);
+    query_bbox.pad(tol);
+    mapnik::query q(query_bbox);
+    std::vector<mapnik::attribute_descriptor> const& desc = desc_.get_descriptors();
+    std::vector<mapnik::attribute_descriptor>::const_iterator itr = desc.begin();
+    std::vector<mapnik::attribute_descriptor>::const_iterator end = desc.end();
+    for ( ;itr!=end;++itr)
+    {
+        q.add_property_name(itr->get_name());
+    }
+    return features(q);
 }
@@ -32,18 +32,64 @@
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/value_types.hpp>
+#include <mapnik/unicode.hpp>
+
+#include "csv_utils.hpp"
 
 // boost
 #include <boost/optional.hpp>
+#include <boost/tokenizer.hpp>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#pragma GCC diagnostic ignored "-Wunused-local-typedef"
+#include <boost/geometry/geometries/point_xy.hpp>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/geometries/geometries.hpp>
+#include <boost/geometry.hpp>
+#include <boost/version.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#pragma GCC diagnostic pop
 
 // stl
+#include <memory>
 #include <vector>
 #include <deque>
 #include <string>
+#include <tuple>
+
+template <std::size_t Max, std::size_t Min>
+struct csv_linear : boost::geometry::index::linear<Max,Min> {};
+
+namespace boost { namespace geometry { namespace index { namespace detail { namespace rtree {
+
+template <std::size_t Max, std::size_t Min>
+struct options_type<csv_linear<Max,Min> >
+{
+    using type = options<csv_linear<Max, Min>,
+                         insert_default_tag,
+                         choose_by_content_diff_tag,
+                         split_default_tag,
+                         linear_tag,
+#if BOOST_VERSION >= 105700
+                         node_variant_static_tag>;
+#else
+                         node_s_mem_static_tag>;
+
+#endif
+};
+
+}}}}}
 
 class csv_datasource : public mapnik::datasource
 {
 public:
+    using box_type = mapnik::box2d<double>;
+    using item_type = std::pair<box_type, std::size_t>;
+    using spatial_index_type = boost::geometry::index::rtree<item_type,csv_linear<16,4> >;
+    // byte offset and length of a row in the file and its feature id
+    using row_position = std::tuple<std::size_t, std::size_t, mapnik::value_integer>;
+
     csv_datasource(mapnik::parameters const& params);
     virtual ~csv_datasource ();
     mapnik::datasource::datasource_t type() const;
@@ -53,6 +99,7 @@ public:
     mapnik::box2d<double> envelope() const;
     boost::optional<mapnik::datasource::geometry_t> get_geometry_type() const;
     mapnik::layer_descriptor get_descriptor() const;
+    bool has_stable_ids() const;
 
     template <typename T>
     void parse_csv(T & stream,
@@ -60,14 +107,24 @@ public:
                    std::string const& separator,
                    std::string const& quote);
 
+    // parse a single data row, returns a null pointer for rows
+    // without usable geometry unless running in strict mode
+    mapnik::feature_ptr parse_feature(std::string & csv_line,
+                                      mapnik::value_integer id,
+                                      int line_number,
+                                      mapnik::transcoder const& tr,
+                                      mapnik::layer_descriptor * desc) const;
+
 private:
     mapnik::layer_descriptor desc_;
     mapnik::box2d<double> extent_;
     std::string filename_;
     std::string inline_string_;
-    unsigned file_length_;
+    std::size_t file_length_;
     mapnik::value_integer row_limit_;
     std::deque<mapnik::feature_ptr> features_;
+    std::unique_ptr<spatial_index_type> tree_;
+    std::vector<row_position> rows_;
     std::string escape_;
     std::string separator_;
     std::string quote_;
@@ -77,6 +134,10 @@ private:
     double filesize_max_;
     mapnik::context_ptr ctx_;
     bool extent_initialized_;
+    bool cache_features_;
+    boost::escaped_list_separator<char> grammar_;
+    csv_utils::geometry_column_locator locator_;
+    bool fix_json_quoting_;
 };
 
 #endif // MAPNIK_CSV_DATASOURCE_HPP
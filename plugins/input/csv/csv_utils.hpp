@@ -31,9 +31,71 @@
 
 #include <string>
 #include <cstdio>
+#include <algorithm>
 
 namespace csv_utils
 {
+    // remembers which columns hold geometry data
+    struct geometry_column_locator
+    {
+        geometry_column_locator()
+            : has_wkt_field(false),
+              has_json_field(false),
+              has_lat_field(false),
+              has_lon_field(false),
+              wkt_idx(0),
+              json_idx(0),
+              lat_idx(0),
+              lon_idx(0) {}
+
+        void detect(std::string const& header, unsigned idx)
+        {
+            std::string lower_val = header;
+            std::transform(lower_val.begin(), lower_val.end(), lower_val.begin(), ::tolower);
+            if (lower_val == "wkt"
+                || (lower_val.find("geom") != std::string::npos))
+            {
+                wkt_idx = idx;
+                has_wkt_field = true;
+            }
+            if (lower_val == "geojson")
+            {
+                json_idx = idx;
+                has_json_field = true;
+            }
+            if (lower_val == "x"
+                || lower_val == "lon"
+                || lower_val == "lng"
+                || lower_val == "long"
+                || (lower_val.find("longitude") != std::string::npos))
+            {
+                lon_idx = idx;
+                has_lon_field = true;
+            }
+            if (lower_val == "y"
+                || lower_val == "lat"
+                || (lower_val.find("latitude") != std::string::npos))
+            {
+                lat_idx = idx;
+                has_lat_field = true;
+            }
+        }
+
+        bool valid() const
+        {
+            return has_wkt_field || has_json_field || (has_lon_field && has_lat_field);
+        }
+
+        bool has_wkt_field;
+        bool has_json_field;
+        bool has_lat_field;
+        bool has_lon_field;
+        unsigned wkt_idx;
+        unsigned json_idx;
+        unsigned lat_idx;
+        unsigned lon_idx;
+    };
+
     static inline bool is_likely_number(std::string const& value)
     {
         return( strspn( value.c_str(), "e-.+0123456789" ) == value.size() );
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/feature.hpp>
+#include <mapnik/utils.hpp>
+// stl
+#include <string>
+#include <vector>
+#include <deque>
+#include <stdexcept>
+
+#include "large_csv_featureset.hpp"
+
+large_csv_featureset::large_csv_featureset(std::string const& filename,
+                                           csv_datasource const& ds,
+                                           std::vector<csv_datasource::row_position> const& rows,
+                                           array_type && index_array)
+:
+#ifdef _WINDOWS
+    file_(_wfopen(mapnik::utf8_to_utf16(filename).c_str(), L"rb"), std::fclose),
+#else
+    file_(std::fopen(filename.c_str(),"rb"), std::fclose),
+#endif
+    ds_(ds),
+    rows_(rows),
+    index_array_(std::move(index_array)),
+    index_itr_(index_array_.begin()),
+    index_end_(index_array_.end()),
+    tr_(ds.get_descriptor().get_encoding()),
+    csv_line_()
+{
+    if (!file_) throw std::runtime_error("Can't open " + filename);
+}
+
+large_csv_featureset::~large_csv_featureset() {}
+
+mapnik::feature_ptr large_csv_featureset::next()
+{
+    while (index_itr_ != index_end_)
+    {
+        csv_datasource::item_type const& item = *index_itr_++;
+        std::size_t index = item.second;
+        if (index >= rows_.size()) break;
+        std::size_t file_offset = std::get<0>(rows_[index]);
+        std::size_t size = std::get<1>(rows_[index]);
+        std::fseek(file_.get(), file_offset, SEEK_SET);
+        csv_line_.resize(size);
+        if (size > 0 && std::fread(&csv_line_[0], size, 1, file_.get()) != 1)
+        {
+            throw std::runtime_error("Failed to read csv row");
+        }
+        // feature id's match the ones assigned when caching features
+        mapnik::feature_ptr feature = ds_.parse_feature(csv_line_, std::get<2>(rows_[index]), 0, tr_, nullptr);
+        if (feature) return feature;
+    }
+    return mapnik::feature_ptr();
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef LARGE_CSV_FEATURESET_HPP
+#define LARGE_CSV_FEATURESET_HPP
+
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+#include "csv_datasource.hpp"
+
+#include <vector>
+#include <deque>
+#include <cstdio>
+
+// reads and parses rows from the file as they are requested
+class large_csv_featureset : public mapnik::Featureset
+{
+public:
+    using array_type = std::deque<csv_datasource::item_type>;
+    using file_ptr = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+    large_csv_featureset(std::string const& filename,
+                         csv_datasource const& ds,
+                         std::vector<csv_datasource::row_position> const& rows,
+                         array_type && index_array);
+    virtual ~large_csv_featureset();
+    mapnik::feature_ptr next();
+
+private:
+    file_ptr file_;
+    csv_datasource const& ds_;
+    std::vector<csv_datasource::row_position> const& rows_;
+    const array_type index_array_;
+    array_type::const_iterator index_itr_;
+    array_type::const_iterator index_end_;
+    mapnik::transcoder tr_;
+    std::string csv_line_;
+};
+
+#endif // LARGE_CSV_FEATURESET_HPP
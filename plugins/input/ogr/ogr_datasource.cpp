@@ -477,6 +477,11 @@ layer_descriptor ogr_datasource::get_descriptor() const
     return desc_;
 }
 
+bool ogr_datasource::has_stable_ids() const
+{
+    return true;
+}
+
 void validate_attribute_names(query const& q, std::vector<attribute_descriptor> const& names )
 {
     std::set<std::string> const& attribute_names = q.property_names();
@@ -56,6 +56,7 @@ public:
     mapnik::box2d<double> envelope() const;
     boost::optional<mapnik::datasource::geometry_t> get_geometry_type() const;
     mapnik::layer_descriptor get_descriptor() const;
+    bool has_stable_ids() const;
 
 private:
     void init(mapnik::parameters const& params);
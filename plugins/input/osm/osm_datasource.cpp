@@ -122,6 +122,11 @@ layer_descriptor osm_datasource::get_descriptor() const
     return desc_;
 }
 
+bool osm_datasource::has_stable_ids() const
+{
+    return true;
+}
+
 featureset_ptr osm_datasource::features(const query& q) const
 {
     filter_in_box filter(q.get_bbox());
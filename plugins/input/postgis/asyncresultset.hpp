@@ -30,6 +30,8 @@
 #include "resultset.hpp"
 #include <queue>
 #include <memory>
+#include <string>
+#include <vector>
 
 class postgis_processor_context;
 using postgis_processor_context_ptr = std::shared_ptr<postgis_processor_context>;
@@ -39,11 +41,13 @@ class AsyncResultSet : public IResultSet, private mapnik::util::noncopyable
 public:
     AsyncResultSet(postgis_processor_context_ptr const& ctx,
                      std::shared_ptr< Pool<Connection,ConnectionCreator> > const& pool,
-                     std::shared_ptr<Connection> const& conn, std::string const& sql )
+                     std::shared_ptr<Connection> const& conn, std::string const& sql,
+                     std::vector<std::string> const& params = std::vector<std::string>())
         : ctx_(ctx),
           pool_(pool),
           conn_(conn),
           sql_(sql),
+          params_(params),
           is_closed_(false)
     {
     }
@@ -165,6 +169,7 @@ private:
     std::shared_ptr< Pool<Connection,ConnectionCreator> > pool_;
     std::shared_ptr<Connection> conn_;
     std::string sql_;
+    std::vector<std::string> params_;
     std::shared_ptr<ResultSet> rs_;
     bool is_closed_;
 
@@ -173,7 +178,14 @@ private:
         conn_ = pool_->borrowObject();
         if (conn_ && conn_->isOK())
         {
-            conn_->executeAsyncQuery(sql_, 1);
+            if (params_.empty())
+            {
+                conn_->executeAsyncQuery(sql_, 1);
+            }
+            else
+            {
+                conn_->executeAsyncPreparedQuery(sql_, params_);
+            }
         }
         else
         {
@@ -32,6 +32,9 @@
 #include <memory>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern "C" {
 #include "libpq-fe.h"
@@ -113,28 +116,18 @@ public:
 #ifdef MAPNIK_STATS
         mapnik::progress_timer __stats__(std::clog, std::string("postgis_connection::execute_query ") + sql);
 #endif
-        PGresult* result = 0;
-        if ( executeAsyncQuery(sql, type) ) {
-          // fetch multiple times until NULL is returned,
-          // to handle multi-statement queries
-          while ( PGresult *tmp = getResult() ) {
-            if ( result ) PQclear(result);
-            result = tmp;
-          }
-        }
-
-        if (! result || (PQresultStatus(result) != PGRES_TUPLES_OK))
-        {
-            std::string err_msg = "Postgis Plugin: ";
-            err_msg += status();
-            err_msg += "in executeQuery Full sql was: '";
-            err_msg += sql;
-            err_msg += "'\n";
-            if ( result ) PQclear(result);
-            throw mapnik::datasource_exception(err_msg);
-        }
+        bool sent = executeAsyncQuery(sql, type);
+        return waitQueryResult(sent, sql);
+    }
 
-        return std::make_shared<ResultSet>(result);
+    // binary results for sql with text parameters bound to $1..$n
+    std::shared_ptr<ResultSet> executePreparedQuery(std::string const& sql, std::vector<std::string> const& params)
+    {
+#ifdef MAPNIK_STATS
+        mapnik::progress_timer __stats__(std::clog, std::string("postgis_connection::execute_prepared_query ") + sql);
+#endif
+        bool sent = executeAsyncPreparedQuery(sql, params);
+        return waitQueryResult(sent, sql);
     }
 
     std::string status() const
@@ -185,9 +178,60 @@ public:
         return result;
     }
 
+    // Sends sql with text parameters bound to $1..$n (the statement casts them)
+    // requesting binary results. The statement is prepared on this connection
+    // the first time it is seen, so later executions skip parsing and planning.
+    // Preparing does not block: the statement is sent with PQsendPrepare and
+    // executed once its result is read in getResult().
+    bool executeAsyncPreparedQuery(std::string const& sql, std::vector<std::string> const& params)
+    {
+        int result = 0;
+        auto itr = statements_.find(sql);
+        if (itr != statements_.end())
+        {
+            result = sendQueryPrepared(itr->second, params);
+        }
+        else if (statements_.size() >= max_prepared_statements)
+        {
+            std::vector<const char*> values = paramValues(params);
+            std::vector<Oid> types(params.size(), Oid(text_oid));
+            result = PQsendQueryParams(conn_, sql.c_str(), values.size(), types.data(), values.data(), 0, 0, 1);
+        }
+        else
+        {
+            std::ostringstream s;
+            s << "mapnik_statement_" << statements_.size();
+            std::vector<Oid> types(params.size(), Oid(text_oid));
+            result = PQsendPrepare(conn_, s.str().c_str(), sql.c_str(), types.size(), types.data());
+            if (result == 1)
+            {
+                queued_sql_ = sql;
+                queued_name_ = s.str();
+                queued_params_ = params;
+            }
+        }
+        if (result != 1)
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += status();
+            err_msg += "in executeAsyncPreparedQuery Full sql was: '";
+            err_msg += sql;
+            err_msg += "'\n";
+            clearAsyncResult(PQgetResult(conn_));
+            close();
+            throw mapnik::datasource_exception(err_msg);
+        }
+        pending_ = true;
+        return result;
+    }
+
     PGresult* getResult()
     {
         PGresult *result = PQgetResult(conn_);
+        if (!queued_name_.empty())
+        {
+            result = executeQueued(result);
+        }
         return result;
     }
 
@@ -258,10 +302,94 @@ public:
     }
 
 private:
+    static const Oid text_oid = 25;
+    static const std::size_t max_prepared_statements = 256;
+
     PGconn *conn_;
     int cursorId;
     bool closed_;
     bool pending_;
+    std::unordered_map<std::string, std::string> statements_;
+    std::string queued_sql_;
+    std::string queued_name_;
+    std::vector<std::string> queued_params_;
+
+    std::shared_ptr<ResultSet> waitQueryResult(bool sent, std::string const& sql)
+    {
+        PGresult* result = 0;
+        if ( sent ) {
+          // fetch multiple times until NULL is returned,
+          // to handle multi-statement queries
+          while ( PGresult *tmp = getResult() ) {
+            if ( result ) PQclear(result);
+            result = tmp;
+          }
+        }
+
+        if (! result || (PQresultStatus(result) != PGRES_TUPLES_OK))
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += status();
+            err_msg += "in executeQuery Full sql was: '";
+            err_msg += sql;
+            err_msg += "'\n";
+            if ( result ) PQclear(result);
+            throw mapnik::datasource_exception(err_msg);
+        }
+
+        return std::make_shared<ResultSet>(result);
+    }
+
+    static std::vector<const char*> paramValues(std::vector<std::string> const& params)
+    {
+        std::vector<const char*> values;
+        values.reserve(params.size());
+        for (std::string const& param : params)
+        {
+            values.push_back(param.c_str());
+        }
+        return values;
+    }
+
+    int sendQueryPrepared(std::string const& name, std::vector<std::string> const& params)
+    {
+        std::vector<const char*> values = paramValues(params);
+        return PQsendQueryPrepared(conn_, name.c_str(), values.size(), values.data(), 0, 0, 1);
+    }
+
+    // consumes the result of the PQsendPrepare sent by executeAsyncPreparedQuery,
+    // then sends the queued execution and returns its first result
+    PGresult* executeQueued(PGresult *result)
+    {
+        bool ok = (result && (PQresultStatus(result) == PGRES_COMMAND_OK));
+        std::string sql;
+        std::string name;
+        std::vector<std::string> params;
+        sql.swap(queued_sql_);
+        name.swap(queued_name_);
+        params.swap(queued_params_);
+        if (ok)
+        {
+            PQclear(result);
+            // the prepare is complete once PQgetResult returns null
+            while ((result = PQgetResult(conn_))) PQclear(result);
+            statements_.emplace(sql, name);
+            ok = (sendQueryPrepared(name, params) == 1);
+            result = nullptr;
+        }
+        if ( ! ok )
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += status();
+            err_msg += "in prepare Full sql was: '";
+            err_msg += sql;
+            err_msg += "'\n";
+            clearAsyncResult(result ? result : PQgetResult(conn_));
+            close();
+            throw mapnik::datasource_exception(err_msg);
+        }
+        return PQgetResult(conn_);
+    }
 
     void clearAsyncResult(PGresult *result)
     {
@@ -271,6 +399,9 @@ private:
            PQclear(result);
            result = PQgetResult(conn_);
         }
+        queued_sql_.clear();
+        queued_name_.clear();
+        queued_params_.clear();
         pending_ = false;
     }
 };
@@ -28,6 +28,7 @@
 #include <sstream>
 #include <memory>
 #include <algorithm>
+#include <cstdint>
 
 static inline std::string numeric2string(const char* buf)
 {
@@ -141,4 +142,39 @@ static inline std::string numeric2string(const char* buf)
     return ss.str();
 }
 
+// Decodes a binary numeric straight to a double when its decimal digits fit a
+// double exactly and the power of ten scaling them is exact, so the single
+// multiply or divide is correctly rounded. Returns false otherwise (including
+// NaN) so the caller can fall back to numeric2string.
+static inline bool numeric2double(const char* buf, double & result)
+{
+    static const double powers10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                       1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                       1e20, 1e21, 1e22 };
+    std::int16_t ndigits = int2net(buf);
+    std::int16_t weight  = int2net(buf+2);
+    std::int16_t sign    = int2net(buf+4);
+
+    if (sign != 0x0000 && sign != 0x4000) return false;
+    if (ndigits < 0 || ndigits > 4) return false;
+
+    std::uint64_t mantissa = 0;
+    for (int n = 0; n < ndigits; ++n)
+    {
+        mantissa = mantissa * 10000 + int2net(buf+8+n*2);
+    }
+    if (mantissa > (std::uint64_t(1) << 53)) return false;
+
+    // each digit is a base 10000 "digit", the last one scaled by 10000^(weight - ndigits + 1)
+    int exponent = 4 * (weight - ndigits + 1);
+    double value = static_cast<double>(mantissa);
+    if (mantissa == 0) exponent = 0;
+    if (exponent > 22 || exponent < -22) return false;
+    if (exponent >= 0) value *= powers10[exponent];
+    else value /= powers10[-exponent];
+
+    result = (sign == 0x4000) ? -value : value;
+    return true;
+}
+
 #endif
@@ -90,6 +90,7 @@ postgis_datasource::postgis_datasource(parameters const& params)
       extent_from_subquery_(*params.get<mapnik::boolean_type>("extent_from_subquery", false)),
       max_async_connections_(*params_.get<mapnik::value_integer>("max_async_connection", 1)),
       asynchronous_request_(false),
+      prepared_statements_(*params.get<mapnik::boolean_type>("prepared_statements", false)),
       // TODO - use for known tokens too: "(@\\w+|!\\w+!)"
       pattern_(boost::regex("(@\\w+)",boost::regex::normal | boost::regbase::icase)),
       // params below are for testing purposes only and may be removed at any time
@@ -508,6 +509,22 @@ layer_descriptor postgis_datasource::get_descriptor() const
     return desc_;
 }
 
+bool postgis_datasource::has_stable_ids() const
+{
+    // features are numbered per query without a key field
+    return !key_field_.empty();
+}
+
+static std::string box3d_text(box2d<double> const& env)
+{
+    std::ostringstream b;
+    b << "BOX3D(";
+    b << std::setprecision(16);
+    b << env.minx() << " " << env.miny() << ",";
+    b << env.maxx() << " " << env.maxy() << ")";
+    return b.str();
+}
+
 std::string postgis_datasource::sql_bbox(box2d<double> const& env) const
 {
     std::ostringstream b;
@@ -517,10 +534,27 @@ std::string postgis_datasource::sql_bbox(box2d<double> const& env) const
         b << "ST_SetSRID(";
     }
 
-    b << "'BOX3D(";
-    b << std::setprecision(16);
-    b << env.minx() << " " << env.miny() << ",";
-    b << env.maxx() << " " << env.maxy() << ")'::box3d";
+    b << "'" << box3d_text(env) << "'::box3d";
+
+    if (srid_ > 0)
+    {
+        b << ", " << srid_ << ")";
+    }
+
+    return b.str();
+}
+
+// bbox bound as the text of parameter $1 of a prepared statement
+std::string postgis_datasource::sql_bbox_param() const
+{
+    std::ostringstream b;
+
+    if (srid_ > 0)
+    {
+        b << "ST_SetSRID(";
+    }
+
+    b << "$1::box3d";
 
     if (srid_ > 0)
     {
@@ -577,29 +611,36 @@ std::string postgis_datasource::populate_tokens(
                                 box2d<double> const& env,
                                 double pixel_width,
                                 double pixel_height,
-                                mapnik::attributes const& vars) const
+                                mapnik::attributes const& vars,
+                                bool bind_params) const
 {
+    // with bind_params the tokens become parameters $1 (bbox), $2 (scale
+    // denominator), $3 (pixel width) and $4 (pixel height) so the SQL text
+    // stays the same from one query to the next
     std::string populated_sql = sql;
-    std::string box = sql_bbox(env);
+    std::string box = bind_params ? sql_bbox_param() : sql_bbox(env);
 
     if (boost::algorithm::icontains(populated_sql, scale_denom_token_))
     {
         std::ostringstream ss;
-        ss << scale_denom;
+        if (bind_params) ss << "$2::float8";
+        else ss << scale_denom;
         boost::algorithm::replace_all(populated_sql, scale_denom_token_, ss.str());
     }
 
     if (boost::algorithm::icontains(sql, pixel_width_token_))
     {
         std::ostringstream ss;
-        ss << pixel_width;
+        if (bind_params) ss << "$3::float8";
+        else ss << pixel_width;
         boost::algorithm::replace_all(populated_sql, pixel_width_token_, ss.str());
     }
 
     if (boost::algorithm::icontains(sql, pixel_height_token_))
     {
         std::ostringstream ss;
-        ss << pixel_height;
+        if (bind_params) ss << "$4::float8";
+        else ss << pixel_height;
         boost::algorithm::replace_all(populated_sql, pixel_height_token_, ss.str());
     }
 
@@ -647,13 +688,19 @@ std::string postgis_datasource::populate_tokens(
 }
 
 
-std::shared_ptr<IResultSet> postgis_datasource::get_resultset(std::shared_ptr<Connection> &conn, std::string const& sql, CnxPool_ptr const& pool, processor_context_ptr ctx) const
+std::shared_ptr<IResultSet> postgis_datasource::get_resultset(std::shared_ptr<Connection> &conn, std::string const& sql, CnxPool_ptr const& pool, processor_context_ptr ctx,
+                                                              std::vector<std::string> const& params) const
 {
 
     if (!ctx)
     {
         // ! asynchronous_request_
-        if (cursor_fetch_size_ > 0)
+        if (!params.empty())
+        {
+            // prepared statement, cursors can't be declared over one
+            return conn->executePreparedQuery(sql, params);
+        }
+        else if (cursor_fetch_size_ > 0)
         {
             // cursor
             std::ostringstream csql;
@@ -683,13 +730,20 @@ std::shared_ptr<IResultSet> postgis_datasource::get_resultset(std::shared_ptr<Co
         if (conn)
         {
             // lauch async req & create asyncresult with conn
-            conn->executeAsyncQuery(sql, 1);
-            return std::make_shared<AsyncResultSet>(pgis_ctxt, pool, conn, sql);
+            if (params.empty())
+            {
+                conn->executeAsyncQuery(sql, 1);
+            }
+            else
+            {
+                conn->executeAsyncPreparedQuery(sql, params);
+            }
+            return std::make_shared<AsyncResultSet>(pgis_ctxt, pool, conn, sql, params);
         }
         else
         {
             // create asyncresult  with  null connection
-            std::shared_ptr<AsyncResultSet> res = std::make_shared<AsyncResultSet>(pgis_ctxt, pool,  conn, sql);
+            std::shared_ptr<AsyncResultSet> res = std::make_shared<AsyncResultSet>(pgis_ctxt, pool,  conn, sql, params);
             pgis_ctxt->add_request(res);
             return res;
         }
@@ -793,6 +847,11 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
         const double px_gw = 1.0 / std::get<0>(q.resolution());
         const double px_gh = 1.0 / std::get<1>(q.resolution());
 
+        // bind per query values to a statement prepared once per connection,
+        // except for cursors which can't be declared over a prepared statement
+        bool bind_params = prepared_statements_ && (asynchronous_request_ || cursor_fetch_size_ <= 0);
+        std::vector<std::string> params;
+
         s << "SELECT ST_AsBinary(";
 
         if (simplify_geometries_) {
@@ -806,7 +865,26 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
           // drop of collapsed polygons.
           // See https://github.com/mapnik/mapnik/issues/1639
           const double tolerance = std::min(px_gw, px_gh) / 20.0;
-          s << ", " << tolerance << ")";
+          if (bind_params)
+          {
+              s << ", $5::float8)";
+          }
+          else
+          {
+              s << ", " << tolerance << ")";
+          }
+        }
+
+        if (bind_params)
+        {
+            const double tolerance = std::min(px_gw, px_gh) / 20.0;
+            for (double val : { scale_denom, px_gw, px_gh, tolerance })
+            {
+                std::ostringstream ss;
+                ss << val;
+                params.push_back(ss.str());
+            }
+            params.insert(params.begin(), box3d_text(box));
         }
 
         s << ") AS geom";
@@ -839,7 +917,7 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             }
         }
 
-        std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables());
+        std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables(), bind_params);
 
         s << " FROM " << table_with_bbox;
 
@@ -848,7 +926,7 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             s << " LIMIT " << row_limit_;
         }
 
-        std::shared_ptr<IResultSet> rs = get_resultset(conn, s.str(), pool, proc_ctx);
+        std::shared_ptr<IResultSet> rs = get_resultset(conn, s.str(), pool, proc_ctx, params);
         return std::make_shared<postgis_featureset>(rs, ctx, desc_.get_encoding(), !key_field_.empty());
 
     }
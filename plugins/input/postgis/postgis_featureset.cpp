@@ -67,10 +67,20 @@ feature_ptr postgis_featureset::next()
         // new feature
         unsigned pos = 1;
         feature_ptr feature;
+        unsigned num_attrs = ctx_->size() + 1;
+
+        // column names are the same for every row, resolve them once
+        if (names_.empty())
+        {
+            for (unsigned i = 0; i < num_attrs; ++i)
+            {
+                names_.emplace_back(rs_->getFieldName(i));
+            }
+        }
 
         if (key_field_)
         {
-            std::string name = rs_->getFieldName(pos);
+            std::string const& name = names_[pos];
 
             // null feature id is not acceptable
             if (rs_->isNull(pos))
@@ -127,10 +137,9 @@ feature_ptr postgis_featureset::next()
             continue;
 
         totalGeomSize_ += size;
-        unsigned num_attrs = ctx_->size() + 1;
         for (; pos < num_attrs; ++pos)
         {
-            std::string name = rs_->getFieldName(pos);
+            std::string const& name = names_[pos];
 
             // NOTE: we intentionally do not store null here
             // since it is equivalent to the attribute not existing
@@ -184,7 +193,7 @@ feature_ptr postgis_featureset::next()
                     case 1043: //varchar
                     case 705:  //literal
                     {
-                        feature->put(name, tr_->transcode(buf));
+                        feature->put(name, tr_->transcode(buf, rs_->getFieldLength(pos)));
                         break;
                     }
 
@@ -198,6 +207,11 @@ feature_ptr postgis_featureset::next()
                     case 1700: //numeric
                     {
                         double val;
+                        if (numeric2double(buf, val))
+                        {
+                            feature->put(name, val);
+                            break;
+                        }
                         std::string str = numeric2string(buf);
                         if (mapnik::util::string2double(str, val))
                         {
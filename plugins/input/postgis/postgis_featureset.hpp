@@ -29,6 +29,11 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
 
+// stl
+#include <memory>
+#include <string>
+#include <vector>
+
 using mapnik::Featureset;
 using mapnik::box2d;
 using mapnik::feature_ptr;
@@ -54,6 +59,7 @@ private:
     unsigned totalGeomSize_;
     mapnik::value_integer feature_id_;
     bool key_field_;
+    std::vector<std::string> names_;
 };
 
 #endif // POSTGIS_FEATURESET_HPP
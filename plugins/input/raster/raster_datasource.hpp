@@ -64,6 +64,7 @@ private:
     bool multi_tiles_;
     unsigned tile_size_;
     unsigned tile_stride_;
+    unsigned decode_threads_;
     unsigned width_;
     unsigned height_;
 };
@@ -50,12 +50,15 @@ using mapnik::feature_factory;
 template <typename LookupPolicy>
 raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
                                                    box2d<double> const& extent,
-                                                   query const& q)
+                                                   query const& q,
+                                                   unsigned decode_threads)
     : policy_(policy),
       feature_id_(1),
       ctx_(std::make_shared<mapnik::context_type>()),
       extent_(extent),
       bbox_(q.get_bbox()),
+      resolution_(q.resolution()),
+      decode_threads_(decode_threads),
       curIter_(policy_.begin()),
       endIter_(policy_.end())
 {
@@ -82,9 +85,28 @@ feature_ptr raster_featureset<LookupPolicy>::next()
 
             if (reader.get())
             {
+                reader->set_threads(decode_threads_);
                 int image_width = policy_.img_width(reader->width());
                 int image_height = policy_.img_height(reader->height());
 
+                // read a reduced resolution level (e.g. tiff overview) when
+                // several raster pixels fall into one output pixel
+                unsigned level = 0;
+                if (reader->levels() > 1 &&
+                    image_width == static_cast<int>(reader->width()) &&
+                    image_height == static_cast<int>(reader->height()))
+                {
+                    double output_width = extent_.width() * std::get<0>(resolution_);
+                    double output_height = extent_.height() * std::get<1>(resolution_);
+                    if (output_width > 0 && output_height > 0)
+                    {
+                        level = reader->level_for_factor(std::min(image_width / output_width,
+                                                                  image_height / output_height));
+                        image_width = reader->level_width(level);
+                        image_height = reader->level_height(level);
+                    }
+                }
+
                 if (image_width > 0 && image_height > 0)
                 {
                     mapnik::view_transform t(image_width, image_height, extent_, 0, 0);
@@ -114,7 +136,7 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                                                             rem.maxx() + x_off + width,
                                                             rem.maxy() + y_off + height);
                         intersect = t.backward(feature_raster_extent);
-                        mapnik::image_any data = reader->read(x_off, y_off, width, height);
+                        mapnik::image_any data = reader->read_level(level, x_off, y_off, width, height);
                         mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, std::move(data), 1.0);
                         feature->set_raster(raster);
                     }
@@ -309,7 +309,8 @@ class raster_featureset : public mapnik::Featureset
 public:
     raster_featureset(LookupPolicy const& policy,
                       box2d<double> const& exttent,
-                      mapnik::query const& q);
+                      mapnik::query const& q,
+                      unsigned decode_threads = 1);
     virtual ~raster_featureset();
     mapnik::feature_ptr next();
 
@@ -319,6 +320,8 @@ private:
     mapnik::context_ptr ctx_;
     mapnik::box2d<double> extent_;
     mapnik::box2d<double> bbox_;
+    mapnik::query::resolution_type resolution_;
+    unsigned decode_threads_;
     iterator_type curIter_;
     iterator_type endIter_;
 };
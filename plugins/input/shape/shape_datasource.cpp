@@ -226,6 +226,11 @@ layer_descriptor shape_datasource::get_descriptor() const
     return desc_;
 }
 
+bool shape_datasource::has_stable_ids() const
+{
+    return true;
+}
+
 featureset_ptr shape_datasource::features(query const& q) const
 {
 #ifdef MAPNIK_STATS
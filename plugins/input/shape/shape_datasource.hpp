@@ -62,6 +62,7 @@ public:
     box2d<double> envelope() const;
     boost::optional<mapnik::datasource::geometry_t> get_geometry_type() const;
     layer_descriptor get_descriptor() const;
+    bool has_stable_ids() const;
 
 private:
     void init(shape_io& shape);
@@ -22,6 +22,7 @@
 
 // stl
 #include <fstream>
+#include <algorithm>
 
 // mapnik
 #include <mapnik/debug.hpp>
@@ -66,14 +67,18 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
     if (index)
     {
 #ifdef SHAPE_MEMORY_MAPPED_FILE
-        //shp_index<filterT,stream<mapped_file_source> >::query(filter, index->file(), offsets_);
-        shp_index<filterT,boost::interprocess::ibufferstream>::query(filter, index->file(), offsets_);
+        // traverse the mapped index in place
+        char const* start = static_cast<char const*>(index->mapped_region_->get_address());
+        char const* end = start + index->mapped_region_->get_size();
+        shp_index<filterT,boost::interprocess::ibufferstream>::query(filter, start, end, offsets_);
 #else
         shp_index<filterT,std::ifstream>::query(filter, index->file(), offsets_);
 #endif
     }
 
+    // visit records in file order, once each, so reads from the .shp are sequential
     std::sort(offsets_.begin(), offsets_.end());
+    offsets_.erase(std::unique(offsets_.begin(), offsets_.end()), offsets_.end());
 
     MAPNIK_LOG_DEBUG(shape) << "shape_index_featureset: Query size=" << offsets_.size();
 
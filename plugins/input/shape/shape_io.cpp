@@ -66,7 +66,11 @@ shape_io::~shape_io() {}
 
 void shape_io::move_to(std::streampos pos)
 {
-    shp_.seek(pos);
+    // avoid seeking (and discarding the read buffer) when records are contiguous
+    if (shp_.pos() != pos)
+    {
+        shp_.seek(pos);
+    }
     id_ = shp_.read_xdr_integer();
     reclength_ = shp_.read_xdr_integer();
 }
@@ -97,6 +101,7 @@ void shape_io::read_polyline( shape_file::record_type & record, mapnik::geometry
     if (num_parts == 1)
     {
         std::unique_ptr<geometry_type> line(new geometry_type(mapnik::geometry_type::types::LineString));
+        line->reserve(num_points);
         record.skip(4);
         double x = record.read_double();
         double y = record.read_double();
@@ -130,6 +135,7 @@ void shape_io::read_polyline( shape_file::record_type & record, mapnik::geometry
             {
                 end = parts[k + 1];
             }
+            if (end > start) line->reserve(end - start);
 
             double x = record.read_double();
             double y = record.read_double();
@@ -182,6 +188,14 @@ void shape_io::read_polygon(shape_file::record_type & record, mapnik::geometry_c
         points.emplace_back(x,y);
     }
 
+    // clockwise rings after the first start a new polygon
+    std::vector<bool> outer(num_parts);
+    for (int k = 0; k < num_parts; ++k)
+    {
+        int end = (k == num_parts - 1) ? num_points : parts[k + 1];
+        outer[k] = (k == 0) || is_clockwise(points, parts[k], end);
+    }
+
     std::unique_ptr<geometry_type> poly(new geometry_type(mapnik::geometry_type::types::Polygon));
     for (int k = 0; k < num_parts; ++k)
     {
@@ -189,14 +203,22 @@ void shape_io::read_polygon(shape_file::record_type & record, mapnik::geometry_c
         int end;
         if (k == num_parts - 1) end = num_points;
         else end = parts[k + 1];
+        if (outer[k])
+        {
+            if (k > 0)
+            {
+                geom.push_back(poly.release());
+                poly.reset(new geometry_type(mapnik::geometry_type::types::Polygon));
+            }
+            // points of the rings of this polygon, every ring adds a close_path vertex
+            int next = k + 1;
+            while (next < num_parts && !outer[next]) ++next;
+            int last = (next == num_parts) ? num_points : parts[next];
+            if (last > start) poly->reserve(last - start + next - k);
+        }
         auto const& pt = points[start];
         double x = std::get<0>(pt);
         double y = std::get<1>(pt);
-        if ( k > 0 && is_clockwise(points, start, end))
-        {
-            geom.push_back(poly.release());
-            poly.reset(new geometry_type(mapnik::geometry_type::types::Polygon));
-        }
         poly->move_to(x, y);
         for (int j = start + 1; j < end; ++j)
         {
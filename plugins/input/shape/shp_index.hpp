@@ -26,8 +26,11 @@
 // stl
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <cstdint>
 
 // mapnik
+#include <mapnik/global.hpp>
 #include <mapnik/box2d.hpp>
 #include <mapnik/query.hpp>
 
@@ -39,6 +42,8 @@ class shp_index
 {
 public:
     static void query(filterT const& filter, IStream& file,std::vector<std::streampos>& pos);
+    // walk an index held in memory (e.g. a mapped region) without stream calls
+    static void query(filterT const& filter, char const* start, char const* end, std::vector<std::streampos>& pos);
 private:
     shp_index();
     ~shp_index();
@@ -47,13 +52,48 @@ private:
     static int read_ndr_integer(IStream& in);
     static void read_envelope(IStream& in, box2d<double>& envelope);
     static void query_node(const filterT& filter, IStream& in, std::vector<std::streampos>& pos);
+    static bool query_node(const filterT& filter, char const*& cur, char const* end, std::vector<std::streampos>& pos);
+    template <typename Fetch>
+    static void query_rtree(const filterT& filter, int node_size, std::vector<std::int32_t> const& level_ends,
+                            Fetch fetch, std::vector<std::streampos>& pos);
+    static int read_ndr_integer(char const*& cur);
+    static void read_envelope(char const*& cur, box2d<double>& envelope);
 };
 
+// version byte in the index header, 0 for quadtree and 2 for packed rtree
+static const int SHP_INDEX_RTREE_VERSION = 2;
+// box2d<double> followed by an int32
+static const int SHP_INDEX_RTREE_ENTRY_SIZE = 36;
+
 template <typename filterT, typename IStream>
 void shp_index<filterT, IStream>::query(const filterT& filter, IStream& file, std::vector<std::streampos>& pos)
 {
-    file.seekg(16, std::ios::beg);
-    query_node(filter, file, pos);
+    char header[16];
+    file.seekg(0, std::ios::beg);
+    file.read(header, 16);
+    if (header[6] != SHP_INDEX_RTREE_VERSION)
+    {
+        query_node(filter, file, pos);
+        return;
+    }
+    int node_size = read_ndr_integer(file);
+    int num_levels = read_ndr_integer(file);
+    if (!file || node_size < 2 || num_levels <= 0) return;
+    std::vector<std::int32_t> level_ends;
+    for (int i = 0; i < num_levels; ++i)
+    {
+        level_ends.push_back(read_ndr_integer(file));
+    }
+    std::streampos entries_start = file.tellg();
+    std::vector<char> buffer;
+    query_rtree(filter, node_size, level_ends,
+                [&] (std::int32_t first, std::int32_t last) -> char const*
+                {
+                    buffer.resize((last - first) * SHP_INDEX_RTREE_ENTRY_SIZE);
+                    file.seekg(entries_start + std::streamoff(first) * SHP_INDEX_RTREE_ENTRY_SIZE, std::ios::beg);
+                    file.read(buffer.data(), buffer.size());
+                    return file ? buffer.data() : nullptr;
+                }, pos);
 }
 
 template <typename filterT, typename IStream>
@@ -86,6 +126,140 @@ void shp_index<filterT, IStream>::query_node(const filterT& filter, IStream& fil
     }
 }
 
+template <typename filterT, typename IStream>
+void shp_index<filterT, IStream>::query(const filterT& filter, char const* start, char const* end, std::vector<std::streampos>& pos)
+{
+    if (end - start < 16) return;
+    char const* cur = start + 16;
+    if (start[6] != SHP_INDEX_RTREE_VERSION)
+    {
+        query_node(filter, cur, end, pos);
+        return;
+    }
+    if (end - cur < 8) return;
+    int node_size = read_ndr_integer(cur);
+    int num_levels = read_ndr_integer(cur);
+    if (node_size < 2 || num_levels <= 0 || (end - cur) / 4 < num_levels) return;
+    std::vector<std::int32_t> level_ends;
+    for (int i = 0; i < num_levels; ++i)
+    {
+        level_ends.push_back(read_ndr_integer(cur));
+    }
+    char const* entries = cur;
+    std::ptrdiff_t num_entries = (end - entries) / SHP_INDEX_RTREE_ENTRY_SIZE;
+    query_rtree(filter, node_size, level_ends,
+                [&] (std::int32_t first, std::int32_t last) -> char const*
+                {
+                    if (last > num_entries) return nullptr;
+                    return entries + std::ptrdiff_t(first) * SHP_INDEX_RTREE_ENTRY_SIZE;
+                }, pos);
+}
+
+// fetch(first, last) returns the raw entries [first, last) or nullptr on error
+template <typename filterT, typename IStream>
+template <typename Fetch>
+void shp_index<filterT, IStream>::query_rtree(const filterT& filter, int node_size,
+                                              std::vector<std::int32_t> const& level_ends,
+                                              Fetch fetch, std::vector<std::streampos>& ids)
+{
+    struct node_range
+    {
+        std::int32_t first;
+        std::int32_t last;
+        int level;
+    };
+    int num_levels = level_ends.size();
+    std::int32_t root_start = (num_levels > 1) ? level_ends[num_levels - 2] : 0;
+    std::vector<node_range> stack;
+    stack.push_back(node_range{root_start, level_ends[num_levels - 1], num_levels - 1});
+    while (!stack.empty())
+    {
+        node_range range = stack.back();
+        stack.pop_back();
+        if (range.first < 0 || range.first >= range.last) continue;
+        char const* cur = fetch(range.first, range.last);
+        if (!cur) return;
+        std::int32_t child_start = (range.level > 1) ? level_ends[range.level - 2] : 0;
+        for (std::int32_t i = range.first; i < range.last; ++i)
+        {
+            box2d<double> ext;
+            read_envelope(cur, ext);
+            int value = read_ndr_integer(cur);
+            if (!filter.pass(ext)) continue;
+            if (range.level == 0)
+            {
+                ids.push_back(value);
+            }
+            else if (value >= child_start)
+            {
+                std::int32_t child_end = level_ends[range.level - 1];
+                stack.push_back(node_range{value, std::min(value + node_size, child_end), range.level - 1});
+            }
+        }
+    }
+}
+
+// returns false if the index is truncated
+template <typename filterT, typename IStream>
+bool shp_index<filterT, IStream>::query_node(const filterT& filter, char const*& cur, char const* end, std::vector<std::streampos>& ids)
+{
+    // offset + envelope + number of shapes
+    if (end - cur < 4 + 32 + 4) return false;
+
+    int offset = read_ndr_integer(cur);
+
+    box2d<double> node_ext;
+    read_envelope(cur, node_ext);
+
+    int num_shapes = read_ndr_integer(cur);
+    if (offset < 0 || num_shapes < 0) return false;
+
+    if (! filter.pass(node_ext))
+    {
+        std::ptrdiff_t skip = static_cast<std::ptrdiff_t>(offset) + num_shapes * 4 + 4;
+        if (end - cur < skip) return false;
+        cur += skip;
+        return true;
+    }
+
+    // shape ids + number of children
+    if (end - cur < static_cast<std::ptrdiff_t>(num_shapes) * 4 + 4) return false;
+
+    for (int i = 0; i < num_shapes; ++i)
+    {
+        ids.push_back(read_ndr_integer(cur));
+    }
+
+    int children = read_ndr_integer(cur);
+
+    for (int j = 0; j < children; ++j)
+    {
+        if (!query_node(filter, cur, end, ids)) return false;
+    }
+    return true;
+}
+
+template <typename filterT, typename IStream>
+int shp_index<filterT, IStream>::read_ndr_integer(char const*& cur)
+{
+    std::int32_t val;
+    mapnik::read_int32_ndr(cur, val);
+    cur += 4;
+    return val;
+}
+
+template <typename filterT, typename IStream>
+void shp_index<filterT, IStream>::read_envelope(char const*& cur, box2d<double>& envelope)
+{
+    double minx, miny, maxx, maxy;
+    mapnik::read_double_ndr(cur + 0 * 8, minx);
+    mapnik::read_double_ndr(cur + 1 * 8, miny);
+    mapnik::read_double_ndr(cur + 2 * 8, maxx);
+    mapnik::read_double_ndr(cur + 3 * 8, maxy);
+    envelope.init(minx, miny, maxx, maxy);
+    cur += 4 * 8;
+}
+
 template <typename filterT, typename IStream>
 int shp_index<filterT, IStream>::read_ndr_integer(IStream& file)
 {
@@ -473,6 +473,11 @@ layer_descriptor sqlite_datasource::get_descriptor() const
     return desc_;
 }
 
+bool sqlite_datasource::has_stable_ids() const
+{
+    return !key_field_.empty();
+}
+
 featureset_ptr sqlite_datasource::features(query const& q) const
 {
 #ifdef MAPNIK_STATS
@@ -72,6 +72,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      filter_threads_(m.filter_threads()),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
 {
     setup(m);
@@ -87,6 +88,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, request const& req, attributes c
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      filter_threads_(m.filter_threads()),
       common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
 {
     setup(m);
@@ -103,6 +105,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      filter_threads_(m.filter_threads()),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector)
 {
     setup(m);
@@ -303,11 +306,7 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
         if (st.image_filters().size() > 0)
         {
             blend_from = true;
-            mapnik::filter::filter_visitor<buffer_type> visitor(*current_buffer_);
-            for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
-            {
-                util::apply_visitor(visitor, filter_tag);
-            }
+            mapnik::filter::apply_filters(*current_buffer_, st.image_filters(), filter_threads_);
         }
         if (st.comp_op())
         {
@@ -325,11 +324,7 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
         }
     }
     // apply any 'direct' image filters
-    mapnik::filter::filter_visitor<buffer_type> visitor(pixmap_);
-    for (mapnik::filter::filter_type const& filter_tag : st.direct_image_filters())
-    {
-        util::apply_visitor(visitor, filter_tag);
-    }
+    mapnik::filter::apply_filters(pixmap_, st.direct_image_filters(), filter_threads_);
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
 }
 
@@ -27,6 +27,7 @@
 
 #include <mapnik/debug.hpp>
 #include <mapnik/feature.hpp>
+#include <mapnik/global.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/marker_helpers.hpp>
 #include <mapnik/marker.hpp>
@@ -57,6 +58,12 @@
 // boost
 #include <boost/optional.hpp>
 
+// stl
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+
 namespace mapnik {
 
 namespace detail {
@@ -89,26 +96,192 @@ struct vector_markers_rasterizer_dispatch : public vector_markers_dispatch<Detec
         renb_(pixf_),
         svg_renderer_(path, attrs),
         ras_(std::get<1>(renderer_context)),
-        snap_to_pixels_(snap_to_pixels)
+        snap_to_pixels_(snap_to_pixels),
+        attrs_(attrs),
+        use_sprites_(false),
+        rotation_steps_(marker_cache::instance().sprite_rotation_steps()),
+        sprite_key_()
     {
-        pixf_.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e, keys::comp_op>(sym, feature, vars)));
+        composite_mode_e comp_op = get<composite_mode_e, keys::comp_op>(sym, feature, vars);
+        pixf_.comp_op(static_cast<agg::comp_op_e>(comp_op));
+        // sprites are composited once with src-over which only matches rendering
+        // each path in turn for src-over. Sized ellipses are built per feature.
+        std::string filename = get<std::string>(sym, keys::file, feature, vars, "shape://ellipse");
+        if (comp_op == src_over && marker_cache::instance().sprite_capacity() > 0 &&
+            !(filename == "shape://ellipse" && (has_key(sym, keys::width) || has_key(sym, keys::height))))
+        {
+            use_sprites_ = true;
+            sprite_key_.path = std::move(filename);
+            auto fill_color = get_optional<color>(sym, keys::fill, feature, vars);
+            if (fill_color) sprite_key_.fill = fill_color->rgba();
+            sprite_key_.fill_opacity = get_optional<double>(sym, keys::fill_opacity, feature, vars);
+            auto stroke_color = get_optional<color>(sym, keys::stroke, feature, vars);
+            if (stroke_color) sprite_key_.stroke = stroke_color->rgba();
+            sprite_key_.stroke_width = get_optional<double>(sym, keys::stroke_width, feature, vars);
+            sprite_key_.stroke_opacity = get_optional<double>(sym, keys::stroke_opacity, feature, vars);
+            sprite_key_.gamma = get<value_double, keys::gamma>(sym, feature, vars);
+            sprite_key_.gamma_method = get<gamma_method_enum, keys::gamma_method>(sym, feature, vars);
+        }
     }
 
     ~vector_markers_rasterizer_dispatch() {}
 
     void render_marker(agg::trans_affine const& marker_tr, double opacity)
     {
-        render_vector_marker(svg_renderer_, ras_, renb_, this->src_->bounding_box(),
-                             marker_tr, opacity, snap_to_pixels_);
+        if (!use_sprites_ || !render_sprite(sprite_transform(marker_tr), opacity))
+        {
+            render_vector_marker(svg_renderer_, ras_, renb_, this->src_->bounding_box(),
+                                 marker_tr, opacity, snap_to_pixels_);
+        }
     }
 
 private:
+    // marker_tr with the rotation along the placement snapped to the
+    // sprite rotation buckets, keeping the marker center in place
+    agg::trans_affine sprite_transform(agg::trans_affine const& marker_tr) const
+    {
+        agg::trans_affine const& base = this->marker_trans_;
+        if (rotation_steps_ == 0 ||
+            (marker_tr.sx == base.sx && marker_tr.shy == base.shy &&
+             marker_tr.shx == base.shx && marker_tr.sy == base.sy))
+        {
+            return marker_tr;
+        }
+        // the placement rotation applies after the marker transform
+        agg::trans_affine linear(base.sx, base.shy, base.shx, base.sy, 0, 0);
+        agg::trans_affine placement = linear;
+        placement.invert();
+        placement *= agg::trans_affine(marker_tr.sx, marker_tr.shy, marker_tr.shx, marker_tr.sy, 0, 0);
+        double bucket = 2.0 * M_PI / rotation_steps_;
+        double angle = std::round(std::atan2(placement.shy, placement.sx) / bucket) * bucket;
+        linear *= agg::trans_affine_rotation(angle);
+        coord2d center = this->src_->bounding_box().center();
+        double cx = center.x;
+        double cy = center.y;
+        marker_tr.transform(&cx, &cy);
+        linear.tx = cx - (center.x * linear.sx + center.y * linear.shx);
+        linear.ty = cy - (center.x * linear.shy + center.y * linear.sy);
+        return linear;
+    }
+
+    // split a position into whole pixels and a 1/16 pixel remainder
+    static void split_position(double value, int & whole, int & frac)
+    {
+        double base = std::floor(value);
+        whole = static_cast<int>(base);
+        frac = static_cast<int>(std::floor((value - base) * 16 + .5));
+        if (frac == 16)
+        {
+            ++whole;
+            frac = 0;
+        }
+    }
+
+    marker_sprite_ptr make_sprite(agg::trans_affine const& sprite_tr, double opacity)
+    {
+        auto sprite = std::make_shared<marker_sprite>();
+        box2d<double> bbox = this->src_->bounding_box();
+        double x[4] = { bbox.minx(), bbox.maxx(), bbox.maxx(), bbox.minx() };
+        double y[4] = { bbox.miny(), bbox.miny(), bbox.maxy(), bbox.maxy() };
+        for (unsigned i = 0; i < 4; ++i) sprite_tr.transform(&x[i], &y[i]);
+        // room for strokes and antialiasing, clipping is caught below
+        double stroke = 0;
+        for (unsigned i = 0; i < attrs_.size(); ++i)
+        {
+            stroke = std::max(stroke, attrs_[i].stroke_width * std::max(1.0, attrs_[i].miter_limit));
+        }
+        double pad = 2 + std::ceil(stroke * std::sqrt(std::fabs(sprite_tr.determinant())));
+        int x0 = static_cast<int>(std::floor(*std::min_element(x, x + 4) - pad));
+        int y0 = static_cast<int>(std::floor(*std::min_element(y, y + 4) - pad));
+        int x1 = static_cast<int>(std::ceil(*std::max_element(x, x + 4) + pad));
+        int y1 = static_cast<int>(std::ceil(*std::max_element(y, y + 4) + pad));
+        if (x1 - x0 > 512 || y1 - y0 > 512)
+        {
+            sprite->direct = true;
+            return sprite;
+        }
+        image_rgba8 image(x1 - x0, y1 - y0);
+        image.set(0);
+        agg::rendering_buffer buf(image.getBytes(), image.width(), image.height(), image.getRowSize());
+        pixfmt_type pixf(buf);
+        pixf.comp_op(agg::comp_op_src_over);
+        renderer_base renb(pixf);
+        agg::trans_affine tr = sprite_tr;
+        tr.tx -= x0;
+        tr.ty -= y0;
+        // ras_ is clipped to the map, use a rasterizer clipped to the sprite
+        std::unique_ptr<rasterizer> ras_ptr(new rasterizer);
+        set_gamma_method(ras_ptr, sprite_key_.gamma, static_cast<gamma_method_enum>(sprite_key_.gamma_method));
+        ras_ptr->clip_box(0, 0, image.width(), image.height());
+        render_vector_marker(svg_renderer_, *ras_ptr, renb, bbox, tr, opacity, false);
+        // a sprite touching its border may have been clipped
+        unsigned width = image.width();
+        unsigned height = image.height();
+        for (unsigned i = 0; i < width; ++i)
+        {
+            if (image(i, 0) || image(i, height - 1)) sprite->direct = true;
+        }
+        for (unsigned j = 0; j < height; ++j)
+        {
+            if (image(0, j) || image(width - 1, j)) sprite->direct = true;
+        }
+        if (!sprite->direct)
+        {
+            sprite->image = std::move(image);
+            sprite->x = x0;
+            sprite->y = y0;
+        }
+        return sprite;
+    }
+
+    bool render_sprite(agg::trans_affine const& marker_tr, double opacity)
+    {
+        double tx = marker_tr.tx;
+        double ty = marker_tr.ty;
+        if (snap_to_pixels_)
+        {
+            tx = std::floor(tx + .5);
+            ty = std::floor(ty + .5);
+        }
+        int whole_x, whole_y;
+        marker_sprite_key & key = sprite_key_;
+        split_position(tx, whole_x, key.dx);
+        split_position(ty, whole_y, key.dy);
+        key.sx = marker_tr.sx;
+        key.shy = marker_tr.shy;
+        key.shx = marker_tr.shx;
+        key.sy = marker_tr.sy;
+        key.opacity = opacity;
+
+        marker_cache & cache = marker_cache::instance();
+        marker_sprite_ptr sprite = cache.find_sprite(key);
+        if (!sprite)
+        {
+            agg::trans_affine sprite_tr = marker_tr;
+            sprite_tr.tx = key.dx / 16.0;
+            sprite_tr.ty = key.dy / 16.0;
+            sprite = make_sprite(sprite_tr, opacity);
+            cache.insert_sprite(key, sprite);
+        }
+        if (sprite->direct) return false;
+        image_rgba8 const& image = sprite->image;
+        agg::rendering_buffer sprite_buf(const_cast<unsigned char *>(image.getBytes()),
+                                         image.width(), image.height(), image.getRowSize());
+        agg::pixfmt_rgba32_pre sprite_pixf(sprite_buf);
+        renb_.blend_from(sprite_pixf, 0, whole_x + sprite->x, whole_y + sprite->y, agg::cover_full);
+        return true;
+    }
+
     BufferType & buf_;
     pixfmt_type pixf_;
     renderer_base renb_;
     SvgRenderer svg_renderer_;
     RasterizerType & ras_;
     bool snap_to_pixels_;
+    svg_attribute_type const& attrs_;
+    bool use_sprites_;
+    unsigned rotation_steps_;
+    marker_sprite_key sprite_key_;
 };
 
 template <typename Detector, typename RendererContext>
@@ -146,6 +146,7 @@ source = Split(
     expression_grammar.cpp
     fs.cpp
     request.cpp
+    metatile.cpp
     well_known_srs.cpp
     params.cpp
     image_filter_types.cpp
@@ -162,6 +163,7 @@ source = Split(
     expression_node.cpp
     expression_string.cpp
     expression.cpp
+    compiled_expression.cpp
     transform_expression.cpp
     feature_kv_iterator.cpp
     feature_style_processor.cpp
@@ -182,6 +184,7 @@ source = Split(
     image_util_jpeg.cpp
     image_util_png.cpp
     image_util_tiff.cpp
+    tiff_tile_cache.cpp
     image_util_webp.cpp
     layer.cpp
     map.cpp
@@ -200,6 +203,7 @@ source = Split(
     simplify.cpp
     parse_transform.cpp
     memory_datasource.cpp
+    feature_cache.cpp
     symbolizer.cpp
     symbolizer_keys.cpp
     symbolizer_enumerations.cpp
@@ -212,6 +216,7 @@ source = Split(
     svg/svg_points_parser.cpp
     svg/svg_transform_parser.cpp
     warp.cpp
+    warp_mesh_cache.cpp
     css_color_grammar.cpp
     vertex_cache.cpp
     text/font_library.cpp
@@ -224,6 +229,8 @@ source = Split(
     text/placement_finder.cpp
     text/properties_util.cpp
     text/renderer.cpp
+    text/glyph_cache.cpp
+    text/shaping_cache.cpp
     text/symbolizer_helpers.cpp
     text/text_properties.cpp
     text/font_feature_settings.cpp
@@ -355,6 +362,7 @@ if env['GRID_RENDERER']:
     source += Split(
         """
         grid/grid.cpp
+        grid/grid_utf.cpp
         grid/grid_renderer.cpp
         grid/process_building_symbolizer.cpp
         grid/process_line_pattern_symbolizer.cpp
@@ -0,0 +1,417 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <limits>
+
+namespace mapnik
+{
+
+namespace {
+
+static const std::size_t unresolved = std::numeric_limits<std::size_t>::max();
+
+template <typename Tag> struct tag_opcode;
+template <> struct tag_opcode<tags::negate> { static const compiled_expression::opcode value = compiled_expression::opcode::negate; };
+template <> struct tag_opcode<tags::plus> { static const compiled_expression::opcode value = compiled_expression::opcode::plus; };
+template <> struct tag_opcode<tags::minus> { static const compiled_expression::opcode value = compiled_expression::opcode::minus; };
+template <> struct tag_opcode<tags::mult> { static const compiled_expression::opcode value = compiled_expression::opcode::mult; };
+template <> struct tag_opcode<tags::div> { static const compiled_expression::opcode value = compiled_expression::opcode::div; };
+template <> struct tag_opcode<tags::mod> { static const compiled_expression::opcode value = compiled_expression::opcode::mod; };
+template <> struct tag_opcode<tags::less> { static const compiled_expression::opcode value = compiled_expression::opcode::less; };
+template <> struct tag_opcode<tags::less_equal> { static const compiled_expression::opcode value = compiled_expression::opcode::less_equal; };
+template <> struct tag_opcode<tags::greater> { static const compiled_expression::opcode value = compiled_expression::opcode::greater; };
+template <> struct tag_opcode<tags::greater_equal> { static const compiled_expression::opcode value = compiled_expression::opcode::greater_equal; };
+template <> struct tag_opcode<tags::equal_to> { static const compiled_expression::opcode value = compiled_expression::opcode::equal_to; };
+template <> struct tag_opcode<tags::not_equal_to> { static const compiled_expression::opcode value = compiled_expression::opcode::not_equal_to; };
+template <> struct tag_opcode<tags::logical_not> { static const compiled_expression::opcode value = compiled_expression::opcode::logical_not; };
+template <> struct tag_opcode<tags::logical_and> { static const compiled_expression::opcode value = compiled_expression::opcode::logical_and; };
+template <> struct tag_opcode<tags::logical_or> { static const compiled_expression::opcode value = compiled_expression::opcode::logical_or; };
+
+}
+
+// Emits instructions in postfix order and returns the index of the
+// instruction computing the visited node.
+struct compile_expression
+{
+    using opcode = compiled_expression::opcode;
+    using instruction = compiled_expression::instruction;
+    using result_type = std::size_t;
+
+    compile_expression(compiled_expression & prog, feature_impl const& dummy)
+        : prog_(prog),
+          dummy_(dummy),
+          vars_() {}
+
+    std::size_t operator() (value_null const& val) const
+    {
+        return emit_constant(val);
+    }
+
+    std::size_t operator() (value_bool val) const
+    {
+        return emit_constant(val);
+    }
+
+    std::size_t operator() (value_integer val) const
+    {
+        return emit_constant(val);
+    }
+
+    std::size_t operator() (value_double val) const
+    {
+        return emit_constant(val);
+    }
+
+    std::size_t operator() (value_unicode_string const& str) const
+    {
+        return emit_constant(str);
+    }
+
+    std::size_t operator() (attribute const& attr) const
+    {
+        std::size_t slot = 0;
+        for (; slot < prog_.names_.size(); ++slot)
+        {
+            if (prog_.names_[slot] == attr.name()) break;
+        }
+        if (slot == prog_.names_.size())
+        {
+            prog_.names_.push_back(attr.name());
+            prog_.columns_.push_back(unresolved);
+        }
+        return emit(opcode::attribute, slot, 0);
+    }
+
+    std::size_t operator() (global_attribute const& attr) const
+    {
+        prog_.globals_.push_back(attr.name);
+        return emit(opcode::global_attribute, prog_.globals_.size() - 1, 0);
+    }
+
+    std::size_t operator() (geometry_type_attribute const&) const
+    {
+        return emit(opcode::geometry_type, 0, 0);
+    }
+
+    std::size_t operator() (binary_node<tags::logical_and> const& x) const
+    {
+        mark m = start();
+        std::size_t left = util::apply_visitor(*this, x.left);
+        if (is_constant(left))
+        {
+            // false and X => false
+            if (!constant(left).to_bool()) return fold_constant(m, value_bool(false));
+        }
+        std::size_t right = util::apply_visitor(*this, x.right);
+        std::size_t pc = emit(opcode::logical_and, left, right);
+        if (is_constant(left) && is_constant(right)) return fold(m, pc);
+        return pc;
+    }
+
+    std::size_t operator() (binary_node<tags::logical_or> const& x) const
+    {
+        mark m = start();
+        std::size_t left = util::apply_visitor(*this, x.left);
+        if (is_constant(left))
+        {
+            // true or X => true
+            if (constant(left).to_bool()) return fold_constant(m, value_bool(true));
+        }
+        std::size_t right = util::apply_visitor(*this, x.right);
+        std::size_t pc = emit(opcode::logical_or, left, right);
+        if (is_constant(left) && is_constant(right)) return fold(m, pc);
+        return pc;
+    }
+
+    template <typename Tag>
+    std::size_t operator() (binary_node<Tag> const& x) const
+    {
+        mark m = start();
+        std::size_t left = util::apply_visitor(*this, x.left);
+        std::size_t right = util::apply_visitor(*this, x.right);
+        std::size_t pc = emit(tag_opcode<Tag>::value, left, right);
+        if (is_constant(left) && is_constant(right)) return fold(m, pc);
+        return pc;
+    }
+
+    template <typename Tag>
+    std::size_t operator() (unary_node<Tag> const& x) const
+    {
+        mark m = start();
+        std::size_t arg = util::apply_visitor(*this, x.expr);
+        std::size_t pc = emit(tag_opcode<Tag>::value, arg, 0);
+        if (is_constant(arg)) return fold(m, pc);
+        return pc;
+    }
+
+    std::size_t operator() (regex_match_node const& x) const
+    {
+        mark m = start();
+        std::size_t arg = util::apply_visitor(*this, x.expr);
+        prog_.regex_match_.push_back(&x);
+        std::size_t pc = emit(opcode::regex_match, arg, 0, prog_.regex_match_.size() - 1);
+        if (is_constant(arg)) return fold(m, pc);
+        return pc;
+    }
+
+    std::size_t operator() (regex_replace_node const& x) const
+    {
+        mark m = start();
+        std::size_t arg = util::apply_visitor(*this, x.expr);
+        prog_.regex_replace_.push_back(&x);
+        std::size_t pc = emit(opcode::regex_replace, arg, 0, prog_.regex_replace_.size() - 1);
+        if (is_constant(arg)) return fold(m, pc);
+        return pc;
+    }
+
+    std::size_t operator() (unary_function_call const& call) const
+    {
+        mark m = start();
+        std::size_t arg = util::apply_visitor(*this, call.arg);
+        prog_.unary_calls_.push_back(&call);
+        std::size_t pc = emit(opcode::unary_call, arg, 0, prog_.unary_calls_.size() - 1);
+        if (is_constant(arg)) return fold(m, pc);
+        return pc;
+    }
+
+    std::size_t operator() (binary_function_call const& call) const
+    {
+        mark m = start();
+        std::size_t arg1 = util::apply_visitor(*this, call.arg1);
+        std::size_t arg2 = util::apply_visitor(*this, call.arg2);
+        prog_.binary_calls_.push_back(&call);
+        std::size_t pc = emit(opcode::binary_call, arg1, arg2, prog_.binary_calls_.size() - 1);
+        if (is_constant(arg1) && is_constant(arg2)) return fold(m, pc);
+        return pc;
+    }
+
+private:
+    struct mark
+    {
+        std::size_t code;
+        std::size_t constants;
+        std::size_t regex_match;
+        std::size_t regex_replace;
+        std::size_t unary_calls;
+        std::size_t binary_calls;
+    };
+
+    mark start() const
+    {
+        return mark{prog_.code_.size(), prog_.constants_.size(),
+                    prog_.regex_match_.size(), prog_.regex_replace_.size(),
+                    prog_.unary_calls_.size(), prog_.binary_calls_.size()};
+    }
+
+    std::size_t emit(opcode op, std::size_t arg0, std::size_t arg1, std::size_t aux = 0) const
+    {
+        prog_.code_.push_back(instruction{op, arg0, arg1, aux});
+        return prog_.code_.size() - 1;
+    }
+
+    std::size_t emit_constant(value_type const& val) const
+    {
+        prog_.constants_.push_back(val);
+        return emit(opcode::constant, prog_.constants_.size() - 1, 0);
+    }
+
+    bool is_constant(std::size_t pc) const
+    {
+        return prog_.code_[pc].op == opcode::constant;
+    }
+
+    value_type const& constant(std::size_t pc) const
+    {
+        return prog_.constants_[prog_.code_[pc].arg0];
+    }
+
+    // replace instructions emitted since `m` with a single constant and
+    // drop the nodes they referenced
+    std::size_t fold(mark const& m, std::size_t pc) const
+    {
+        return fold_constant(m, prog_.eval(pc, dummy_, vars_));
+    }
+
+    std::size_t fold_constant(mark const& m, value_type const& val) const
+    {
+        value_type result(val);
+        prog_.code_.resize(m.code);
+        prog_.constants_.resize(m.constants);
+        prog_.regex_match_.resize(m.regex_match);
+        prog_.regex_replace_.resize(m.regex_replace);
+        prog_.unary_calls_.resize(m.unary_calls);
+        prog_.binary_calls_.resize(m.binary_calls);
+        return emit_constant(result);
+    }
+
+    compiled_expression & prog_;
+    feature_impl const& dummy_;
+    attributes const vars_;
+};
+
+compiled_expression::compiled_expression(expression_ptr const& expr)
+    : expr_(expr),
+      code_(),
+      constants_(),
+      names_(),
+      columns_(),
+      globals_(),
+      regex_match_(),
+      regex_replace_(),
+      unary_calls_(),
+      binary_calls_(),
+      ctx_()
+{
+    if (expr_)
+    {
+        feature_impl dummy(std::make_shared<context_type>(), 0);
+        util::apply_visitor(compile_expression(*this, dummy), *expr_);
+    }
+    else
+    {
+        constants_.push_back(value_type());
+        code_.push_back(instruction{opcode::constant, 0, 0, 0});
+    }
+}
+
+void compiled_expression::bind(context_ptr const& ctx)
+{
+    if (ctx == ctx_) return;
+    ctx_ = ctx;
+    for (std::size_t i = 0; i < names_.size(); ++i)
+    {
+        columns_[i] = unresolved;
+        if (ctx_)
+        {
+            auto itr = ctx_->find(names_[i]);
+            if (itr != ctx_->end())
+            {
+                columns_[i] = itr->second;
+            }
+        }
+    }
+}
+
+value_type compiled_expression::evaluate(feature_impl const& feature, attributes const& vars) const
+{
+    return eval(code_.size() - 1, feature, vars);
+}
+
+value_type const& compiled_expression::operand(std::size_t pc,
+                                               feature_impl const& feature,
+                                               attributes const& vars,
+                                               value_type & tmp) const
+{
+    instruction const& ins = code_[pc];
+    if (ins.op == opcode::constant)
+    {
+        return constants_[ins.arg0];
+    }
+    else if (ins.op == opcode::attribute)
+    {
+        std::size_t column = columns_[ins.arg0];
+        if (column != unresolved) return feature.get(column);
+        return feature.get(names_[ins.arg0]);
+    }
+    tmp = eval(pc, feature, vars);
+    return tmp;
+}
+
+value_type compiled_expression::eval(std::size_t pc,
+                                     feature_impl const& feature,
+                                     attributes const& vars) const
+{
+    instruction const& ins = code_[pc];
+    value_type lhs_tmp, rhs_tmp;
+    switch (ins.op)
+    {
+    case opcode::constant:
+        return constants_[ins.arg0];
+    case opcode::attribute:
+    {
+        std::size_t column = columns_[ins.arg0];
+        if (column != unresolved) return feature.get(column);
+        return feature.get(names_[ins.arg0]);
+    }
+    case opcode::global_attribute:
+    {
+        auto itr = vars.find(globals_[ins.arg0]);
+        if (itr != vars.end())
+        {
+            return itr->second;
+        }
+        return value_type();
+    }
+    case opcode::geometry_type:
+        return geometry_type_attribute().value<value_type,feature_impl>(feature);
+    case opcode::negate:
+        return std::negate<value_type>()(operand(ins.arg0, feature, vars, lhs_tmp));
+    case opcode::plus:
+        return operand(ins.arg0, feature, vars, lhs_tmp) + operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::minus:
+        return operand(ins.arg0, feature, vars, lhs_tmp) - operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::mult:
+        return operand(ins.arg0, feature, vars, lhs_tmp) * operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::div:
+        return operand(ins.arg0, feature, vars, lhs_tmp) / operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::mod:
+        return operand(ins.arg0, feature, vars, lhs_tmp) % operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::less:
+        return operand(ins.arg0, feature, vars, lhs_tmp) < operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::less_equal:
+        return operand(ins.arg0, feature, vars, lhs_tmp) <= operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::greater:
+        return operand(ins.arg0, feature, vars, lhs_tmp) > operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::greater_equal:
+        return operand(ins.arg0, feature, vars, lhs_tmp) >= operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::equal_to:
+        return operand(ins.arg0, feature, vars, lhs_tmp) == operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::not_equal_to:
+        return operand(ins.arg0, feature, vars, lhs_tmp) != operand(ins.arg1, feature, vars, rhs_tmp);
+    case opcode::logical_not:
+        return !operand(ins.arg0, feature, vars, lhs_tmp).to_bool();
+    case opcode::logical_and:
+        return operand(ins.arg0, feature, vars, lhs_tmp).to_bool()
+            && operand(ins.arg1, feature, vars, rhs_tmp).to_bool();
+    case opcode::logical_or:
+        return operand(ins.arg0, feature, vars, lhs_tmp).to_bool()
+            || operand(ins.arg1, feature, vars, rhs_tmp).to_bool();
+    case opcode::regex_match:
+        return regex_match_[ins.aux]->apply(operand(ins.arg0, feature, vars, lhs_tmp));
+    case opcode::regex_replace:
+        return regex_replace_[ins.aux]->apply(operand(ins.arg0, feature, vars, lhs_tmp));
+    case opcode::unary_call:
+        return unary_calls_[ins.aux]->fun(operand(ins.arg0, feature, vars, lhs_tmp));
+    case opcode::binary_call:
+        return binary_calls_[ins.aux]->fun(operand(ins.arg0, feature, vars, lhs_tmp),
+                                           operand(ins.arg1, feature, vars, rhs_tmp));
+    }
+    return value_type();
+}
+
+}
@@ -0,0 +1,395 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/variant.hpp>
+#include <mapnik/util/featureset_buffer.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/unique_lock.hpp>
+#endif
+
+// boost
+#include <boost/functional/hash.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
+namespace mapnik
+{
+
+namespace {
+
+// resolutions are quantized to 1/band_steps of a power of two, so that
+// tiles of one zoom level share a grid despite rounding of their extents
+constexpr double band_steps = 1024.0;
+// queries spanning more cells than this go straight to the datasource
+constexpr std::int64_t max_cells = 1024;
+
+struct param_to_string
+{
+    param_to_string(std::ostringstream & s)
+        : s_(s) {}
+
+    void operator() (value_null) const {}
+
+    template <typename T>
+    void operator() (T const& val) const
+    {
+        s_ << val;
+    }
+
+    std::ostringstream & s_;
+};
+
+std::string datasource_key(datasource const& ds)
+{
+    std::ostringstream s;
+    s << std::setprecision(16);
+    for (auto const& param : ds.params())
+    {
+        s << param.first << '=';
+        util::apply_visitor(param_to_string(s), param.second);
+        s << '\n';
+    }
+    return s.str();
+}
+
+std::int64_t band(double val)
+{
+    return std::llround(std::log2(val) * band_steps);
+}
+
+std::string query_key(query const& q, std::int64_t band_x, std::int64_t band_y)
+{
+    std::ostringstream s;
+    s << std::setprecision(16);
+    s << band_x << ' ' << band_y << ' ';
+    if (q.scale_denominator() > 0) s << band(q.scale_denominator());
+    else s << q.scale_denominator();
+    s << ' ' << q.get_filter_factor() << '\n';
+    for (std::string const& name : q.property_names())
+    {
+        s << name << '\n';
+    }
+    std::vector<std::pair<std::string, std::string> > vars;
+    for (auto const& var : q.variables())
+    {
+        vars.emplace_back(var.first, var.second.to_string());
+    }
+    std::sort(vars.begin(), vars.end());
+    for (auto const& var : vars)
+    {
+        s << '@' << var.first << '=' << var.second << '\n';
+    }
+    return s.str();
+}
+
+// estimate of the memory held by a decoded feature
+std::size_t feature_bytes(feature_impl const& feature)
+{
+    std::size_t bytes = sizeof(feature_impl) + sizeof(feature_cell::value_type);
+    for (value const& val : feature.get_data())
+    {
+        bytes += sizeof(value);
+        if (val.is<value_unicode_string>())
+        {
+            bytes += val.get<value_unicode_string>().length() * sizeof(UChar);
+        }
+    }
+    for (geometry_type const& geom : feature.paths())
+    {
+        bytes += sizeof(geometry_type) + geom.size() * (2 * sizeof(double) + 1);
+    }
+    return bytes;
+}
+
+// cells filled by different queries hold their own copies of a feature,
+// so copies returned by several cells are told apart by id and envelope
+using feature_identity = std::tuple<value_integer, double, double, double, double>;
+
+struct feature_identity_hash
+{
+    std::size_t operator()(feature_identity const& identity) const
+    {
+        std::size_t seed = std::hash<value_integer>()(std::get<0>(identity));
+        boost::hash_combine(seed, std::get<1>(identity));
+        boost::hash_combine(seed, std::get<2>(identity));
+        boost::hash_combine(seed, std::get<3>(identity));
+        boost::hash_combine(seed, std::get<4>(identity));
+        return seed;
+    }
+};
+
+}
+
+std::size_t feature_cache_key_hash::operator()(feature_cache_key const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.datasource);
+    boost::hash_combine(seed, key.query);
+    boost::hash_combine(seed, key.x);
+    boost::hash_combine(seed, key.y);
+    return seed;
+}
+
+feature_cache::feature_cache()
+    : cells_(64 * 1024 * 1024),
+      cell_size_(256) {}
+
+featureset_ptr feature_cache::features(datasource const& ds, query const& q, processor_context_ptr const& ctx)
+{
+    // features returned by several cells are told apart by id, and memory
+    // datasources hold their features already and may change without their
+    // parameters changing
+    if (capacity() == 0 || ds.type() != datasource::Vector ||
+        !ds.has_stable_ids() ||
+        ds.params().find("type") == ds.params().end() ||
+        dynamic_cast<memory_datasource const*>(&ds) != nullptr)
+    {
+        return featureset_ptr();
+    }
+    box2d<double> const& box = q.get_bbox();
+    double res_x = std::get<0>(q.resolution());
+    double res_y = std::get<1>(q.resolution());
+    if (!box.valid() || !(res_x > 0) || !(res_y > 0) ||
+        !std::isfinite(res_x) || !std::isfinite(res_y))
+    {
+        return featureset_ptr();
+    }
+
+    // grid of the zoom band, cells are cell_size pixels of its resolution
+    std::int64_t band_x = band(res_x);
+    std::int64_t band_y = band(res_y);
+    double size = cell_size();
+    double cell_width = size / std::exp2(band_x / band_steps);
+    double cell_height = size / std::exp2(band_y / band_steps);
+    auto column = [cell_width](double x) { return static_cast<std::int64_t>(std::floor(x / cell_width)); };
+    auto row = [cell_height](double y) { return static_cast<std::int64_t>(std::floor(y / cell_height)); };
+    std::int64_t x0 = column(box.minx());
+    std::int64_t x1 = column(box.maxx());
+    std::int64_t y0 = row(box.miny());
+    std::int64_t y1 = row(box.maxy());
+    if ((x1 - x0 + 1) * (y1 - y0 + 1) > max_cells)
+    {
+        return featureset_ptr();
+    }
+
+    feature_cache_key key { datasource_key(ds), query_key(q, band_x, band_y), 0, 0 };
+    auto cell_extent = [cell_width, cell_height](std::int64_t x, std::int64_t y)
+        {
+            return box2d<double>(x * cell_width, y * cell_height,
+                                 (x + 1) * cell_width, (y + 1) * cell_height);
+        };
+    std::int64_t columns = x1 - x0 + 1;
+    std::vector<feature_cell_ptr> cells(static_cast<std::size_t>(columns * (y1 - y0 + 1)));
+    // cells missing from the cache, by their position in cells
+    std::vector<std::size_t> missing;
+    box2d<double> missing_box;
+    for (std::int64_t y = y0; y <= y1; ++y)
+    {
+        for (std::int64_t x = x0; x <= x1; ++x)
+        {
+            key.x = x;
+            key.y = y;
+            std::size_t index = static_cast<std::size_t>((y - y0) * columns + (x - x0));
+            cells[index] = cells_.find(key).first;
+            if (!cells[index])
+            {
+                if (missing.empty()) missing_box = cell_extent(x, y);
+                else missing_box.expand_to_include(cell_extent(x, y));
+                missing.push_back(index);
+            }
+        }
+    }
+
+    if (!missing.empty())
+    {
+        // one query over all missing cells, its features are split into
+        // the cells their envelope intersects
+        query batch_query(missing_box, q.resolution(), q.scale_denominator(), missing_box);
+        batch_query.set_filter_factor(q.get_filter_factor());
+        batch_query.set_variables(q.variables());
+        for (std::string const& name : q.property_names())
+        {
+            batch_query.add_property_name(name);
+        }
+        std::vector<std::shared_ptr<feature_cell> > filled(cells.size());
+        std::vector<std::size_t> bytes(cells.size(), 0);
+        for (std::size_t index : missing)
+        {
+            filled[index] = std::make_shared<feature_cell>();
+        }
+        auto add = [&filled, &bytes](std::size_t index, feature_ptr const& feature,
+                                     box2d<double> const& env, std::size_t size)
+            {
+                if (!filled[index]) return;
+                filled[index]->emplace_back(feature, env);
+                bytes[index] += size;
+            };
+        featureset_ptr fs = ds.features_with_context(batch_query, ctx);
+        if (fs)
+        {
+            while (feature_ptr feature = fs->next())
+            {
+                box2d<double> env = feature->envelope();
+                // features shared by several cells count fully in each
+                std::size_t size = feature_bytes(*feature);
+                if (feature->num_geometries() == 0)
+                {
+                    // returned by the query of every cell
+                    for (std::size_t index : missing) add(index, feature, env, size);
+                    continue;
+                }
+                // cells touching the envelope on their edge share it too
+                std::int64_t fx0 = std::max(x0, column(env.minx()) - 1);
+                std::int64_t fx1 = std::min(x1, column(env.maxx()));
+                std::int64_t fy0 = std::max(y0, row(env.miny()) - 1);
+                std::int64_t fy1 = std::min(y1, row(env.maxy()));
+                for (std::int64_t y = fy0; y <= fy1; ++y)
+                {
+                    for (std::int64_t x = fx0; x <= fx1; ++x)
+                    {
+                        if (env.intersects(cell_extent(x, y)))
+                        {
+                            add(static_cast<std::size_t>((y - y0) * columns + (x - x0)), feature, env, size);
+                        }
+                    }
+                }
+            }
+        }
+        for (std::size_t index : missing)
+        {
+            key.x = x0 + static_cast<std::int64_t>(index) % columns;
+            key.y = y0 + static_cast<std::int64_t>(index) / columns;
+            cells[index] = filled[index];
+            cells_.insert(key, std::make_pair(cells[index], cell_extent(key.x, key.y)), bytes[index]);
+        }
+    }
+
+    std::shared_ptr<featureset_buffer> result = std::make_shared<featureset_buffer>();
+    std::unordered_set<feature_identity, feature_identity_hash> seen;
+    for (feature_cell_ptr const& cell : cells)
+    {
+        // a feature spanning several cells is returned from the first
+        // scanned cell holding it, so datasources testing exact
+        // intersection don't lose features, and features outside of the
+        // query are skipped
+        for (auto const& item : *cell)
+        {
+            box2d<double> const& env = item.second;
+            if (item.first->num_geometries() > 0 && !env.intersects(box)) continue;
+            if (seen.emplace(item.first->id(), env.minx(), env.miny(), env.maxx(), env.maxy()).second)
+            {
+                result->push(item.first);
+            }
+        }
+    }
+    result->prepare();
+    return result;
+}
+
+void feature_cache::invalidate(datasource const& ds)
+{
+    std::string ds_key = datasource_key(ds);
+    cells_.erase_if([&ds_key](feature_cache_key const& key, std::pair<feature_cell_ptr, box2d<double> > const&)
+                    {
+                        return key.datasource == ds_key;
+                    });
+}
+
+void feature_cache::invalidate(datasource const& ds, box2d<double> const& extent)
+{
+    std::string ds_key = datasource_key(ds);
+    cells_.erase_if([&ds_key, &extent](feature_cache_key const& key, std::pair<feature_cell_ptr, box2d<double> > const& cell)
+                    {
+                        return key.datasource == ds_key && cell.second.intersects(extent);
+                    });
+}
+
+void feature_cache::clear()
+{
+    cells_.clear();
+}
+
+std::size_t feature_cache::size() const
+{
+    return cells_.size();
+}
+
+std::size_t feature_cache::memory_usage() const
+{
+    return cells_.usage();
+}
+
+void feature_cache::set_capacity(std::size_t capacity)
+{
+    cells_.set_capacity(capacity);
+}
+
+std::size_t feature_cache::capacity() const
+{
+    return cells_.capacity();
+}
+
+void feature_cache::set_cell_size(unsigned cell_size)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (cell_size == 0 || cell_size == cell_size_) return;
+    // cells of another size no longer line up with queries
+    cells_.clear();
+    cell_size_ = cell_size;
+}
+unsigned feature_cache::cell_size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return cell_size_;
+}
+
+std::size_t feature_cache::hits() const
+{
+    return cells_.hits();
+}
+
+std::size_t feature_cache::misses() const
+{
+    return cells_.misses();
+}
+
+void feature_cache::reset_stats()
+{
+    cells_.reset_stats();
+}
+
+}
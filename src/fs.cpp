@@ -134,6 +134,15 @@ namespace util {
         return listing;
     }
 
+    std::time_t last_write_time(std::string const& filepath)
+    {
+#ifdef _WINDOWS
+        return boost::filesystem::last_write_time(mapnik::utf8_to_utf16(filepath));
+#else
+        return boost::filesystem::last_write_time(filepath);
+#endif
+    }
+
 
 } // end namespace util
 
@@ -46,8 +46,7 @@ hit_grid<T>::hit_grid(int width, int height, std::string const& key)
       painted_(false),
       names_(),
       f_keys_(),
-      features_(),
-      ctx_(std::make_shared<mapnik::context_type>())
+      features_()
       {
           f_keys_[base_mask] = "";
           data_.set(base_mask);
@@ -63,8 +62,7 @@ hit_grid<T>::hit_grid(hit_grid<T> const& rhs)
       painted_(rhs.painted_),
       names_(rhs.names_),
       f_keys_(rhs.f_keys_),
-      features_(rhs.features_),
-      ctx_(rhs.ctx_)
+      features_(rhs.features_)
 {
     f_keys_[base_mask] = "";
     data_.set(base_mask);
@@ -79,7 +77,6 @@ void hit_grid<T>::clear()
     names_.clear();
     f_keys_[base_mask] = "";
     data_.set(base_mask);
-    ctx_ = std::make_shared<mapnik::context_type>();
 }
 
 template <typename T>
@@ -93,15 +90,6 @@ void hit_grid<T>::add_feature(mapnik::feature_impl const& feature)
         return;
     }
 
-    if (ctx_->size() == 0)
-    {
-        context_type::map_type::const_iterator itr = feature.context()->begin();
-        context_type::map_type::const_iterator end = feature.context()->end();
-        for ( ;itr!=end; ++itr)
-        {
-            ctx_->add(itr->first,itr->second);
-        }
-    }
     // NOTE: currently lookup keys must be strings,
     // but this should be revisited
     lookup_type lookup_value;
@@ -126,15 +114,21 @@ void hit_grid<T>::add_feature(mapnik::feature_impl const& feature)
         // TODO - consider shortcutting f_keys if feature_id == lookup_value
         // create a mapping between the pixel id and the feature key
         f_keys_.emplace(feature_id,lookup_value);
-        // if extra fields have been supplied, push them into grid memory
+        // if extra fields have been supplied, keep only their values
+        // instead of a copy of all attributes of the feature
         if (!names_.empty())
         {
-            // it is ~ 2x faster to copy feature attributes compared
-            // to building up a in-memory cache of feature_ptrs
-            // https://github.com/mapnik/mapnik/issues/1198
-            mapnik::feature_ptr feature2(mapnik::feature_factory::create(ctx_,feature_id));
-            feature2->set_data(feature.get_data());
-            features_.emplace(lookup_value,feature2);
+            grid_feature snapshot;
+            snapshot.id = feature.id();
+            snapshot.values.reserve(names_.size());
+            snapshot.has.reserve(names_.size());
+            for (std::string const& name : names_)
+            {
+                bool has = feature.has_key(name);
+                snapshot.values.push_back(has ? feature.get(name) : value());
+                snapshot.has.push_back(has);
+            }
+            features_.emplace(lookup_value,std::move(snapshot));
         }
     }
     else
@@ -0,0 +1,297 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_view.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+namespace {
+
+void append_codepoint(std::string & json, std::uint16_t code)
+{
+    if (code < 0x80)
+    {
+        json += static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+        json += static_cast<char>(0xc0 | (code >> 6));
+        json += static_cast<char>(0x80 | (code & 0x3f));
+    }
+    else if (code >= 0xd800 && code <= 0xdfff)
+    {
+        // surrogates can't be written as utf-8
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", code);
+        json += buf;
+    }
+    else
+    {
+        json += static_cast<char>(0xe0 | (code >> 12));
+        json += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        json += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+void append_string(std::string & json, std::string const& str)
+{
+    json += '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': json += "\\\""; break;
+        case '\\': json += "\\\\"; break;
+        case '\n': json += "\\n"; break;
+        case '\r': json += "\\r"; break;
+        case '\t': json += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                json += buf;
+            }
+            else
+            {
+                json += c;
+            }
+        }
+    }
+    json += '"';
+}
+
+struct append_value
+{
+    append_value(std::string & json)
+        : json_(json) {}
+
+    void operator() (value_null) const
+    {
+        json_ += "null";
+    }
+
+    void operator() (value_bool val) const
+    {
+        json_ += val ? "true" : "false";
+    }
+
+    void operator() (value_integer val) const
+    {
+        json_ += std::to_string(val);
+    }
+
+    void operator() (value_double val) const
+    {
+        if (!std::isfinite(val))
+        {
+            json_ += "null";
+            return;
+        }
+        // shortest of 15 or 17 digits reading back as the same double
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.15g", val);
+        if (std::strtod(buf, nullptr) != val)
+        {
+            std::snprintf(buf, sizeof(buf), "%.17g", val);
+        }
+        json_ += buf;
+    }
+
+    void operator() (value_unicode_string const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        append_string(json_, utf8);
+    }
+
+    std::string & json_;
+};
+
+}
+
+template <typename T>
+void grid2utf(T const& grid, utf_grid & utf, unsigned resolution)
+{
+    using value_type = typename T::value_type;
+    if (resolution == 0) resolution = 1;
+    typename T::feature_key_type const& feature_keys = grid.get_feature_keys();
+    utf.width = (grid.width() + resolution - 1) / resolution;
+    utf.height = (grid.height() + resolution - 1) / resolution;
+    utf.codes.resize(utf.width * utf.height);
+    utf.keys.clear();
+
+    // codepoints by pixel id, and by key as several ids may share a key
+    std::unordered_map<value_type, std::uint16_t> id_codes;
+    std::unordered_map<std::string, std::uint16_t> key_codes;
+    // start counting at utf8 codepoint 32, aka space character
+    std::uint16_t codepoint = 32;
+    std::string const empty_key;
+    auto code = [&](value_type id)
+    {
+        auto id_pos = id_codes.find(id);
+        if (id_pos != id_codes.end()) return id_pos->second;
+        auto feature_pos = feature_keys.find(id);
+        std::string const& key = feature_pos != feature_keys.end() ? feature_pos->second : empty_key;
+        auto key_pos = key_codes.find(key);
+        std::uint16_t result;
+        if (key_pos == key_codes.end())
+        {
+            // Create a new entry for this key. Skip the codepoints that
+            // can't be encoded directly in JSON.
+            if (codepoint == 34) ++codepoint;      // Skip "
+            else if (codepoint == 92) ++codepoint; // Skip backslash
+            result = codepoint++;
+            key_codes.emplace(key, result);
+            utf.keys.push_back(key);
+        }
+        else
+        {
+            result = key_pos->second;
+        }
+        id_codes.emplace(id, result);
+        return result;
+    };
+
+    std::uint16_t * out = utf.codes.data();
+    for (unsigned y = 0; y < grid.height(); y += resolution)
+    {
+        value_type const* row = grid.getRow(y);
+        // neighbouring pixels mostly belong to the same feature
+        value_type last_id = row[0];
+        std::uint16_t last_code = code(last_id);
+        for (unsigned x = 0; x < grid.width(); x += resolution)
+        {
+            if (row[x] != last_id)
+            {
+                last_id = row[x];
+                last_code = code(last_id);
+            }
+            *out++ = last_code;
+        }
+    }
+}
+
+template <typename T>
+void grid_encode_utf(T const& grid, std::string & json, bool add_features, unsigned resolution)
+{
+    utf_grid utf;
+    grid2utf(grid, utf, resolution);
+
+    json.reserve(json.size() + utf.codes.size() + utf.height * 3 + utf.keys.size() * 8 + 32);
+    json += "{\"grid\":[";
+    std::uint16_t const* code = utf.codes.data();
+    for (unsigned y = 0; y < utf.height; ++y)
+    {
+        if (y > 0) json += ',';
+        json += '"';
+        for (unsigned x = 0; x < utf.width; ++x)
+        {
+            append_codepoint(json, *code++);
+        }
+        json += '"';
+    }
+    json += "],\"keys\":[";
+    for (std::size_t i = 0; i < utf.keys.size(); ++i)
+    {
+        if (i > 0) json += ',';
+        append_string(json, utf.keys[i]);
+    }
+    json += "],\"data\":{";
+    if (add_features)
+    {
+        typename T::feature_type const& features = grid.get_grid_features();
+        std::set<std::string> const& fields = grid.get_fields();
+        append_value write_value(json);
+        bool first = true;
+        for (std::string const& key : utf.keys)
+        {
+            if (key.empty()) continue;
+            auto feature_pos = features.find(key);
+            if (feature_pos == features.end()) continue;
+            grid_feature const& feature = feature_pos->second;
+            // features without any of the fields are left out
+            std::size_t mark = json.size();
+            if (!first) json += ',';
+            append_string(json, key);
+            json += ":{";
+            bool found = false;
+            bool first_field = true;
+            std::size_t index = 0;
+            for (std::string const& field : fields)
+            {
+                bool id = field == grid.key_name();
+                if (id || (index < feature.has.size() && feature.has[index]))
+                {
+                    if (!first_field) json += ',';
+                    append_string(json, field);
+                    json += ':';
+                    if (id)
+                    {
+                        write_value(feature.id);
+                    }
+                    else
+                    {
+                        util::apply_visitor(write_value, feature.values[index]);
+                        found = true;
+                    }
+                    first_field = false;
+                }
+                ++index;
+            }
+            if (found)
+            {
+                json += '}';
+                first = false;
+            }
+            else
+            {
+                json.resize(mark);
+            }
+        }
+    }
+    json += "}}";
+}
+
+template MAPNIK_DECL void grid2utf(grid const&, utf_grid &, unsigned);
+template MAPNIK_DECL void grid2utf(grid_view const&, utf_grid &, unsigned);
+template MAPNIK_DECL void grid_encode_utf(grid const&, std::string &, bool, unsigned);
+template MAPNIK_DECL void grid_encode_utf(grid_view const&, std::string &, bool, unsigned);
+
+}
+
+#endif
@@ -24,6 +24,9 @@
 #include <mapnik/image_compositing.hpp>
 #include <mapnik/image.hpp>
 #include <mapnik/image_any.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 // boost
 #pragma GCC diagnostic push
@@ -42,6 +45,10 @@
 #include "agg_pixfmt_gray.h"
 #include "agg_color_rgba.h"
 
+// stl
+#include <algorithm>
+#include <cstdint>
+
 
 namespace mapnik
 {
@@ -146,6 +153,202 @@ struct rendering_buffer
     image_type const& data_;
 };
 
+// Span kernels for the most common modes. The scalar code is agg's
+// comp_op_rgba_* called directly instead of through the comp_op table,
+// the SSE2 code processes four pixels at a time with identical results.
+using color_type = agg::rgba8;
+using order_type = agg::order_rgba;
+
+#ifdef SSE_MATH
+
+static inline __m128i expand_lo(__m128i v)
+{
+    return _mm_unpacklo_epi8(v, _mm_setzero_si128());
+}
+
+static inline __m128i expand_hi(__m128i v)
+{
+    return _mm_unpackhi_epi8(v, _mm_setzero_si128());
+}
+
+// agg's value_type cast keeps the low 8 bits
+static inline __m128i pack(__m128i lo, __m128i hi)
+{
+    __m128i mask = _mm_set1_epi16(0xff);
+    return _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+}
+
+static inline __m128i broadcast_alpha(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+// (v * cover + 255) >> 8
+static inline __m128i apply_cover(__m128i v, __m128i cover)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(v, cover), _mm_set1_epi16(255)), 8);
+}
+
+// (a * b + 255) >> 8
+static inline __m128i mul_255(__m128i a, __m128i b)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(255)), 8);
+}
+
+#endif
+
+struct src_over_kernel
+{
+    // fully transparent source pixels leave the destination unchanged
+    static constexpr bool skip_empty = true;
+    using op = agg::comp_op_rgba_src_over<color_type, order_type>;
+#ifdef SSE_MATH
+    static inline __m128i blend(__m128i d, __m128i s, __m128i cover, bool partial)
+    {
+        if (partial) s = apply_cover(s, cover);
+        __m128i s1a = _mm_sub_epi16(_mm_set1_epi16(255), broadcast_alpha(s));
+        return _mm_add_epi16(s, mul_255(d, s1a));
+    }
+#endif
+};
+
+struct dst_out_kernel
+{
+    // agg's rounding alters the destination even for transparent source
+    static constexpr bool skip_empty = false;
+    using op = agg::comp_op_rgba_dst_out<color_type, order_type>;
+#ifdef SSE_MATH
+    static inline __m128i blend(__m128i d, __m128i s, __m128i cover, bool partial)
+    {
+        __m128i sa = broadcast_alpha(s);
+        if (partial) sa = apply_cover(sa, cover);
+        sa = _mm_sub_epi16(_mm_set1_epi16(255), sa);
+        // agg rounds with base_shift here
+        return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, sa), _mm_set1_epi16(8)), 8);
+    }
+#endif
+};
+
+struct screen_kernel
+{
+    static constexpr bool skip_empty = true;
+    using op = agg::comp_op_rgba_screen<color_type, order_type>;
+#ifdef SSE_MATH
+    static inline __m128i blend(__m128i d, __m128i s, __m128i cover, bool partial)
+    {
+        if (partial) s = apply_cover(s, cover);
+        __m128i result = _mm_sub_epi16(_mm_add_epi16(s, d), mul_255(s, d));
+        // pixels with zero source alpha are left untouched
+        __m128i keep = _mm_cmpeq_epi16(broadcast_alpha(s), _mm_setzero_si128());
+        return _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, result));
+    }
+#endif
+};
+
+struct multiply_kernel
+{
+    static constexpr bool skip_empty = true;
+    using op = agg::comp_op_rgba_multiply<color_type, order_type>;
+#ifdef SSE_MATH
+    static inline __m128i blend(__m128i d, __m128i s, __m128i cover, bool partial)
+    {
+        if (partial) s = apply_cover(s, cover);
+        __m128i sa = broadcast_alpha(s);
+        __m128i da = broadcast_alpha(d);
+        __m128i s1a = _mm_sub_epi16(_mm_set1_epi16(255), sa);
+        __m128i d1a = _mm_sub_epi16(_mm_set1_epi16(255), da);
+        // Sca.(Dca + 1 - Da) + Dca.(1 - Sa) needs 32 bits: pair up the
+        // factors and let madd sum both products
+        __m128i a = _mm_add_epi16(d, d1a);
+        __m128i rounding = _mm_set1_epi32(255);
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(s, d), _mm_unpacklo_epi16(a, s1a));
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(s, d), _mm_unpackhi_epi16(a, s1a));
+        lo = _mm_srli_epi32(_mm_add_epi32(lo, rounding), 8);
+        hi = _mm_srli_epi32(_mm_add_epi32(hi, rounding), 8);
+        __m128i color = _mm_packs_epi32(lo, hi);
+        // Da' = Sa + Da - Sa.Da
+        __m128i alpha = _mm_sub_epi16(_mm_add_epi16(s, d), mul_255(s, d));
+        __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+        __m128i result = _mm_or_si128(_mm_and_si128(alpha_lanes, alpha), _mm_andnot_si128(alpha_lanes, color));
+        __m128i keep = _mm_cmpeq_epi16(sa, _mm_setzero_si128());
+        return _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, result));
+    }
+#endif
+};
+
+template <typename Kernel>
+void composite_span(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    unsigned x = 0;
+#ifdef SSE_MATH
+    __m128i cover16 = _mm_set1_epi16(cover);
+    bool partial = cover < 255;
+    for (; x < ROUND_DOWN(len, 4); x += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + x * 4));
+        if (Kernel::skip_empty &&
+            _mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_setzero_si128())) == 0xffff)
+        {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + x * 4));
+        __m128i lo = Kernel::blend(expand_lo(d), expand_lo(s), cover16, partial);
+        __m128i hi = Kernel::blend(expand_hi(d), expand_hi(s), cover16, partial);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), pack(lo, hi));
+    }
+#endif
+    for (; x < len; ++x)
+    {
+        std::uint8_t const* s = src + x * 4;
+        if (Kernel::skip_empty && (s[0] | s[1] | s[2] | s[3]) == 0) continue;
+        Kernel::op::blend_pix(dst + x * 4,
+                              s[order_type::R], s[order_type::G], s[order_type::B], s[order_type::A],
+                              cover);
+    }
+}
+
+template <typename Kernel>
+void composite_rows(image_rgba8 & dst, image_rgba8 const& src, unsigned cover, int dx, int dy)
+{
+    // same clipping as agg::renderer_base::blend_from
+    int x0 = std::max(dx, 0);
+    int y0 = std::max(dy, 0);
+    int x1 = std::min(dx + static_cast<int>(src.width()), static_cast<int>(dst.width()));
+    int y1 = std::min(dy + static_cast<int>(src.height()), static_cast<int>(dst.height()));
+    if (x1 <= x0 || y1 <= y0) return;
+    for (int y = y0; y < y1; ++y)
+    {
+        std::uint8_t * dst_row = reinterpret_cast<std::uint8_t*>(dst.getRow(y) + x0);
+        std::uint8_t const* src_row = reinterpret_cast<std::uint8_t const*>(src.getRow(y - dy) + (x0 - dx));
+        composite_span<Kernel>(dst_row, src_row, x1 - x0, cover);
+    }
+}
+
+// returns false when mode has no dedicated kernel
+bool composite_kernel(image_rgba8 & dst, image_rgba8 const& src, composite_mode_e mode,
+                      unsigned cover, int dx, int dy)
+{
+    // agg walks rows and spans backwards for overlapping buffers
+    if (&dst == &src) return false;
+    switch (mode)
+    {
+    case src_over:
+        composite_rows<src_over_kernel>(dst, src, cover, dx, dy);
+        return true;
+    case dst_out:
+        composite_rows<dst_out_kernel>(dst, src, cover, dx, dy);
+        return true;
+    case multiply:
+        composite_rows<multiply_kernel>(dst, src, cover, dx, dy);
+        return true;
+    case screen:
+        composite_rows<screen_kernel>(dst, src, cover, dx, dy);
+        return true;
+    default:
+        return false;
+    }
+}
+
 } // end detail ns
 
 template <>
@@ -176,8 +379,10 @@ MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_
         throw std::runtime_error("DESTINATION MUST BE PREMULTIPLIED FOR COMPOSITING!");
     }    
 #endif
+    agg::int8u cover = unsigned(255*opacity);
+    if (detail::composite_kernel(dst, src, mode, cover, dx, dy)) return;
     renderer_type ren(pixf);
-    ren.blend_from(pixf_mask,0,dx,dy,unsigned(255*opacity));
+    ren.blend_from(pixf_mask,0,dx,dy,cover);
 }
 
 template <>
@@ -63,6 +63,22 @@ inline boost::optional<std::string> type_from_bytes(char const* data, size_t siz
     return result_type();
 }
 
+unsigned image_reader::level_for_factor(double factor) const
+{
+    unsigned best = 0;
+    for (unsigned level = 1; level < levels(); ++level)
+    {
+        unsigned w = level_width(level);
+        unsigned h = level_height(level);
+        if (w == 0 || h == 0) continue;
+        if (double(width()) / w <= factor && double(height()) / h <= factor)
+        {
+            best = level;
+        }
+    }
+    return best;
+}
+
 image_reader* get_image_reader(char const* data, size_t size)
 {
     boost::optional<std::string> type = type_from_bytes(data,size);
@@ -105,6 +105,13 @@ void handle_png_options(std::string const& type,
                 throw ImageWriterException("invalid trans_mode parameter: " + t.substr(2));
             }
         }
+        else if (boost::algorithm::starts_with(t, "p="))
+        {
+            if (!mapnik::util::string2int(t.substr(2),opts.threads) || opts.threads < 1)
+            {
+                throw ImageWriterException("invalid threads parameter: " + t.substr(2));
+            }
+        }
         else if (boost::algorithm::starts_with(t, "g="))
         {
             set_gamma = true;
@@ -243,6 +243,24 @@ void map_parser::parse_map(Map & map, xml_node const& node, std::string const& b
                 map.set_buffer_size(*buffer_size);
             }
 
+            optional<unsigned> query_threads = map_node.get_opt_attr<unsigned>("query-threads");
+            if (query_threads)
+            {
+                map.set_query_threads(*query_threads);
+            }
+
+            optional<unsigned> filter_threads = map_node.get_opt_attr<unsigned>("filter-threads");
+            if (filter_threads)
+            {
+                map.set_filter_threads(*filter_threads);
+            }
+
+            optional<unsigned> warp_threads = map_node.get_opt_attr<unsigned>("warp-threads");
+            if (warp_threads)
+            {
+                map.set_warp_threads(*warp_threads);
+            }
+
             optional<std::string> maximum_extent = map_node.get_opt_attr<std::string>("maximum-extent");
             if (maximum_extent)
             {
@@ -620,6 +638,13 @@ void map_parser::parse_layer(Map & map, xml_node const& node)
             lyr.set_cache_features(* cache_features);
         }
 
+        optional<mapnik::boolean_type> shared_feature_cache =
+            node.get_opt_attr<mapnik::boolean_type>("shared-feature-cache");
+        if (shared_feature_cache)
+        {
+            lyr.set_shared_feature_cache(* shared_feature_cache);
+        }
+
         optional<std::string> group_by =
             node.get_opt_attr<std::string>("group-by");
         if (group_by)
@@ -68,6 +68,9 @@ Map::Map()
     height_(400),
     srs_(MAPNIK_LONGLAT_PROJ),
     buffer_size_(0),
+    query_threads_(0),
+    filter_threads_(0),
+    warp_threads_(0),
     background_image_comp_op_(src_over),
     background_image_opacity_(1.0),
     aspectFixMode_(GROW_BBOX),
@@ -82,6 +85,9 @@ Map::Map(int width,int height, std::string const& srs)
       height_(height),
       srs_(srs),
       buffer_size_(0),
+      query_threads_(0),
+      filter_threads_(0),
+      warp_threads_(0),
       background_image_comp_op_(src_over),
       background_image_opacity_(1.0),
       aspectFixMode_(GROW_BBOX),
@@ -96,6 +102,9 @@ Map::Map(Map const& rhs)
       height_(rhs.height_),
       srs_(rhs.srs_),
       buffer_size_(rhs.buffer_size_),
+      query_threads_(rhs.query_threads_),
+      filter_threads_(rhs.filter_threads_),
+      warp_threads_(rhs.warp_threads_),
       background_(rhs.background_),
       background_image_(rhs.background_image_),
       background_image_comp_op_(rhs.background_image_comp_op_),
@@ -119,6 +128,9 @@ Map::Map(Map && rhs)
       height_(std::move(rhs.height_)),
       srs_(std::move(rhs.srs_)),
       buffer_size_(std::move(rhs.buffer_size_)),
+      query_threads_(std::move(rhs.query_threads_)),
+      filter_threads_(std::move(rhs.filter_threads_)),
+      warp_threads_(std::move(rhs.warp_threads_)),
       background_(std::move(rhs.background_)),
       background_image_(std::move(rhs.background_image_)),
       background_image_comp_op_(std::move(rhs.background_image_comp_op_)),
@@ -150,6 +162,9 @@ void swap (Map & lhs, Map & rhs)
     std::swap(lhs.height_, rhs.height_);
     std::swap(lhs.srs_, rhs.srs_);
     std::swap(lhs.buffer_size_, rhs.buffer_size_);
+    std::swap(lhs.query_threads_, rhs.query_threads_);
+    std::swap(lhs.filter_threads_, rhs.filter_threads_);
+    std::swap(lhs.warp_threads_, rhs.warp_threads_);
     std::swap(lhs.background_, rhs.background_);
     std::swap(lhs.background_image_, rhs.background_image_);
     std::swap(lhs.background_image_comp_op_, rhs.background_image_comp_op_);
@@ -174,6 +189,9 @@ bool Map::operator==(Map const& rhs) const
         (height_ == rhs.height_) &&
         (srs_ == rhs.srs_) &&
         (buffer_size_ == rhs.buffer_size_) &&
+        (query_threads_ == rhs.query_threads_) &&
+        (filter_threads_ == rhs.filter_threads_) &&
+        (warp_threads_ == rhs.warp_threads_) &&
         (background_ == rhs.background_) &&
         (background_image_ == rhs.background_image_) &&
         (background_image_comp_op_ == rhs.background_image_comp_op_) &&
@@ -432,6 +450,36 @@ int Map::buffer_size() const
     return buffer_size_;
 }
 
+void Map::set_query_threads(unsigned threads)
+{
+    query_threads_ = threads;
+}
+
+unsigned Map::query_threads() const
+{
+    return query_threads_;
+}
+
+void Map::set_filter_threads(unsigned threads)
+{
+    filter_threads_ = threads;
+}
+
+unsigned Map::filter_threads() const
+{
+    return filter_threads_;
+}
+
+void Map::set_warp_threads(unsigned threads)
+{
+    warp_threads_ = threads;
+}
+
+unsigned Map::warp_threads() const
+{
+    return warp_threads_;
+}
+
 boost::optional<color> const& Map::background() const
 {
     return background_;
@@ -39,6 +39,7 @@
 #pragma GCC diagnostic ignored "-Wunused-local-typedef"
 #include <boost/assert.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/functional/hash.hpp>
 #pragma GCC diagnostic pop
 
 // agg
@@ -48,8 +49,42 @@
 namespace mapnik
 {
 
+namespace {
+
+template <typename T>
+void hash_optional(std::size_t & seed, boost::optional<T> const& val)
+{
+    boost::hash_combine(seed, static_cast<bool>(val));
+    if (val) boost::hash_combine(seed, *val);
+}
+
+}
+
+std::size_t marker_sprite_key_hash::operator()(marker_sprite_key const& key) const
+{
+    std::size_t seed = 0;
+    boost::hash_combine(seed, key.path);
+    hash_optional(seed, key.fill);
+    hash_optional(seed, key.fill_opacity);
+    hash_optional(seed, key.stroke);
+    hash_optional(seed, key.stroke_width);
+    hash_optional(seed, key.stroke_opacity);
+    boost::hash_combine(seed, key.sx);
+    boost::hash_combine(seed, key.shy);
+    boost::hash_combine(seed, key.shx);
+    boost::hash_combine(seed, key.sy);
+    boost::hash_combine(seed, key.dx);
+    boost::hash_combine(seed, key.dy);
+    boost::hash_combine(seed, key.opacity);
+    boost::hash_combine(seed, key.gamma);
+    boost::hash_combine(seed, key.gamma_method);
+    return seed;
+}
+
 marker_cache::marker_cache()
-    : known_svg_prefix_("shape://"),
+    : sprites_(1024),
+      sprite_rotation_steps_(0),
+      known_svg_prefix_("shape://"),
       known_image_prefix_("image://")
 {
     insert_svg("ellipse",
@@ -85,6 +120,37 @@ void marker_cache::clear()
             ++itr;
         }
     }
+    sprites_.clear();
+}
+
+marker_sprite_ptr marker_cache::find_sprite(marker_sprite_key const& key)
+{
+    return sprites_.find(key);
+}
+
+void marker_cache::insert_sprite(marker_sprite_key const& key, marker_sprite_ptr const& sprite)
+{
+    sprites_.insert(key, sprite);
+}
+
+void marker_cache::set_sprite_capacity(std::size_t capacity)
+{
+    sprites_.set_capacity(capacity);
+}
+
+std::size_t marker_cache::sprite_capacity() const
+{
+    return sprites_.capacity();
+}
+
+void marker_cache::set_sprite_rotation_steps(unsigned steps)
+{
+    sprite_rotation_steps_ = steps;
+}
+
+unsigned marker_cache::sprite_rotation_steps() const
+{
+    return sprite_rotation_steps_;
 }
 
 bool marker_cache::is_svg_uri(std::string const& path)
@@ -0,0 +1,188 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/well_known_srs.hpp>
+
+// stl
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+namespace mapnik
+{
+
+metatile::metatile(unsigned z,
+                   unsigned x,
+                   unsigned y,
+                   unsigned size,
+                   unsigned tile_size)
+    : z_(z),
+      x_(0),
+      y_(0),
+      columns_(0),
+      rows_(0),
+      tile_size_(tile_size)
+{
+    if (z > 30)
+    {
+        throw std::runtime_error("metatile: zoom level must be 30 or less");
+    }
+    if (size == 0 || tile_size == 0)
+    {
+        throw std::runtime_error("metatile: size and tile size must be greater than 0");
+    }
+    unsigned num_tiles = 1u << z;
+    if (x >= num_tiles || y >= num_tiles)
+    {
+        std::ostringstream s;
+        s << "metatile: tile " << z << "/" << x << "/" << y << " is outside of the tile pyramid";
+        throw std::runtime_error(s.str());
+    }
+    x_ = x - x % size;
+    y_ = y - y % size;
+    columns_ = std::min(size, num_tiles - x_);
+    rows_ = std::min(size, num_tiles - y_);
+}
+
+unsigned metatile::z() const
+{
+    return z_;
+}
+
+unsigned metatile::x() const
+{
+    return x_;
+}
+
+unsigned metatile::y() const
+{
+    return y_;
+}
+
+unsigned metatile::columns() const
+{
+    return columns_;
+}
+
+unsigned metatile::rows() const
+{
+    return rows_;
+}
+
+unsigned metatile::tile_size() const
+{
+    return tile_size_;
+}
+
+unsigned metatile::width() const
+{
+    return columns_ * tile_size_;
+}
+
+unsigned metatile::height() const
+{
+    return rows_ * tile_size_;
+}
+
+box2d<double> metatile::extent() const
+{
+    double span = EARTH_CIRCUMFERENCE / (1u << z_);
+    double minx = -MAXEXTENT + x_ * span;
+    double maxy = MAXEXTENT - y_ * span;
+    return box2d<double>(minx, maxy - rows_ * span, minx + columns_ * span, maxy);
+}
+
+namespace {
+
+template <typename Encoder>
+std::vector<metatile_tile> render_metatile_impl(Map const& map,
+                                                metatile const& mt,
+                                                attributes const& vars,
+                                                double scale_factor,
+                                                Encoder const& encode)
+{
+    request req(mt.width(), mt.height(), mt.extent());
+    req.set_buffer_size(map.buffer_size());
+    image_rgba8 image(mt.width(), mt.height());
+    agg_renderer<image_rgba8> ren(map, req, vars, image, scale_factor);
+    // queries the layers like a map render, in parallel with query threads
+    ren.apply(req);
+
+    unsigned tile_size = mt.tile_size();
+    std::vector<metatile_tile> tiles;
+    tiles.reserve(mt.columns() * mt.rows());
+    for (unsigned row = 0; row < mt.rows(); ++row)
+    {
+        for (unsigned col = 0; col < mt.columns(); ++col)
+        {
+            tiles.emplace_back(mt.z(), mt.x() + col, mt.y() + row, tile_size);
+            metatile_tile & tile = tiles.back();
+            tile.image.set_premultiplied(image.get_premultiplied());
+            for (unsigned y = 0; y < tile_size; ++y)
+            {
+                image_rgba8::pixel_type const* src = image.getRow(row * tile_size + y, col * tile_size);
+                std::copy(src, src + tile_size, tile.image.getRow(y));
+            }
+            encode(tile);
+        }
+    }
+    return tiles;
+}
+
+}
+
+std::vector<metatile_tile> render_metatile(Map const& map,
+                                           metatile const& mt,
+                                           attributes const& vars,
+                                           double scale_factor,
+                                           std::string const& format)
+{
+    return render_metatile_impl(map, mt, vars, scale_factor, [&](metatile_tile & tile)
+    {
+        if (!format.empty())
+        {
+            tile.encoded = save_to_string(tile.image, format);
+        }
+    });
+}
+
+std::vector<metatile_tile> render_metatile(Map const& map,
+                                           metatile const& mt,
+                                           std::string const& format,
+                                           rgba_palette const& palette,
+                                           attributes const& vars,
+                                           double scale_factor)
+{
+    return render_metatile_impl(map, mt, vars, scale_factor, [&](metatile_tile & tile)
+    {
+        tile.encoded = save_to_string(tile.image, format, palette);
+    });
+}
+
+}
@@ -119,66 +119,88 @@ unsigned char rgba_palette::quantize(unsigned val) const
     }
     else
     {
-        rgba c(val);
-        int dr, dg, db, da;
-        int dist, newdist;
-
-        // find closest match based on mean of r,g,b,a
-        std::vector<rgba>::const_iterator pit =
-            std::lower_bound(sorted_pal_.begin(), sorted_pal_.end(), c, rgba::mean_sort_cmp());
-        index = std::distance(sorted_pal_.begin(),pit);
-        if (index == sorted_pal_.size()) index--;
-
-        dr = sorted_pal_[index].r - c.r;
-        dg = sorted_pal_[index].g - c.g;
-        db = sorted_pal_[index].b - c.b;
-        da = sorted_pal_[index].a - c.a;
-        dist = dr*dr + dg*dg + db*db + da*da;
-        int poz = index;
-
-        // search neighbour positions in both directions for better match
-        for (int i = poz - 1; i >= 0; i--)
+        index = find_nearest(val);
+        // Cache found index for the color c into the hashmap.
+        color_hashmap_[val] = index;
+    }
+
+    return index;
+}
+
+unsigned char rgba_palette::quantize_uncached(unsigned val) const
+{
+    if (colors_ == 1 || val == 0) return 0;
+    return find_nearest(val);
+}
+
+unsigned char rgba_palette::find_nearest(unsigned val) const
+{
+    rgba c(val);
+    int dr, dg, db, da;
+    int dist, newdist;
+
+    // find closest match based on mean of r,g,b,a
+    std::vector<rgba>::const_iterator pit =
+        std::lower_bound(sorted_pal_.begin(), sorted_pal_.end(), c, rgba::mean_sort_cmp());
+    unsigned char index = std::distance(sorted_pal_.begin(),pit);
+    if (index == sorted_pal_.size()) index--;
+
+    dr = sorted_pal_[index].r - c.r;
+    dg = sorted_pal_[index].g - c.g;
+    db = sorted_pal_[index].b - c.b;
+    da = sorted_pal_[index].a - c.a;
+    dist = dr*dr + dg*dg + db*db + da*da;
+    int poz = index;
+
+    if (dist == 0)
+    {
+        // palette colors are cached by parse() with the last of any
+        // duplicate entries, return the same one
+        while (index + 1u < sorted_pal_.size() && sorted_pal_[index + 1] == c)
         {
-            dr = sorted_pal_[i].r - c.r;
-            dg = sorted_pal_[i].g - c.g;
-            db = sorted_pal_[i].b - c.b;
-            da = sorted_pal_[i].a - c.a;
-            // stop criteria based on properties of used sorting
-            if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
-            {
-                break;
-            }
-            newdist = dr*dr + dg*dg + db*db + da*da;
-            if (newdist < dist)
-            {
-                index = i;
-                dist = newdist;
-            }
+            ++index;
         }
+        return index;
+    }
 
-        for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
+    // search neighbour positions in both directions for better match
+    for (int i = poz - 1; i >= 0; i--)
+    {
+        dr = sorted_pal_[i].r - c.r;
+        dg = sorted_pal_[i].g - c.g;
+        db = sorted_pal_[i].b - c.b;
+        da = sorted_pal_[i].a - c.a;
+        // stop criteria based on properties of used sorting
+        if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
         {
-            dr = sorted_pal_[i].r - c.r;
-            dg = sorted_pal_[i].g - c.g;
-            db = sorted_pal_[i].b - c.b;
-            da = sorted_pal_[i].a - c.a;
-            // stop criteria based on properties of used sorting
-            if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
-            {
-                break;
-            }
-            newdist = dr*dr + dg*dg + db*db + da*da;
-            if (newdist < dist)
-            {
-                index = i;
-                dist = newdist;
-            }
+            break;
+        }
+        newdist = dr*dr + dg*dg + db*db + da*da;
+        if (newdist < dist)
+        {
+            index = i;
+            dist = newdist;
         }
-
-        // Cache found index for the color c into the hashmap.
-        color_hashmap_[val] = index;
     }
 
+    for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
+    {
+        dr = sorted_pal_[i].r - c.r;
+        dg = sorted_pal_[i].g - c.g;
+        db = sorted_pal_[i].b - c.b;
+        da = sorted_pal_[i].a - c.a;
+        // stop criteria based on properties of used sorting
+        if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
+        {
+            break;
+        }
+        newdist = dr*dr + dg*dg + db*db + da*da;
+        if (newdist < dist)
+        {
+            index = i;
+            dist = newdist;
+        }
+    }
     return index;
 }
 
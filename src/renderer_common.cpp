@@ -41,7 +41,8 @@ renderer_common::renderer_common(Map const& map, unsigned width, unsigned height
      font_manager_(font_library_,map.get_font_file_mapping(),map.get_font_memory_cache()),
      query_extent_(),
      t_(t),
-     detector_(detector)
+     detector_(detector),
+     warp_threads_(map.warp_threads())
 {}
 
 renderer_common::renderer_common(Map const &m, attributes const& vars, unsigned offset_x, unsigned offset_y,
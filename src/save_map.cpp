@@ -551,6 +551,11 @@ void serialize_layer( ptree & map_node, const layer & layer, bool explicit_defau
         set_attr/*<bool>*/( layer_node, "cache-features", layer.cache_features() );
     }
 
+    if ( layer.shared_feature_cache() || explicit_defaults )
+    {
+        set_attr/*<bool>*/( layer_node, "shared-feature-cache", layer.shared_feature_cache() );
+    }
+
     if ( layer.group_by() != "" || explicit_defaults )
     {
         set_attr( layer_node, "group-by", layer.group_by() );
@@ -631,6 +636,24 @@ void serialize_map(ptree & pt, Map const& map, bool explicit_defaults)
         set_attr( map_node, "buffer-size", buffer_size );
     }
 
+    unsigned query_threads = map.query_threads();
+    if ( query_threads || explicit_defaults)
+    {
+        set_attr( map_node, "query-threads", query_threads );
+    }
+
+    unsigned filter_threads = map.filter_threads();
+    if ( filter_threads || explicit_defaults)
+    {
+        set_attr( map_node, "filter-threads", filter_threads );
+    }
+
+    unsigned warp_threads = map.warp_threads();
+    if ( warp_threads || explicit_defaults)
+    {
+        set_attr( map_node, "warp-threads", warp_threads );
+    }
+
     std::string const& base_path = map.base_path();
     if ( !base_path.empty() || explicit_defaults)
     {
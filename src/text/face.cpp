@@ -28,11 +28,26 @@ extern "C"
 #include FT_GLYPH_H
 }
 
+// harfbuzz
+#include <harfbuzz/hb.h>
+#include <harfbuzz/hb-ft.h>
+
 namespace mapnik
 {
 
-font_face::font_face(FT_Face face)
-    : face_(face) {}
+font_face::font_face(FT_Face face, std::string const& file_name)
+    : face_(face),
+      file_name_(file_name),
+      hb_font_(nullptr) {}
+
+hb_font_t * font_face::hb_font()
+{
+    if (!hb_font_)
+    {
+        hb_font_ = hb_ft_font_create(face_, nullptr);
+    }
+    return hb_font_;
+}
 
 bool font_face::set_character_sizes(double size)
 {
@@ -78,6 +93,7 @@ font_face::~font_face()
         "font_face: Clean up face \"" << family_name() <<
         " " << style_name() << "\"";
 
+    if (hb_font_) hb_font_destroy(hb_font_);
     FT_Done_Face(face_);
 }
 
@@ -0,0 +1,148 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/text/glyph_cache.hpp>
+
+// boost
+#include <boost/functional/hash.hpp>
+
+namespace mapnik
+{
+
+std::size_t glyph_bitmap_key_hash::operator()(glyph_bitmap_key const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.font_file);
+    boost::hash_combine(seed, key.face_index);
+    boost::hash_combine(seed, key.glyph_index);
+    boost::hash_combine(seed, key.size);
+    boost::hash_combine(seed, key.halo_radius);
+    boost::hash_combine(seed, key.xx);
+    boost::hash_combine(seed, key.xy);
+    boost::hash_combine(seed, key.yx);
+    boost::hash_combine(seed, key.yy);
+    boost::hash_combine(seed, key.dx);
+    boost::hash_combine(seed, key.dy);
+    return seed;
+}
+
+namespace {
+
+std::size_t bitmap_bytes(glyph_bitmap_key const& key, glyph_bitmap_ptr const& bitmap)
+{
+    std::size_t bytes = sizeof(glyph_bitmap_key) + key.font_file.size() + sizeof(glyph_bitmap);
+    if (bitmap) bytes += bitmap->buffer.size();
+    return bytes;
+}
+
+}
+
+constexpr std::size_t glyph_cache::num_shards;
+
+glyph_cache::glyph_cache()
+    : shards_(),
+      capacity_(0),
+      subpixel_steps_(64),
+      rotation_steps_(0)
+{
+    set_capacity(8 * 1024 * 1024);
+}
+
+glyph_cache::shard_type & glyph_cache::shard(glyph_bitmap_key const& key)
+{
+    // the glyphs of a label spread over the shards, while all offsets
+    // and rotations of a glyph share one
+    return shards_[key.glyph_index % num_shards];
+}
+
+glyph_bitmap_ptr glyph_cache::find(glyph_bitmap_key const& key)
+{
+    return shard(key).find(key);
+}
+
+void glyph_cache::insert(glyph_bitmap_key const& key, glyph_bitmap_ptr const& bitmap)
+{
+    shard(key).insert(key, bitmap, bitmap_bytes(key, bitmap));
+}
+
+void glyph_cache::clear()
+{
+    for (shard_type & s : shards_) s.clear();
+}
+
+std::size_t glyph_cache::size() const
+{
+    std::size_t count = 0;
+    for (shard_type const& s : shards_) count += s.size();
+    return count;
+}
+
+std::size_t glyph_cache::memory_usage() const
+{
+    std::size_t bytes = 0;
+    for (shard_type const& s : shards_) bytes += s.usage();
+    return bytes;
+}
+
+void glyph_cache::set_capacity(std::size_t capacity)
+{
+    capacity_ = capacity;
+    for (shard_type & s : shards_) s.set_capacity(capacity / num_shards);
+}
+
+std::size_t glyph_cache::capacity() const
+{
+    return capacity_;
+}
+
+void glyph_cache::set_subpixel_steps(unsigned steps)
+{
+    if (steps < 1) steps = 1;
+    if (steps > 64) steps = 64;
+    if (subpixel_steps_.exchange(steps) != steps)
+    {
+        // bitmaps were rendered at offsets of the previous grid
+        clear();
+    }
+}
+
+unsigned glyph_cache::subpixel_steps() const
+{
+    return subpixel_steps_;
+}
+
+void glyph_cache::set_rotation_steps(unsigned steps)
+{
+    if (rotation_steps_.exchange(steps) != steps)
+    {
+        // bitmaps were rendered at rotations of the previous buckets
+        clear();
+    }
+}
+
+unsigned glyph_cache::rotation_steps() const
+{
+    return rotation_steps_;
+}
+
+}
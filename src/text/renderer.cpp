@@ -26,9 +26,17 @@
 #include <mapnik/text/text_properties.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 #include <mapnik/text/face.hpp>
+#include <mapnik/text/glyph_cache.hpp>
+#include <mapnik/global.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_any.hpp>
 
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
 namespace mapnik
 {
 
@@ -109,6 +117,140 @@ void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y
     }
 }
 
+namespace {
+
+bool is_translation(agg::trans_affine const& tr)
+{
+    return tr.sx == 1.0 && tr.sy == 1.0 && tr.shx == 0.0 && tr.shy == 0.0;
+}
+
+// split a 26.6 position into whole pixels and a subpixel remainder
+// snapped to the cache grid
+void split_position(FT_Pos value, unsigned steps, FT_Pos & whole, FT_Pos & frac)
+{
+    whole = value & ~63;
+    frac = value - whole;
+    if (steps < 64)
+    {
+        FT_Pos step = (frac * steps + 32) / 64;
+        if (step == static_cast<FT_Pos>(steps))
+        {
+            whole += 64;
+            step = 0;
+        }
+        frac = step * 64 / steps;
+    }
+}
+
+glyph_bitmap_ptr rasterize_glyph(glyph_info const& glyph, double size,
+                                 FT_Matrix & matrix, FT_Vector & delta,
+                                 double halo_radius, stroker_ptr const& stroker)
+{
+    glyph.face->set_character_sizes(size);
+    FT_Face face = glyph.face->get_face();
+    FT_Set_Transform(face, &matrix, &delta);
+    if (FT_Load_Glyph(face, glyph.glyph_index, FT_LOAD_NO_HINTING)) return glyph_bitmap_ptr();
+    FT_Glyph image;
+    if (FT_Get_Glyph(face->glyph, &image)) return glyph_bitmap_ptr();
+    if (halo_radius > 0.0)
+    {
+        stroker->init(halo_radius);
+        FT_Glyph_Stroke(&image, stroker->get(), 1);
+    }
+    glyph_bitmap_ptr result;
+    if (!FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, 0, 1))
+    {
+        FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
+        auto bitmap = std::make_shared<glyph_bitmap>();
+        bitmap->left = bit->left;
+        bitmap->top = bit->top;
+        bitmap->width = bit->bitmap.width;
+        bitmap->rows = bit->bitmap.rows;
+        bitmap->buffer.resize(bitmap->width * bitmap->rows);
+        for (unsigned row = 0; row < bitmap->rows; ++row)
+        {
+            std::copy_n(bit->bitmap.buffer + row * std::abs(bit->bitmap.pitch),
+                        bitmap->width,
+                        bitmap->buffer.begin() + row * bitmap->width);
+        }
+        result = bitmap;
+    }
+    FT_Done_Glyph(image);
+    return result;
+}
+
+// snap a glyph rotation to the nearest of steps buckets per turn
+rotation quantize_rotation(rotation const& rot, unsigned steps)
+{
+    if (steps == 0 || rot.sin == 0.0) return rot;
+    double bucket = 2.0 * M_PI / steps;
+    return rotation(std::round(std::atan2(rot.sin, rot.cos) / bucket) * bucket);
+}
+
+// look up the bitmap of a glyph placed at start, rasterizing on a miss.
+// whole receives the pixel aligned part of the position (26.6) which
+// the caller adds to the bitmap origin. key is reused between glyphs so
+// lookups of the same face do not copy the font file name.
+glyph_bitmap_ptr cached_glyph_bitmap(glyph_cache & cache, unsigned steps, unsigned rotation_steps,
+                                     glyph_position const& glyph_pos,
+                                     FT_Vector const& start, double scale_factor,
+                                     double halo_radius, stroker_ptr const& stroker,
+                                     glyph_bitmap_key & key, FT_Vector & whole)
+{
+    glyph_info const& glyph = glyph_pos.glyph;
+    double size = glyph.format->text_size * scale_factor;
+    // only the bitmap is drawn at the bucket angle, the glyph keeps its
+    // exact position along the path
+    rotation rot = quantize_rotation(glyph_pos.rot, rotation_steps);
+    FT_Matrix matrix;
+    matrix.xx = static_cast<FT_Fixed>( rot.cos * 0x10000L);
+    matrix.xy = static_cast<FT_Fixed>(-rot.sin * 0x10000L);
+    matrix.yx = static_cast<FT_Fixed>( rot.sin * 0x10000L);
+    matrix.yy = static_cast<FT_Fixed>( rot.cos * 0x10000L);
+
+    pixel_position pos = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
+    FT_Vector delta;
+    split_position(static_cast<FT_Pos>(pos.x * 64) + start.x, steps, whole.x, delta.x);
+    split_position(static_cast<FT_Pos>(pos.y * 64) + start.y, steps, whole.y, delta.y);
+
+    if (key.font_file != glyph.face->file_name())
+    {
+        key.font_file = glyph.face->file_name();
+    }
+    key.face_index = glyph.face->face_index();
+    key.glyph_index = glyph.glyph_index;
+    key.size = static_cast<long>(size * 64);
+    key.halo_radius = static_cast<long>(halo_radius * 64);
+    key.xx = matrix.xx;
+    key.xy = matrix.xy;
+    key.yx = matrix.yx;
+    key.yy = matrix.yy;
+    key.dx = static_cast<int>(delta.x);
+    key.dy = static_cast<int>(delta.y);
+
+    glyph_bitmap_ptr bitmap = cache.find(key);
+    if (!bitmap)
+    {
+        bitmap = rasterize_glyph(glyph, size, matrix, delta, halo_radius, stroker);
+        if (bitmap) cache.insert(key, bitmap);
+    }
+    return bitmap;
+}
+
+FT_Bitmap bitmap_view(glyph_bitmap const& bitmap)
+{
+    FT_Bitmap view = FT_Bitmap();
+    view.width = bitmap.width;
+    view.rows = bitmap.rows;
+    view.pitch = bitmap.width;
+    view.buffer = const_cast<unsigned char*>(bitmap.buffer.data());
+    view.num_grays = 256;
+    view.pixel_mode = FT_PIXEL_MODE_GRAY;
+    return view;
+}
+
+}
+
 template <typename T>
 agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          halo_rasterizer_e rasterizer,
@@ -122,6 +264,11 @@ agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
 template <typename T>
 void agg_text_renderer<T>::render(glyph_positions const& pos)
 {
+    if (is_translation(transform_) && is_translation(halo_transform_))
+    {
+        render_cached(pos);
+        return;
+    }
     glyphs_.clear();
     prepare_glyphs(pos);
     FT_Error  error;
@@ -229,6 +376,67 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
 
 }
 
+template <typename T>
+void agg_text_renderer<T>::render_cached(glyph_positions const& pos)
+{
+    glyph_cache & cache = glyph_cache::instance();
+    unsigned steps = cache.subpixel_steps();
+    unsigned rotation_steps = cache.rotation_steps();
+    FT_Vector start;
+    FT_Vector start_halo;
+    int height = pixmap_.height();
+    pixel_position const& base_point = pos.get_base_point();
+
+    start.x =  static_cast<FT_Pos>(base_point.x * (1 << 6));
+    start.y =  static_cast<FT_Pos>((height - base_point.y) * (1 << 6));
+    start_halo = start;
+    start.x += transform_.tx * 64;
+    start.y += transform_.ty * 64;
+    start_halo.x += halo_transform_.tx * 64;
+    start_halo.y += halo_transform_.ty * 64;
+
+    FT_Vector whole;
+    glyph_bitmap_key key;
+    for (auto const& glyph_pos : pos)
+    {
+        detail::evaluated_format_properties const& format = *glyph_pos.glyph.format;
+        double halo_radius = format.halo_radius * scale_factor_;
+        // make sure we've got reasonable values.
+        if (halo_radius <= 0.0 || halo_radius > 1024.0) continue;
+        bool full = rasterizer_ == HALO_RASTERIZER_FULL;
+        // the fast rasterizer spreads the plain glyph bitmap
+        glyph_bitmap_ptr bitmap = cached_glyph_bitmap(cache, steps, rotation_steps, glyph_pos, start_halo, scale_factor_,
+                                                      full ? halo_radius : 0.0, stroker_, key, whole);
+        if (!bitmap) continue;
+        FT_Bitmap view = bitmap_view(*bitmap);
+        int x = bitmap->left + whole.x / 64;
+        int y = height - (bitmap->top + whole.y / 64);
+        if (full)
+        {
+            composite_bitmap(pixmap_, &view, format.halo_fill.rgba(), x, y,
+                             format.halo_opacity, halo_comp_op_);
+        }
+        else
+        {
+            render_halo(&view, format.halo_fill.rgba(), x, y,
+                        halo_radius, format.halo_opacity, halo_comp_op_);
+        }
+    }
+
+    // render actual text
+    for (auto const& glyph_pos : pos)
+    {
+        detail::evaluated_format_properties const& format = *glyph_pos.glyph.format;
+        glyph_bitmap_ptr bitmap = cached_glyph_bitmap(cache, steps, rotation_steps, glyph_pos, start, scale_factor_,
+                                                      0.0, stroker_, key, whole);
+        if (!bitmap) continue;
+        FT_Bitmap view = bitmap_view(*bitmap);
+        composite_bitmap(pixmap_, &view, format.fill.rgba(),
+                         bitmap->left + whole.x / 64,
+                         height - (bitmap->top + whole.y / 64),
+                         format.text_opacity, comp_op_);
+    }
+}
 
 template <typename T>
 void grid_text_renderer<T>::render(glyph_positions const& pos, value_integer feature_id)
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/text/shaping_cache.hpp>
+
+// boost
+#include <boost/functional/hash.hpp>
+
+namespace mapnik
+{
+
+std::size_t shaping_key_hash::operator()(shaping_key const& key) const
+{
+    std::size_t seed = static_cast<std::size_t>(key.text.hashCode());
+    boost::hash_combine(seed, key.start);
+    boost::hash_combine(seed, key.end);
+    boost::hash_combine(seed, key.size);
+    boost::hash_combine(seed, key.faces);
+    for (auto const& feature : key.features)
+    {
+        boost::hash_combine(seed, feature.tag);
+        boost::hash_combine(seed, feature.value);
+        boost::hash_combine(seed, feature.start);
+        boost::hash_combine(seed, feature.end);
+    }
+    boost::hash_combine(seed, static_cast<int>(key.script));
+    boost::hash_combine(seed, static_cast<int>(key.direction));
+    return seed;
+}
+
+shaping_cache::shaping_cache()
+    : runs_(4096) {}
+
+shaped_run_ptr shaping_cache::find(shaping_key const& key)
+{
+    return runs_.find(key);
+}
+
+void shaping_cache::insert(shaping_key const& key, shaped_run_ptr const& run)
+{
+    runs_.insert(key, run);
+}
+
+void shaping_cache::clear()
+{
+    runs_.clear();
+}
+
+std::size_t shaping_cache::size() const
+{
+    return runs_.size();
+}
+
+void shaping_cache::set_capacity(std::size_t capacity)
+{
+    runs_.set_capacity(capacity);
+}
+
+std::size_t shaping_cache::capacity() const
+{
+    return runs_.capacity();
+}
+
+}
@@ -23,6 +23,9 @@
 // mapnik
 #include <mapnik/debug.hpp>
 #include <mapnik/image_reader.hpp>
+#include <mapnik/tiff_tile_cache.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/util/parallel_for.hpp>
 
 extern "C"
 {
@@ -38,7 +41,13 @@ extern "C"
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
+#include <ctime>
+#include <istream>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace mapnik { namespace impl {
 
@@ -100,6 +109,36 @@ static int tiff_map_proc(thandle_t, tdata_t* , toff_t*)
     return 0;
 }
 
+static TIFF* tiff_client_open(std::istream & input)
+{
+    return TIFFClientOpen("tiff_input_stream", "rcm",
+                          reinterpret_cast<thandle_t>(&input),
+                          tiff_read_proc,
+                          tiff_write_proc,
+                          tiff_seek_proc,
+                          tiff_close_proc,
+                          tiff_size_proc,
+                          tiff_map_proc,
+                          tiff_unmap_proc);
+}
+
+// independent streams over the same tiff, one per decoding thread
+inline std::unique_ptr<std::istream> reopen_stream(boost::iostreams::file_source &, std::string const& file_name)
+{
+    using stream_type = boost::iostreams::stream<boost::iostreams::file_source>;
+    return std::unique_ptr<std::istream>(
+        new stream_type(boost::iostreams::file_source(file_name, std::ios_base::in | std::ios_base::binary)));
+}
+
+inline std::unique_ptr<std::istream> reopen_stream(boost::iostreams::array_source & source, std::string const&)
+{
+    using stream_type = boost::iostreams::stream<boost::iostreams::array_source>;
+    std::pair<char*, char*> data = source.input_sequence();
+    std::unique_ptr<std::istream> stream(new stream_type(boost::iostreams::array_source(data.first, data.second)));
+    stream->rdbuf()->pubsetbuf(0, 0);
+    return stream;
+}
+
 }
 
 template <typename T>
@@ -120,6 +159,21 @@ class tiff_reader : public image_reader
         }
     };
 
+    // full resolution image or one of its overviews
+    struct tiff_level
+    {
+        // directory in this file, or level of the external overviews
+        unsigned directory;
+        bool external;
+        std::size_t width;
+        std::size_t height;
+        int read_method;
+        int rows_per_strip;
+        int tile_width;
+        int tile_height;
+        bool is_tiled;
+    };
+
 private:
     source_type source_;
     input_stream stream_;
@@ -139,6 +193,11 @@ private:
     unsigned compression_;
     bool has_alpha_;
     bool is_tiled_;
+    std::string file_name_;
+    std::time_t modified_;
+    unsigned directory_;
+    std::vector<tiff_level> levels_;
+    std::unique_ptr<tiff_reader<boost::iostreams::file_source> > overviews_;
 
 public:
     enum TiffType {
@@ -155,6 +214,11 @@ public:
     inline bool has_alpha() const final { return has_alpha_; }
     void read(unsigned x,unsigned y,image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    unsigned levels() const final;
+    unsigned level_width(unsigned level) const final;
+    unsigned level_height(unsigned level) const final;
+    image_any read_level(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height) final;
+    void set_threads(unsigned threads) final;
     // methods specific to tiff reader
     unsigned bits_per_sample() const { return bps_; }
     unsigned sample_format() const { return sample_format_; }
@@ -169,6 +233,9 @@ private:
     tiff_reader(const tiff_reader&);
     tiff_reader& operator=(const tiff_reader&);
     void init();
+    void init_levels(TIFF* tif);
+    void init_external_levels(std::string const& file_name);
+    void set_level(tiff_level const& level);
     void read_generic(unsigned x,unsigned y,image_rgba8& image);
     void read_stripped(unsigned x,unsigned y,image_rgba8& image);
 
@@ -217,10 +284,20 @@ tiff_reader<T>::tiff_reader(std::string const& file_name)
       planar_config_(PLANARCONFIG_CONTIG),
       compression_(COMPRESSION_NONE),
       has_alpha_(false),
-      is_tiled_(false)
+      is_tiled_(false),
+      file_name_(file_name),
+      modified_(0),
+      directory_(0),
+      levels_(),
+      overviews_()
 {
     if (!stream_) throw image_reader_exception("TIFF reader: cannot open file "+ file_name);
     init();
+    modified_ = util::last_write_time(file_name);
+    if (levels_.size() == 1)
+    {
+        init_external_levels(file_name + ".ovr");
+    }
 }
 
 template <typename T>
@@ -241,7 +318,12 @@ tiff_reader<T>::tiff_reader(char const* data, std::size_t size)
       planar_config_(PLANARCONFIG_CONTIG),
       compression_(COMPRESSION_NONE),
       has_alpha_(false),
-      is_tiled_(false)
+      is_tiled_(false),
+      file_name_(),
+      modified_(0),
+      directory_(0),
+      levels_(),
+      overviews_()
 {
     if (!stream_) throw image_reader_exception("TIFF reader: cannot open image stream ");
     stream_.rdbuf()->pubsetbuf(0, 0);
@@ -349,6 +431,95 @@ void tiff_reader<T>::init()
             }
         }
     }
+    init_levels(tif);
+}
+
+template <typename T>
+void tiff_reader<T>::init_levels(TIFF* tif)
+{
+    levels_.push_back({0, false, width_, height_, read_method_, rows_per_strip_,
+                       tile_width_, tile_height_, is_tiled_});
+    // Overviews follow the image as reduced resolution directories
+    // with the same sample layout
+    tdir_t count = TIFFNumberOfDirectories(tif);
+    if (count < 2) return;
+    for (tdir_t dir = 1; dir < count; ++dir)
+    {
+        if (!TIFFSetDirectory(tif, dir)) break;
+        uint32 subfile_type = 0;
+        TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &subfile_type);
+        if (!(subfile_type & FILETYPE_REDUCEDIMAGE) || (subfile_type & FILETYPE_MASK)) continue;
+        uint16 bps = 0;
+        uint16 sample_format = SAMPLEFORMAT_UINT;
+        uint16 photometric = 0;
+        uint16 bands = 1;
+        uint16 planar_config = PLANARCONFIG_CONTIG;
+        TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+        TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &sample_format);
+        TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+        TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &bands);
+        TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planar_config);
+        if (bps != bps_ || sample_format != sample_format_ || photometric != photometric_ ||
+            bands != bands_ || planar_config != planar_config_) continue;
+        uint32 width = 0;
+        uint32 height = 0;
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        if (width == 0 || height == 0 || width >= width_ || height >= height_) continue;
+        tiff_level level = {static_cast<unsigned>(dir), false, width, height, generic, 0, 0, 0, false};
+        uint32 rows_per_strip = 0;
+        if (TIFFIsTiled(tif))
+        {
+            uint32 tile_width = 0;
+            uint32 tile_height = 0;
+            TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tile_width);
+            TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_height);
+            level.tile_width = tile_width;
+            level.tile_height = tile_height;
+            level.is_tiled = true;
+            level.read_method = tiled;
+        }
+        else if (TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip) != 0)
+        {
+            level.rows_per_strip = rows_per_strip;
+            level.read_method = stripped;
+        }
+        levels_.push_back(level);
+    }
+    TIFFSetDirectory(tif, 0);
+    std::stable_sort(levels_.begin() + 1, levels_.end(),
+                     [](tiff_level const& a, tiff_level const& b) { return a.width > b.width; });
+    MAPNIK_LOG_DEBUG(tiff_reader) << "overviews: " << levels_.size() - 1;
+}
+
+template <typename T>
+void tiff_reader<T>::init_external_levels(std::string const& file_name)
+{
+    if (!util::exists(file_name)) return;
+    try
+    {
+        overviews_.reset(new tiff_reader<boost::iostreams::file_source>(file_name));
+    }
+    catch (std::exception const& ex)
+    {
+        MAPNIK_LOG_DEBUG(tiff_reader) << "can't read overviews " << file_name << ": " << ex.what();
+        return;
+    }
+    if (overviews_->bits_per_sample() != bps_ || overviews_->sample_format() != sample_format_ ||
+        overviews_->photometric() != photometric_)
+    {
+        overviews_.reset();
+        return;
+    }
+    for (unsigned level = 0; level < overviews_->levels(); ++level)
+    {
+        std::size_t width = overviews_->level_width(level);
+        std::size_t height = overviews_->level_height(level);
+        if (width < width_ && height < height_)
+        {
+            levels_.push_back({level, true, width, height, generic, 0, 0, 0, false});
+        }
+    }
 }
 
 template <typename T>
@@ -374,6 +545,78 @@ boost::optional<box2d<double> > tiff_reader<T>::bounding_box() const
     return bbox_;
 }
 
+// external overviews are decoded with the same number of threads
+template <typename T>
+void tiff_reader<T>::set_threads(unsigned threads)
+{
+    threads_ = threads;
+    if (overviews_) overviews_->set_threads(threads);
+}
+
+template <typename T>
+unsigned tiff_reader<T>::levels() const
+{
+    return levels_.size();
+}
+
+template <typename T>
+unsigned tiff_reader<T>::level_width(unsigned level) const
+{
+    return level < levels_.size() ? levels_[level].width : width_;
+}
+
+template <typename T>
+unsigned tiff_reader<T>::level_height(unsigned level) const
+{
+    return level < levels_.size() ? levels_[level].height : height_;
+}
+
+template <typename T>
+void tiff_reader<T>::set_level(tiff_level const& level)
+{
+    directory_ = level.directory;
+    width_ = level.width;
+    height_ = level.height;
+    read_method_ = level.read_method;
+    rows_per_strip_ = level.rows_per_strip;
+    tile_width_ = level.tile_width;
+    tile_height_ = level.tile_height;
+    is_tiled_ = level.is_tiled;
+}
+
+template <typename T>
+image_any tiff_reader<T>::read_level(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+    if (level == 0 || level >= levels_.size())
+    {
+        return read(x, y, width, height);
+    }
+    tiff_level const& overview = levels_[level];
+    if (overview.external)
+    {
+        return overviews_->read_level(overview.directory, x, y, width, height);
+    }
+    TIFF* tif = open(stream_);
+    if (!tif || !TIFFSetDirectory(tif, overview.directory))
+    {
+        throw image_reader_exception("TIFF reader: can't read overview");
+    }
+    set_level(overview);
+    try
+    {
+        image_any data = read(x, y, width, height);
+        TIFFSetDirectory(tif, 0);
+        set_level(levels_.front());
+        return data;
+    }
+    catch (...)
+    {
+        TIFFSetDirectory(tif, 0);
+        set_level(levels_.front());
+        throw;
+    }
+}
+
 template <typename T>
 void tiff_reader<T>::read(unsigned x,unsigned y,image_rgba8& image)
 {
@@ -615,9 +858,16 @@ void tiff_reader<T>::read_tiled(unsigned x0,unsigned y0, ImageData & image)
     TIFF* tif = open(stream_);
     if (tif)
     {
-        std::unique_ptr<pixel_type[]> buf(new pixel_type[tile_width_*tile_height_]);
+        std::size_t tile_size = tile_width_ * tile_height_ * sizeof(pixel_type);
+        tiff_tile_cache & cache = tiff_tile_cache::instance();
+        bool use_cache = !file_name_.empty() && cache.capacity() >= tile_size;
         int width = image.width();
         int height = image.height();
+        // a read of the whole image decodes every tile once, keeping them
+        // would only evict tiles of windowed reads that are used again
+        bool keep_tiles = use_cache && (x0 > 0 || y0 > 0 ||
+                                        static_cast<unsigned>(width) < width_ ||
+                                        static_cast<unsigned>(height) < height_);
         int start_y = (y0 / tile_height_) * tile_height_;
         int end_y = ((y0 + height) / tile_height_ + 1) * tile_height_;
         int start_x = (x0 / tile_width_) * tile_width_;
@@ -625,24 +875,83 @@ void tiff_reader<T>::read_tiled(unsigned x0,unsigned y0, ImageData & image)
         end_y = std::min(end_y, int(height_));
         end_x = std::min(end_x, int(width_));
 
-        for (int y = start_y; y < end_y; y += tile_height_)
+        // Decode the tile at x/y, unless cached, and copy its part of the window
+        auto read_tile = [&](TIFF * handle, int x, int y, pixel_type * buf) -> bool
         {
+            tiff_tile_key key = {file_name_, modified_, directory_,
+                                 static_cast<unsigned>(x), static_cast<unsigned>(y),
+                                 std::is_same<ImageData, image_rgba8>::value};
+            pixel_type const* tile = buf;
+            tiff_tile_ptr cached;
+            if (use_cache)
+            {
+                cached = cache.find(key);
+            }
+            if (cached && cached->size() == tile_size)
+            {
+                tile = reinterpret_cast<pixel_type const*>(cached->data());
+            }
+            else
+            {
+                if (!detail::tiff_reader_traits<ImageData>::read_tile(handle, x, y, buf, tile_width_, tile_height_))
+                {
+                    MAPNIK_LOG_DEBUG(tiff_reader) <<  "read_tile(...) failed at " << x << "/" << y << " for " << width_ << "/" << height_ << "\n";
+                    return false;
+                }
+                if (keep_tiles)
+                {
+                    std::uint8_t const* bytes = reinterpret_cast<std::uint8_t const*>(buf);
+                    cache.insert(key, std::make_shared<std::vector<std::uint8_t> >(bytes, bytes + tile_size));
+                }
+            }
             int ty0 = std::max(y0, static_cast<unsigned>(y)) - y;
             int ty1 = std::min(height + y0, static_cast<unsigned>(y + tile_height_)) - y;
+            int tx0 = std::max(x0, static_cast<unsigned>(x));
+            int tx1 = std::min(width + x0, static_cast<unsigned>(x + tile_width_));
+            int row = y + ty0 - y0;
+            for (int ty = ty0; ty < ty1; ++ty, ++row)
+            {
+                image.setRow(row, tx0 - x0, tx1 - x0, &tile[ty * tile_width_ + tx0 - x]);
+            }
+            return true;
+        };
 
-            for (int x = start_x; x < end_x; x += tile_width_)
+        std::size_t tiles_x = end_x > start_x ? (end_x - start_x + tile_width_ - 1) / tile_width_ : 0;
+        std::size_t tiles_y = end_y > start_y ? (end_y - start_y + tile_height_ - 1) / tile_height_ : 0;
+        std::size_t num_tiles = tiles_x * tiles_y;
+        if (threads_ > 1 && num_tiles > 1)
+        {
+            // Each task decodes a run of tiles through its own handle;
+            // tiles cover disjoint parts of the window. A tile that fails
+            // to decode is left blank instead of ending its tile row.
+            std::size_t num_tasks = std::min(static_cast<std::size_t>(threads_), num_tiles);
+            util::parallel_for(num_tasks, threads_, [&](std::size_t task)
             {
-                if (!detail::tiff_reader_traits<ImageData>::read_tile(tif, x, y, buf.get(), tile_width_, tile_height_))
+                std::unique_ptr<std::istream> input = impl::reopen_stream(source_, file_name_);
+                tiff_ptr handle(impl::tiff_client_open(*input), tiff_closer());
+                if (!handle || (directory_ != 0 && !TIFFSetDirectory(handle.get(), directory_)))
                 {
-                    MAPNIK_LOG_DEBUG(tiff_reader) <<  "read_tile(...) failed at " << x << "/" << y << " for " << width_ << "/" << height_ << "\n";
-                    break;
+                    throw image_reader_exception("TIFF reader: can't open tiff for decoding");
                 }
-                int tx0 = std::max(x0, static_cast<unsigned>(x));
-                int tx1 = std::min(width + x0, static_cast<unsigned>(x + tile_width_));
-                int row = y + ty0 - y0;
-                for (int ty = ty0; ty < ty1; ++ty, ++row)
+                std::unique_ptr<pixel_type[]> buf(new pixel_type[tile_width_*tile_height_]);
+                std::size_t end = (task + 1) * num_tiles / num_tasks;
+                for (std::size_t i = task * num_tiles / num_tasks; i < end; ++i)
+                {
+                    read_tile(handle.get(),
+                              start_x + static_cast<int>(i % tiles_x) * tile_width_,
+                              start_y + static_cast<int>(i / tiles_x) * tile_height_,
+                              buf.get());
+                }
+            });
+        }
+        else
+        {
+            std::unique_ptr<pixel_type[]> buf(new pixel_type[tile_width_*tile_height_]);
+            for (int y = start_y; y < end_y; y += tile_height_)
+            {
+                for (int x = start_x; x < end_x; x += tile_width_)
                 {
-                    image.setRow(row, tx0 - x0, tx1 - x0, &buf[ty * tile_width_ + tx0 - x]);
+                    if (!read_tile(tif, x, y, buf.get())) break;
                 }
             }
         }
@@ -692,15 +1001,7 @@ TIFF* tiff_reader<T>::open(std::istream & input)
 {
     if (!tif_)
     {
-        tif_ = tiff_ptr(TIFFClientOpen("tiff_input_stream", "rcm",
-                                       reinterpret_cast<thandle_t>(&input),
-                                       impl::tiff_read_proc,
-                                       impl::tiff_write_proc,
-                                       impl::tiff_seek_proc,
-                                       impl::tiff_close_proc,
-                                       impl::tiff_size_proc,
-                                       impl::tiff_map_proc,
-                                       impl::tiff_unmap_proc), tiff_closer());
+        tif_ = tiff_ptr(impl::tiff_client_open(input), tiff_closer());
     }
     return tif_.get();
 }
@@ -0,0 +1,81 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/tiff_tile_cache.hpp>
+
+// boost
+#include <boost/functional/hash.hpp>
+
+namespace mapnik
+{
+
+std::size_t tiff_tile_key_hash::operator()(tiff_tile_key const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.file_name);
+    boost::hash_combine(seed, key.modified);
+    boost::hash_combine(seed, key.directory);
+    boost::hash_combine(seed, key.x);
+    boost::hash_combine(seed, key.y);
+    boost::hash_combine(seed, key.rgba);
+    return seed;
+}
+
+tiff_tile_cache::tiff_tile_cache()
+    : tiles_(64 * 1024 * 1024) {}
+
+tiff_tile_ptr tiff_tile_cache::find(tiff_tile_key const& key)
+{
+    return tiles_.find(key);
+}
+
+void tiff_tile_cache::insert(tiff_tile_key const& key, tiff_tile_ptr const& tile)
+{
+    if (tile) tiles_.insert(key, tile, tile->size());
+}
+
+void tiff_tile_cache::clear()
+{
+    tiles_.clear();
+}
+
+std::size_t tiff_tile_cache::size() const
+{
+    return tiles_.size();
+}
+
+std::size_t tiff_tile_cache::memory_usage() const
+{
+    return tiles_.usage();
+}
+
+void tiff_tile_cache::set_capacity(std::size_t capacity)
+{
+    tiles_.set_capacity(capacity);
+}
+
+std::size_t tiff_tile_cache::capacity() const
+{
+    return tiles_.capacity();
+}
+
+}
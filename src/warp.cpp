@@ -30,6 +30,9 @@
 #include <mapnik/view_transform.hpp>
 #include <mapnik/raster.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/warp_mesh_cache.hpp>
+#include <mapnik/util/parallel_for.hpp>
 
 // agg
 #include "agg_image_filters.h"
@@ -46,12 +49,184 @@
 #include "agg_image_accessors.h"
 #include "agg_renderer_scanline.h"
 
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 namespace mapnik {
 
+namespace detail {
+
+// Mesh over a source window: the window edges and every mesh_size-th
+// line of the native pixel grid in between, in window pixels, with their
+// crossings reprojected into map coordinates of the target projection,
+// row major.
+struct warp_mesh
+{
+    std::vector<std::size_t> columns;
+    std::vector<std::size_t> rows;
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+std::int64_t floor_div(std::int64_t a, std::int64_t b)
+{
+    std::int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// value rounded to 40 significant bits, so resolutions derived from
+// different windows of one raster compare equal
+double round_resolution(double value)
+{
+    int exponent;
+    double mantissa = std::frexp(value, &exponent);
+    return std::ldexp(std::round(std::ldexp(mantissa, 40)), exponent - 40);
+}
+
+std::vector<std::size_t> mesh_lines(std::int64_t offset, std::size_t size, unsigned mesh_size)
+{
+    std::vector<std::size_t> lines(1, 0);
+    std::int64_t end = offset + static_cast<std::int64_t>(size);
+    for (std::int64_t line = (floor_div(offset, mesh_size) + 1) * mesh_size; line < end; line += mesh_size)
+    {
+        lines.push_back(static_cast<std::size_t>(line - offset));
+    }
+    lines.push_back(size);
+    return lines;
+}
+
+// map coordinates in the source projection of a native grid pixel
+void grid_point(warp_mesh_key const& key, std::int64_t gx, std::int64_t gy, double & x, double & y)
+{
+    x = (gx + key.phase_x) * key.res_x;
+    y = -(gy + key.phase_y) * key.res_y;
+}
+
+warp_mesh_block_ptr reprojected_block(proj_transform const& prj_trans, warp_mesh_key const& key)
+{
+    constexpr std::int64_t block_size = warp_mesh_cache::block_size;
+    auto block = std::make_shared<warp_mesh_block>();
+    block->xs.resize(block_size * block_size);
+    block->ys.resize(block_size * block_size);
+    for (std::int64_t j = 0; j < block_size; ++j)
+    {
+        for (std::int64_t i = 0; i < block_size; ++i)
+        {
+            std::size_t index = static_cast<std::size_t>(j * block_size + i);
+            grid_point(key,
+                       (key.block_x * block_size + i) * key.mesh_size,
+                       (key.block_y * block_size + j) * key.mesh_size,
+                       block->xs[index], block->ys[index]);
+        }
+    }
+    prj_trans.backward(block->xs.data(), block->ys.data(), nullptr, block->xs.size());
+    return block;
+}
+
+warp_mesh reprojected_mesh(proj_transform const& prj_trans, box2d<double> const& source_ext,
+                           std::size_t width, std::size_t height, unsigned mesh_size)
+{
+    // windows read from one raster are aligned to its pixel grid, locate
+    // this one in the grid extended to the origin of the projection
+    warp_mesh_key key;
+    key.target_srs = prj_trans.source().params();
+    key.source_srs = prj_trans.dest().params();
+    key.res_x = round_resolution(source_ext.width() / width);
+    key.res_y = round_resolution(source_ext.height() / height);
+    double grid_x = source_ext.minx() / key.res_x;
+    double grid_y = -source_ext.maxy() / key.res_y;
+    std::int64_t offset_x = std::llround(grid_x);
+    std::int64_t offset_y = std::llround(grid_y);
+    key.phase_x = std::round((grid_x - offset_x) * 1024) / 1024;
+    key.phase_y = std::round((grid_y - offset_y) * 1024) / 1024;
+    key.mesh_size = mesh_size;
+
+    warp_mesh mesh;
+    mesh.columns = mesh_lines(offset_x, width, mesh_size);
+    mesh.rows = mesh_lines(offset_y, height, mesh_size);
+    std::size_t nx = mesh.columns.size();
+    std::size_t ny = mesh.rows.size();
+    mesh.xs.resize(nx * ny);
+    mesh.ys.resize(nx * ny);
+
+    // crossings of grid lines come from cached blocks, points on the
+    // window edges are reprojected here
+    constexpr std::int64_t block_size = warp_mesh_cache::block_size;
+    warp_mesh_cache & cache = warp_mesh_cache::instance();
+    bool use_cache = cache.capacity() > 0;
+    std::vector<std::tuple<std::int64_t, std::int64_t, warp_mesh_block_ptr> > blocks;
+    std::vector<std::size_t> pending;
+    for (std::size_t j = 0; j < ny; ++j)
+    {
+        std::int64_t gy = offset_y + static_cast<std::int64_t>(mesh.rows[j]);
+        for (std::size_t i = 0; i < nx; ++i)
+        {
+            std::size_t index = j * nx + i;
+            std::int64_t gx = offset_x + static_cast<std::int64_t>(mesh.columns[i]);
+            if (!use_cache || gx % mesh_size != 0 || gy % mesh_size != 0)
+            {
+                grid_point(key, gx, gy, mesh.xs[index], mesh.ys[index]);
+                pending.push_back(index);
+                continue;
+            }
+            std::int64_t px = gx / mesh_size;
+            std::int64_t py = gy / mesh_size;
+            std::int64_t bx = floor_div(px, block_size);
+            std::int64_t by = floor_div(py, block_size);
+            auto itr = std::find_if(blocks.begin(), blocks.end(), [bx, by](std::tuple<std::int64_t, std::int64_t, warp_mesh_block_ptr> const& b)
+                                    {
+                                        return std::get<0>(b) == bx && std::get<1>(b) == by;
+                                    });
+            if (itr == blocks.end())
+            {
+                key.block_x = bx;
+                key.block_y = by;
+                warp_mesh_block_ptr block = cache.find(key);
+                if (!block)
+                {
+                    block = reprojected_block(prj_trans, key);
+                    cache.insert(key, block);
+                }
+                blocks.emplace_back(bx, by, block);
+                itr = blocks.end() - 1;
+            }
+            std::size_t k = static_cast<std::size_t>((py - by * block_size) * block_size + px - bx * block_size);
+            mesh.xs[index] = std::get<2>(*itr)->xs[k];
+            mesh.ys[index] = std::get<2>(*itr)->ys[k];
+        }
+    }
+    if (!pending.empty())
+    {
+        std::vector<double> xs(pending.size());
+        std::vector<double> ys(pending.size());
+        for (std::size_t n = 0; n < pending.size(); ++n)
+        {
+            xs[n] = mesh.xs[pending[n]];
+            ys[n] = mesh.ys[pending[n]];
+        }
+        prj_trans.backward(xs.data(), ys.data(), nullptr, pending.size());
+        for (std::size_t n = 0; n < pending.size(); ++n)
+        {
+            mesh.xs[pending[n]] = xs[n];
+            mesh.ys[pending[n]] = ys[n];
+        }
+    }
+    return mesh;
+}
+
+}
+
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                  box2d<double> const& target_ext, box2d<double> const& source_ext,
-                 double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor)
+                 double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
+                 unsigned threads)
 {
     using image_type = T;
     using pixel_type = typename image_type::pixel_type;
@@ -62,98 +237,110 @@ MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const&
 
     constexpr std::size_t pixel_size = sizeof(pixel_type);
 
-    view_transform ts(source.width(), source.height(),
-                      source_ext);
+    if (target.width() == 0 || target.height() == 0) return;
+
     view_transform tt(target.width(), target.height(),
                       target_ext, offset_x, offset_y);
 
-    std::size_t mesh_nx = std::ceil(source.width()/double(mesh_size) + 1);
-    std::size_t mesh_ny = std::ceil(source.height()/double(mesh_size) + 1);
+    if (source.width() == 0 || source.height() == 0) return;
+    detail::warp_mesh mesh = detail::reprojected_mesh(prj_trans, source_ext, source.width(), source.height(), mesh_size);
+    std::size_t mesh_nx = mesh.columns.size();
+    std::size_t mesh_ny = mesh.rows.size();
 
-    image_gray64f xs(mesh_nx, mesh_ny, false);
-    image_gray64f ys(mesh_nx, mesh_ny, false);
-
-    // Precalculate reprojected mesh
-    for(std::size_t j = 0; j < mesh_ny; ++j)
+    // Project mesh cells into target pixel coordinates
+    std::size_t num_cells = (mesh_nx - 1) * (mesh_ny - 1);
+    std::vector<double> polygons(num_cells * 8);
+    std::vector<std::pair<double, double> > cell_rows(num_cells);
+    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
     {
-        for (std::size_t i=0; i<mesh_nx; ++i)
+        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
         {
-            xs(i,j) = std::min(i*mesh_size,source.width());
-            ys(i,j) = std::min(j*mesh_size,source.height());
-            ts.backward(&xs(i,j), &ys(i,j));
+            std::size_t cell = j * (mesh_nx - 1) + i;
+            double * polygon = &polygons[cell * 8];
+            std::size_t corners[4] = { j * mesh_nx + i, j * mesh_nx + i + 1,
+                                       (j + 1) * mesh_nx + i + 1, (j + 1) * mesh_nx + i };
+            for (std::size_t k = 0; k < 4; ++k)
+            {
+                polygon[2 * k] = mesh.xs[corners[k]];
+                polygon[2 * k + 1] = mesh.ys[corners[k]];
+                tt.forward(polygon + 2 * k, polygon + 2 * k + 1);
+            }
+            cell_rows[cell] = std::minmax({std::floor(polygon[1]), std::floor(polygon[3]),
+                                           std::floor(polygon[5]), std::floor(polygon[7])});
         }
     }
-    prj_trans.backward(xs.getData(), ys.getData(), nullptr, mesh_nx*mesh_ny);
 
-    agg::rasterizer_scanline_aa<> rasterizer;
-    agg::scanline_bin scanline;
     agg::rendering_buffer buf(target.getBytes(),
                               target.width(),
                               target.height(),
                               target.width() * pixel_size);
-    pixfmt_pre pixf(buf);
-    renderer_base rb(pixf);
-    rasterizer.clip_box(0, 0, target.width(), target.height());
     agg::rendering_buffer buf_tile(
         const_cast<unsigned char*>(source.getBytes()),
         source.width(),
         source.height(),
         source.width() * pixel_size);
 
-    pixfmt_pre pixf_tile(buf_tile);
+    // Each band of target rows renders every cell, in mesh order, clipped to
+    // its own rows. Cells overlap along their edges, so a pixel sees exactly
+    // the same sequence of blends as with a single band.
+    std::size_t num_bands = std::max(std::size_t(1), std::min(std::size_t(threads), target.height()));
+    util::parallel_for(num_bands, threads, [&](std::size_t band)
+    {
+        int band_y0 = static_cast<int>(band * target.height() / num_bands);
+        int band_y1 = static_cast<int>((band + 1) * target.height() / num_bands);
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_bin scanline;
+        pixfmt_pre pixf(buf);
+        renderer_base rb(pixf);
+        rb.clip_box(0, band_y0, target.width() - 1, band_y1 - 1);
+        rasterizer.clip_box(0, 0, target.width(), target.height());
+        pixfmt_pre pixf_tile(buf_tile);
 
-    using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
-    img_accessor_type ia(pixf_tile);
+        using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
+        img_accessor_type ia(pixf_tile);
 
-    agg::span_allocator<color_type> sa;
-    // Project mesh cells into target interpolating raster inside each one
-    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
-    {
-        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
+        agg::span_allocator<color_type> sa;
+        agg::image_filter_lut filter;
+        if (scaling_method != SCALING_NEAR)
         {
-            double polygon[8] = {xs(i,j), ys(i,j),
-                                 xs(i+1,j), ys(i+1,j),
-                                 xs(i+1,j+1), ys(i+1,j+1),
-                                 xs(i,j+1), ys(i,j+1)};
-            tt.forward(polygon+0, polygon+1);
-            tt.forward(polygon+2, polygon+3);
-            tt.forward(polygon+4, polygon+5);
-            tt.forward(polygon+6, polygon+7);
-
-            rasterizer.reset();
-            rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
-            rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
-            rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
-            rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
-
-            std::size_t x0 = i * mesh_size;
-            std::size_t y0 = j * mesh_size;
-            std::size_t x1 = (i+1) * mesh_size;
-            std::size_t y1 = (j+1) * mesh_size;
-            x1 = std::min(x1, source.width());
-            y1 = std::min(y1, source.height());
-            agg::trans_affine tr(polygon, x0, y0, x1, y1);
-            if (tr.is_valid())
+            detail::set_scaling_method(filter, scaling_method, filter_factor);
+        }
+        // Interpolate raster inside each mesh cell
+        for (std::size_t j = 0; j < mesh_ny - 1; ++j)
+        {
+            for (std::size_t i = 0; i < mesh_nx - 1; ++i)
             {
-                interpolator_type interpolator(tr);
-                if (scaling_method == SCALING_NEAR)
-                {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
-                    span_gen_type sg(ia, interpolator);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
-                }
-                else
+                std::size_t cell = j * (mesh_nx - 1) + i;
+                if (num_bands > 1 && (cell_rows[cell].second < band_y0 || cell_rows[cell].first >= band_y1)) continue;
+                double const* polygon = &polygons[cell * 8];
+
+                rasterizer.reset();
+                rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
+                rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
+                rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
+                rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
+
+                agg::trans_affine tr(polygon, mesh.columns[i], mesh.rows[j],
+                                     mesh.columns[i + 1], mesh.rows[j + 1]);
+                if (tr.is_valid())
                 {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
-                    agg::image_filter_lut filter;
-                    detail::set_scaling_method(filter, scaling_method, filter_factor);
-                    span_gen_type sg(ia, interpolator, filter);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    interpolator_type interpolator(tr);
+                    if (scaling_method == SCALING_NEAR)
+                    {
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
+                        span_gen_type sg(ia, interpolator);
+                        agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    }
+                    else
+                    {
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
+                        span_gen_type sg(ia, interpolator, filter);
+                        agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    }
                 }
             }
-
         }
-    }
+    });
 }
 
 namespace detail {
@@ -162,7 +349,7 @@ struct warp_image_visitor
 {
     warp_image_visitor (raster & target_raster, proj_transform const& prj_trans, box2d<double> const& source_ext,
                         double offset_x, double offset_y, unsigned mesh_size,
-                        scaling_method_e scaling_method, double filter_factor)
+                        scaling_method_e scaling_method, double filter_factor, unsigned threads)
         : target_raster_(target_raster),
           prj_trans_(prj_trans),
           source_ext_(source_ext),
@@ -170,7 +357,8 @@ struct warp_image_visitor
           offset_y_(offset_y),
           mesh_size_(mesh_size),
           scaling_method_(scaling_method),
-        filter_factor_(filter_factor) {}
+          filter_factor_(filter_factor),
+          threads_(threads) {}
 
     void operator() (image_null const&) {}
 
@@ -183,7 +371,7 @@ struct warp_image_visitor
         {
             image_type & target = util::get<image_type>(target_raster_.data_);
             warp_image (target, source, prj_trans_, target_raster_.ext_, source_ext_,
-                        offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_);
+                        offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, threads_);
         }
     }
 
@@ -195,6 +383,7 @@ struct warp_image_visitor
     unsigned mesh_size_;
     scaling_method_e scaling_method_;
     double filter_factor_;
+    unsigned threads_;
 };
 
 }
@@ -203,24 +392,25 @@ void reproject_and_scale_raster(raster & target, raster const& source,
                                 proj_transform const& prj_trans,
                                 double offset_x, double offset_y,
                                 unsigned mesh_size,
-                                scaling_method_e scaling_method)
+                                scaling_method_e scaling_method,
+                                unsigned threads)
 {
     detail::warp_image_visitor warper(target, prj_trans, source.ext_, offset_x, offset_y, mesh_size,
-                                      scaling_method, source.get_filter_factor());
+                                      scaling_method, source.get_filter_factor(), threads);
     util::apply_visitor(warper, source.data_);
 }
 
 template MAPNIK_DECL void warp_image (image_rgba8&, image_rgba8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray8&, image_gray8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray16&, image_gray16 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray32f&, image_gray32f const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, unsigned);
 
 
 }// namespace mapnik
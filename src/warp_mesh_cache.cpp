@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/warp_mesh_cache.hpp>
+
+// boost
+#include <boost/functional/hash.hpp>
+
+namespace mapnik
+{
+
+std::size_t warp_mesh_key_hash::operator()(warp_mesh_key const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.target_srs);
+    boost::hash_combine(seed, key.source_srs);
+    boost::hash_combine(seed, key.res_x);
+    boost::hash_combine(seed, key.res_y);
+    boost::hash_combine(seed, key.phase_x);
+    boost::hash_combine(seed, key.phase_y);
+    boost::hash_combine(seed, key.mesh_size);
+    boost::hash_combine(seed, key.block_x);
+    boost::hash_combine(seed, key.block_y);
+    return seed;
+}
+
+constexpr unsigned warp_mesh_cache::block_size;
+
+warp_mesh_cache::warp_mesh_cache()
+    : blocks_(16 * 1024 * 1024) {}
+
+warp_mesh_block_ptr warp_mesh_cache::find(warp_mesh_key const& key)
+{
+    return blocks_.find(key);
+}
+
+void warp_mesh_cache::insert(warp_mesh_key const& key, warp_mesh_block_ptr const& block)
+{
+    if (!block) return;
+    std::size_t bytes = sizeof(warp_mesh_key) + key.target_srs.size() + key.source_srs.size() +
+        sizeof(warp_mesh_block) + (block->xs.size() + block->ys.size()) * sizeof(double);
+    blocks_.insert(key, block, bytes);
+}
+
+void warp_mesh_cache::clear()
+{
+    blocks_.clear();
+}
+
+std::size_t warp_mesh_cache::size() const
+{
+    return blocks_.size();
+}
+
+std::size_t warp_mesh_cache::memory_usage() const
+{
+    return blocks_.usage();
+}
+
+void warp_mesh_cache::set_capacity(std::size_t capacity)
+{
+    blocks_.set_capacity(capacity);
+}
+
+std::size_t warp_mesh_cache::capacity() const
+{
+    return blocks_.capacity();
+}
+
+}
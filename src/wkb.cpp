@@ -371,6 +371,7 @@ private:
             CoordinateArray ar(num_points);
             read_coords(ar);
             auto line = std::make_unique<geometry_type>(geometry_type::types::LineString);
+            line->reserve(num_points);
             line->move_to(ar[0].x, ar[0].y);
             for (int i = 1; i < num_points; ++i)
             {
@@ -398,6 +399,7 @@ private:
             CoordinateArray ar(num_points);
             read_coords_xyz(ar);
             auto line = std::make_unique<geometry_type>(geometry_type::types::LineString);
+            line->reserve(num_points);
             line->move_to(ar[0].x, ar[0].y);
             for (int i = 1; i < num_points; ++i)
             {
@@ -415,6 +417,7 @@ private:
             CoordinateArray ar(num_points);
             read_coords_xyzm(ar);
             auto line = std::make_unique<geometry_type>(geometry_type::types::LineString);
+            line->reserve(num_points);
             line->move_to(ar[0].x, ar[0].y);
             for (int i = 1; i < num_points; ++i)
             {
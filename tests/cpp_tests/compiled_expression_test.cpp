@@ -0,0 +1,109 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/unicode.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/compiled_expression.hpp>
+#include <mapnik/util/variant.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace detail {
+
+bool same_result(mapnik::compiled_expression const& compiled,
+                 mapnik::expression_ptr const& expr,
+                 mapnik::feature_impl const& feature,
+                 mapnik::attributes const& vars)
+{
+    mapnik::value_type expected = mapnik::util::apply_visitor(
+        mapnik::evaluate<mapnik::feature_impl,mapnik::value_type,mapnik::attributes>(feature,vars),*expr);
+    mapnik::value_type result = compiled.evaluate(feature,vars);
+    return expected.get_type_index() == result.get_type_index()
+        && expected.to_string() == result.to_string();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::transcoder tr("utf-8");
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("class");
+        ctx->push("oneway");
+        ctx->push("n");
+        mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx,1);
+        feature->put("class",tr.transcode("path"));
+        feature->put("oneway",mapnik::value_integer(1));
+        feature->put("n",mapnik::value_double(2.5));
+
+        // same keys in a different column order
+        mapnik::context_ptr ctx2 = std::make_shared<mapnik::context_type>();
+        ctx2->push("n");
+        ctx2->push("class");
+        mapnik::feature_ptr feature2 = mapnik::feature_factory::create(ctx2,2);
+        feature2->put("n",mapnik::value_double(7));
+        feature2->put("class",tr.transcode("road"));
+
+        mapnik::attributes vars;
+        vars["zoom"] = mapnik::value_integer(5);
+
+        std::vector<std::string> exprs = {
+            "[class]='path' and [oneway]=1",
+            "[n]*2+[oneway]",
+            "[class]+(1+2)",
+            "[missing]=null",
+            "not ([n]>2) or [oneway]!=1",
+            "-[n] % 2",
+            "@zoom>3 and @undefined=null",
+            "[class].match('pa.*')",
+            "[class].replace('a','o')",
+            "pow([n],2)+sin(0)",
+            "[mapnik::geometry_type]=0",
+            // folded regex and call nodes free their slots for later ones
+            "'ab'.match('a.*') and [class].match('pa.*')",
+            "'ab'.replace('a','c')+[class].replace('a','o')",
+            "sin(0)+cos([n])"
+        };
+
+        for (std::string const& s : exprs)
+        {
+            mapnik::expression_ptr expr = mapnik::parse_expression(s);
+            mapnik::compiled_expression compiled(expr);
+            // unbound programs look attributes up by name
+            BOOST_TEST(detail::same_result(compiled,expr,*feature,vars));
+            compiled.bind(ctx);
+            BOOST_TEST(detail::same_result(compiled,expr,*feature,vars));
+            compiled.bind(ctx2);
+            BOOST_TEST(detail::same_result(compiled,expr,*feature2,vars));
+        }
+
+        // constant sub-expressions are folded into a single instruction
+        BOOST_TEST(mapnik::compiled_expression(mapnik::parse_expression("1+2*3")).code().size() == 1);
+        BOOST_TEST(mapnik::compiled_expression(mapnik::parse_expression("false and [class]='path'")).code().size() == 1);
+        BOOST_TEST(mapnik::compiled_expression(mapnik::parse_expression("true or [class]='path'")).code().size() == 1);
+    }
+    catch (std::exception const& ex)
+    {
+        std::cerr << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ compiled expressions: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,322 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/util/featureset_buffer.hpp>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+// does the segment from (x0, y0) to (x1, y1) cross box
+bool segment_intersects(mapnik::box2d<double> const& box, double x0, double y0, double x1, double y1)
+{
+    double t0 = 0;
+    double t1 = 1;
+    double const p[4] = { x0 - x1, x1 - x0, y0 - y1, y1 - y0 };
+    double const q[4] = { x0 - box.minx(), box.maxx() - x0, y0 - box.miny(), box.maxy() - y0 };
+    for (int i = 0; i < 4; ++i)
+    {
+        if (p[i] == 0)
+        {
+            if (q[i] < 0) return false;
+        }
+        else if (p[i] < 0)
+        {
+            t0 = std::max(t0, q[i] / p[i]);
+        }
+        else
+        {
+            t1 = std::min(t1, q[i] / p[i]);
+        }
+    }
+    return t0 <= t1;
+}
+
+// vector datasource of points and straight lines returning those whose
+// envelope intersects the query or, when exact, whose geometry does
+class test_datasource : public mapnik::datasource
+{
+public:
+    test_datasource(mapnik::parameters const& params, bool exact, bool stable_ids = true)
+        : mapnik::datasource(params),
+          exact_(exact),
+          stable_ids_(stable_ids),
+          ctx_(std::make_shared<mapnik::context_type>()),
+          queries_(0) {}
+
+    void push_point(double x, double y)
+    {
+        push(mapnik::geometry_type::types::Point, x, y, x, y);
+    }
+
+    void push_line(double x0, double y0, double x1, double y1)
+    {
+        push(mapnik::geometry_type::types::LineString, x0, y0, x1, y1);
+    }
+
+    // number of queries answered
+    std::size_t queries() const
+    {
+        return queries_;
+    }
+
+    mapnik::value_integer last_id() const
+    {
+        return static_cast<mapnik::value_integer>(items_.size());
+    }
+
+    datasource_t type() const
+    {
+        return datasource::Vector;
+    }
+
+    mapnik::featureset_ptr features(mapnik::query const& q) const
+    {
+        ++queries_;
+        mapnik::box2d<double> const& box = q.get_bbox();
+        auto fs = std::make_shared<mapnik::featureset_buffer>();
+        for (auto const& item : items_)
+        {
+            mapnik::box2d<double> env = item.feature->envelope();
+            bool hit = exact_ ? segment_intersects(box, item.x0, item.y0, item.x1, item.y1) : env.intersects(box);
+            if (hit) fs->push(item.feature);
+        }
+        fs->prepare();
+        return fs;
+    }
+
+    mapnik::featureset_ptr features_at_point(mapnik::coord2d const&, double) const
+    {
+        return mapnik::featureset_ptr();
+    }
+
+    mapnik::box2d<double> envelope() const
+    {
+        return mapnik::box2d<double>(-1000, -1000, 1000, 1000);
+    }
+
+    boost::optional<geometry_t> get_geometry_type() const
+    {
+        return boost::optional<geometry_t>();
+    }
+
+    mapnik::layer_descriptor get_descriptor() const
+    {
+        return mapnik::layer_descriptor("test", "utf-8");
+    }
+
+    bool has_stable_ids() const
+    {
+        return stable_ids_;
+    }
+
+private:
+    struct item
+    {
+        mapnik::feature_ptr feature;
+        double x0, y0, x1, y1;
+    };
+
+    void push(mapnik::geometry_type::types type, double x0, double y0, double x1, double y1)
+    {
+        mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx_, last_id() + 1);
+        mapnik::geometry_type * geom = new mapnik::geometry_type(type);
+        geom->move_to(x0, y0);
+        if (type == mapnik::geometry_type::types::LineString) geom->line_to(x1, y1);
+        feature->add_geometry(geom);
+        items_.push_back(item { feature, x0, y0, x1, y1 });
+    }
+
+    bool exact_;
+    bool stable_ids_;
+    mapnik::context_ptr ctx_;
+    std::vector<item> items_;
+    mutable std::size_t queries_;
+};
+
+std::vector<mapnik::value_integer> ids(mapnik::featureset_ptr const& fs)
+{
+    std::vector<mapnik::value_integer> result;
+    if (fs)
+    {
+        while (mapnik::feature_ptr feature = fs->next())
+        {
+            result.push_back(feature->id());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::feature_cache & cache = mapnik::feature_cache::instance();
+        cache.clear();
+        cache.reset_stats();
+
+        mapnik::parameters params;
+        params.emplace("type", std::string("test"));
+        params.emplace("name", std::string("feature_cache_test"));
+        test_datasource ds(params, false);
+        // points on a grid, some on cell boundaries
+        for (int y = -600; y <= 600; y += 100)
+        {
+            for (int x = -600; x <= 600; x += 100)
+            {
+                ds.push_point(x, y);
+            }
+        }
+        // a line crossing many cells
+        ds.push_line(-1000, -10, 1000, 10);
+
+        // at a resolution of 1 cells are 256 units wide
+        mapnik::box2d<double> tile(-250, -250, 250, 250);
+        mapnik::query q(tile, mapnik::query::resolution_type(1.0, 1.0), 1000.0);
+        std::vector<mapnik::value_integer> expected = ids(ds.features(q));
+        std::size_t queries = ds.queries();
+        std::vector<mapnik::value_integer> cached = ids(cache.features(ds, q));
+        BOOST_TEST(cached == expected);
+        BOOST_TEST_EQ(cache.hits(), 0u);
+        BOOST_TEST_EQ(cache.misses(), 4u);
+        BOOST_TEST_EQ(cache.size(), 4u);
+        BOOST_TEST(cache.memory_usage() > 0);
+        // the missing cells are fetched with one query
+        BOOST_TEST_EQ(ds.queries(), queries + 1);
+
+        // a neighbouring tile reuses the cells it shares
+        mapnik::box2d<double> next_tile(200, -250, 700, 250);
+        mapnik::query next_q(next_tile, mapnik::query::resolution_type(1.0, 1.0), 1000.0);
+        BOOST_TEST(ids(cache.features(ds, next_q)) == ids(ds.features(next_q)));
+        BOOST_TEST_EQ(cache.hits(), 2u);
+        BOOST_TEST_EQ(cache.misses(), 8u);
+        queries = ds.queries();
+        BOOST_TEST(ids(cache.features(ds, q)) == expected);
+        BOOST_TEST_EQ(cache.hits(), 6u);
+        BOOST_TEST_EQ(ds.queries(), queries);
+
+        // a cold 8x8 metatile is one query too
+        cache.clear();
+        mapnik::box2d<double> metatile(-1000, -1000, 1000, 1000);
+        mapnik::query meta_q(metatile, mapnik::query::resolution_type(1.0, 1.0), 1000.0);
+        std::vector<mapnik::value_integer> meta_expected = ids(ds.features(meta_q));
+        queries = ds.queries();
+        BOOST_TEST(ids(cache.features(ds, meta_q)) == meta_expected);
+        BOOST_TEST_EQ(cache.size(), 64u);
+        BOOST_TEST_EQ(ds.queries(), queries + 1);
+        BOOST_TEST(ids(cache.features(ds, q)) == expected);
+        BOOST_TEST(ids(cache.features(ds, next_q)) == ids(ds.features(next_q)));
+        cache.clear();
+        BOOST_TEST(ids(cache.features(ds, q)) == expected);
+        BOOST_TEST(ids(cache.features(ds, next_q)) == ids(ds.features(next_q)));
+
+        // another resolution or attribute set uses other cells
+        mapnik::query zoomed(tile, mapnik::query::resolution_type(2.0, 2.0), 500.0);
+        BOOST_TEST(ids(cache.features(ds, zoomed)) == expected);
+        mapnik::query with_names(q);
+        with_names.add_property_name("name");
+        cache.features(ds, with_names);
+        BOOST_TEST_EQ(cache.size(), 8u + 16u + 4u);
+
+        // invalidation
+        cache.invalidate(ds, mapnik::box2d<double>(-10, -10, 10, 10));
+        BOOST_TEST_EQ(cache.size(), 8u + 16u + 4u - 12u);
+        cache.invalidate(ds);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        BOOST_TEST_EQ(cache.memory_usage(), 0u);
+
+        // datasources not created from parameters are not cached
+        test_datasource unnamed(mapnik::parameters{}, false);
+        BOOST_TEST(!cache.features(unnamed, q));
+
+        // nor are memory datasources
+        mapnik::memory_datasource memory(params);
+        BOOST_TEST(!cache.features(memory, q));
+
+        // nor are datasources numbering features per query
+        test_datasource unstable(params, false, false);
+        BOOST_TEST(!cache.features(unstable, q));
+        BOOST_TEST_EQ(cache.size(), 0u);
+
+        // a datasource testing exact intersection only returns a diagonal
+        // line from the cells it crosses, which need not include the cell
+        // of the lower left corner of its envelope
+        {
+            mapnik::parameters exact_params;
+            exact_params.emplace("type", std::string("test"));
+            exact_params.emplace("name", std::string("feature_cache_exact_test"));
+            test_datasource exact(exact_params, true);
+            exact.push_line(-1000, 1100, 1000, -900);
+            mapnik::value_integer diagonal = exact.last_id();
+            exact.push_line(-1000, -1300, 1000, 700);
+            exact.push_line(-900, -1000, 900, 1000);
+            for (int i = -900; i <= 900; i += 150)
+            {
+                exact.push_point(i, -i / 3);
+            }
+            std::vector<mapnik::value_integer> cached = ids(cache.features(exact, q));
+            BOOST_TEST(cached == ids(exact.features(q)));
+            BOOST_TEST(std::find(cached.begin(), cached.end(), diagonal) != cached.end());
+            // every feature of a tile is returned once, features crossing
+            // cells but not the tile may be returned from the cached cells
+            bool complete = true;
+            bool unique = true;
+            for (int y = -1000; y <= 600; y += 170)
+            {
+                for (int x = -1000; x <= 600; x += 130)
+                {
+                    mapnik::query tile_q(mapnik::box2d<double>(x, y, x + 400, y + 400),
+                                         mapnik::query::resolution_type(1.0, 1.0), 1000.0);
+                    std::vector<mapnik::value_integer> tile_cached = ids(cache.features(exact, tile_q));
+                    std::vector<mapnik::value_integer> tile_expected = ids(exact.features(tile_q));
+                    if (!std::includes(tile_cached.begin(), tile_cached.end(),
+                                       tile_expected.begin(), tile_expected.end())) complete = false;
+                    if (std::adjacent_find(tile_cached.begin(), tile_cached.end()) != tile_cached.end()) unique = false;
+                }
+            }
+            BOOST_TEST(complete);
+            BOOST_TEST(unique);
+            cache.invalidate(exact);
+        }
+
+        // zero capacity disables caching
+        std::size_t capacity = cache.capacity();
+        cache.set_capacity(0);
+        BOOST_TEST(!cache.features(ds, q));
+        cache.set_capacity(capacity);
+        cache.reset_stats();
+        BOOST_TEST_EQ(cache.hits(), 0u);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ feature cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,93 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/geometry.hpp>
+#include <mapnik/vertex_vector.hpp>
+#include <mapnik/vertex_array.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace detail {
+
+template <typename Geometry>
+void build(Geometry & geom, unsigned num_points)
+{
+    geom.move_to(0,0);
+    for (unsigned i = 1; i < num_points; ++i)
+    {
+        geom.line_to(i, i * 0.5);
+    }
+    geom.close_path();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // enough vertices to span several vertex_vector blocks
+        unsigned num_points = 1000;
+        using block_geometry = mapnik::geometry<double,mapnik::vertex_vector>;
+        using contiguous_geometry = mapnik::geometry<double,mapnik::vertex_array>;
+        block_geometry blocks(block_geometry::types::Polygon);
+        contiguous_geometry contiguous(contiguous_geometry::types::Polygon);
+        blocks.reserve(num_points + 1);
+        contiguous.reserve(num_points + 1);
+        detail::build(blocks, num_points);
+        detail::build(contiguous, num_points);
+        BOOST_TEST_EQ(blocks.size(), num_points + 1);
+        BOOST_TEST_EQ(contiguous.size(), num_points + 1);
+        for (unsigned i = 0; i <= num_points + 1; ++i)
+        {
+            double x0 = -1, y0 = -1, x1 = -1, y1 = -1;
+            unsigned cmd0 = blocks.data().get_vertex(i, &x0, &y0);
+            unsigned cmd1 = contiguous.data().get_vertex(i, &x1, &y1);
+            BOOST_TEST_EQ(cmd0, cmd1);
+            BOOST_TEST_EQ(x0, x1);
+            BOOST_TEST_EQ(y0, y1);
+        }
+        BOOST_TEST(mapnik::envelope(blocks) == mapnik::envelope(contiguous));
+
+        // bulk access to the interleaved coordinates and commands
+        double const* coords = contiguous.data().vertices();
+        BOOST_TEST_EQ(coords[2 * 10], 10.0);
+        BOOST_TEST_EQ(coords[2 * 10 + 1], 5.0);
+        BOOST_TEST_EQ(unsigned(contiguous.data().commands()[0]), unsigned(mapnik::SEG_MOVETO));
+        BOOST_TEST_EQ(unsigned(contiguous.data().commands()[num_points]), unsigned(mapnik::SEG_CLOSE));
+
+        // geometry_type uses the contiguous container
+        mapnik::geometry_type geom(mapnik::geometry_type::types::LineString);
+        geom.move_to(1,2);
+        geom.line_to(3,4);
+        mapnik::vertex_adapter va(geom);
+        double x = 0, y = 0;
+        BOOST_TEST_EQ(va.vertex(&x,&y), unsigned(mapnik::SEG_MOVETO));
+        BOOST_TEST_EQ(va.vertex(&x,&y), unsigned(mapnik::SEG_LINETO));
+        BOOST_TEST_EQ(x, 3.0);
+        BOOST_TEST_EQ(y, 4.0);
+        BOOST_TEST_EQ(va.vertex(&x,&y), unsigned(mapnik::SEG_END));
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ geometry containers: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
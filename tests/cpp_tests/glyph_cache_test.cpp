@@ -0,0 +1,120 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/text/glyph_cache.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace detail {
+
+mapnik::glyph_bitmap_key make_key(unsigned glyph_index, int dx,
+                                  std::string const& font_file = "fonts/dejavu-fonts-ttf-2.34/ttf/DejaVuSans.ttf",
+                                  long face_index = 0)
+{
+    mapnik::glyph_bitmap_key key;
+    key.font_file = font_file;
+    key.face_index = face_index;
+    key.glyph_index = glyph_index;
+    key.size = 10 * 64;
+    key.halo_radius = 0;
+    key.xx = 0x10000L;
+    key.xy = 0;
+    key.yx = 0;
+    key.yy = 0x10000L;
+    key.dx = dx;
+    key.dy = 0;
+    return key;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::glyph_cache & cache = mapnik::glyph_cache::instance();
+        std::size_t capacity = cache.capacity();
+        cache.clear();
+        auto bitmap = std::make_shared<mapnik::glyph_bitmap>();
+        bitmap->width = 10;
+        bitmap->rows = 10;
+        bitmap->buffer.resize(100);
+        // capacity is in bytes, measure an entry to fit exactly two
+        cache.insert(detail::make_key(1, 0), bitmap);
+        std::size_t entry_bytes = cache.memory_usage();
+        BOOST_TEST(entry_bytes >= bitmap->buffer.size());
+        cache.clear();
+        BOOST_TEST_EQ(cache.memory_usage(), 0u);
+        // capacity is split evenly between shards, all offsets of a glyph
+        // share one so each offset of glyph 1 takes one of its two slots
+        std::size_t shards = mapnik::glyph_cache::num_shards;
+        cache.set_capacity(shards * 2 * entry_bytes);
+        cache.insert(detail::make_key(1, 0), bitmap);
+        cache.insert(detail::make_key(1, 16), bitmap);
+        BOOST_TEST_EQ(cache.memory_usage(), 2 * entry_bytes);
+        // subpixel offset is part of the key
+        BOOST_TEST(!cache.find(detail::make_key(1, 32)));
+        // faces are told apart by font file and face index, not by name
+        BOOST_TEST(!cache.find(detail::make_key(1, 0, "fonts/other/DejaVuSans.ttf")));
+        BOOST_TEST(!cache.find(detail::make_key(1, 0, "fonts/dejavu-fonts-ttf-2.34/ttf/DejaVuSans.ttf", 1)));
+        // touch 1/0 so 1/16 becomes least recently used
+        BOOST_TEST(cache.find(detail::make_key(1, 0)) == bitmap);
+        cache.insert(detail::make_key(1, 32), bitmap);
+        BOOST_TEST_EQ(cache.size(), 2u);
+        BOOST_TEST_EQ(cache.memory_usage(), 2 * entry_bytes);
+        BOOST_TEST(cache.find(detail::make_key(1, 0)));
+        BOOST_TEST(!cache.find(detail::make_key(1, 16)));
+        BOOST_TEST(cache.find(detail::make_key(1, 32)));
+        // other glyphs land in other shards and evict nothing of glyph 1
+        cache.insert(detail::make_key(2, 0), bitmap);
+        cache.insert(detail::make_key(3, 0), bitmap);
+        BOOST_TEST_EQ(cache.size(), 4u);
+        BOOST_TEST(cache.find(detail::make_key(1, 0)));
+        BOOST_TEST(cache.find(detail::make_key(1, 32)));
+
+        // changing the subpixel grid invalidates cached bitmaps
+        unsigned steps = cache.subpixel_steps();
+        BOOST_TEST_EQ(steps, 64u);
+        cache.set_subpixel_steps(4);
+        BOOST_TEST_EQ(cache.subpixel_steps(), 4u);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        BOOST_TEST_EQ(cache.memory_usage(), 0u);
+        cache.set_subpixel_steps(steps);
+
+        // and so do rotation buckets, which are off by default
+        BOOST_TEST_EQ(cache.rotation_steps(), 0u);
+        cache.insert(detail::make_key(1, 0), bitmap);
+        cache.set_rotation_steps(360);
+        BOOST_TEST_EQ(cache.rotation_steps(), 360u);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        cache.set_rotation_steps(0);
+
+        // zero capacity disables caching
+        cache.set_capacity(0);
+        cache.insert(detail::make_key(1, 0), bitmap);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        cache.set_capacity(capacity);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ glyph cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,91 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+#if defined(GRID_RENDERER)
+        mapnik::transcoder tr("utf-8");
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("name");
+        ctx->push("pop");
+        ctx->push("other");
+        mapnik::feature_ptr f1 = mapnik::feature_factory::create(ctx, 1);
+        f1->put("name", tr.transcode("a\"b"));
+        f1->put("pop", mapnik::value_integer(10));
+        f1->put("other", mapnik::value_integer(1));
+        mapnik::feature_ptr f2 = mapnik::feature_factory::create(ctx, 2);
+        f2->put("name", tr.transcode("b"));
+        f2->put("pop", 2.5);
+
+        mapnik::grid grid(4, 4, "name");
+        grid.add_field("__id__");
+        grid.add_field("name");
+        grid.add_field("pop");
+        grid.add_field("missing");
+        grid.add_feature(*f1);
+        grid.add_feature(*f2);
+        grid.setPixel(0, 0, 1);
+        grid.setPixel(1, 0, 1);
+        grid.setPixel(2, 2, 2);
+        grid.setPixel(3, 3, 2);
+
+        // only the grid fields of a feature are kept
+        mapnik::grid_feature const& snapshot = grid.get_grid_features().at("b");
+        BOOST_TEST_EQ(snapshot.id, 2);
+        BOOST_TEST_EQ(snapshot.values.size(), 4u);
+        BOOST_TEST(!snapshot.has[1]);
+        BOOST_TEST(snapshot.values[3] == 2.5);
+
+        std::string json;
+        mapnik::grid_encode_utf(grid, json);
+        BOOST_TEST_EQ(json, std::string("{\"grid\":[\"  !!\",\"!!!!\",\"!!#!\",\"!!!#\"],"
+                                        "\"keys\":[\"a\\\"b\",\"\",\"b\"],"
+                                        "\"data\":{\"a\\\"b\":{\"__id__\":1,\"name\":\"a\\\"b\",\"pop\":10},"
+                                        "\"b\":{\"__id__\":2,\"name\":\"b\",\"pop\":2.5}}}"));
+
+        // every other pixel, without feature data, into a reused buffer
+        json.clear();
+        mapnik::grid_encode_utf(grid, json, false, 2);
+        BOOST_TEST_EQ(json, std::string("{\"grid\":[\" !\",\"!#\"],\"keys\":[\"a\\\"b\",\"\",\"b\"],\"data\":{}}"));
+
+        mapnik::utf_grid utf;
+        mapnik::grid2utf(grid.get_view(2, 2, 2, 2), utf);
+        BOOST_TEST_EQ(utf.width, 2u);
+        BOOST_TEST_EQ(utf.height, 2u);
+        BOOST_TEST_EQ(utf.keys.size(), 2u);
+        BOOST_TEST_EQ(utf.codes[3], 32u);
+#endif
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ grid utf: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,106 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/image.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include "agg_color_rgba.h"
+#include "agg_pixfmt_rgba.h"
+#include "agg_rendering_buffer.h"
+#include "agg_renderer_base.h"
+
+namespace detail {
+
+void fill_random(mapnik::image_rgba8 & im, std::mt19937 & rng, bool premultiplied)
+{
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            std::uint8_t a = rng() % 4 == 0 ? 0 : rng() % 4 == 0 ? 255 : rng() & 0xff;
+            std::uint8_t c[3];
+            for (unsigned i = 0; i < 3; ++i)
+            {
+                c[i] = premultiplied ? (a ? rng() % (a + 1) : 0) : rng() & 0xff;
+            }
+            im(x, y) = c[0] | (c[1] << 8) | (c[2] << 16) | (std::uint32_t(a) << 24);
+        }
+    }
+    im.set_premultiplied(true);
+}
+
+// compositing through agg's comp_op table
+void reference(mapnik::image_rgba8 & dst, mapnik::image_rgba8 const& src, mapnik::composite_mode_e mode,
+               float opacity, int dx, int dy)
+{
+    using blender_type = agg::comp_op_adaptor_rgba_pre<agg::rgba8, agg::order_rgba>;
+    using pixfmt_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
+    agg::rendering_buffer dst_buffer(dst.getBytes(), dst.width(), dst.height(), dst.getRowSize());
+    agg::rendering_buffer src_buffer(const_cast<unsigned char*>(src.getBytes()), src.width(), src.height(), src.getRowSize());
+    pixfmt_type pixf(dst_buffer);
+    pixf.comp_op(static_cast<agg::comp_op_e>(mode));
+    agg::pixfmt_rgba32 pixf_mask(src_buffer);
+    agg::renderer_base<pixfmt_type> ren(pixf);
+    ren.blend_from(pixf_mask, 0, dx, dy, unsigned(255*opacity));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        std::mt19937 rng(42);
+        std::vector<mapnik::composite_mode_e> modes = { mapnik::src_over, mapnik::multiply,
+                                                        mapnik::screen, mapnik::dst_out,
+                                                        mapnik::overlay };
+        std::vector<float> opacities = { 1.0f, 0.5f, 0.3f, 0.0f };
+        std::vector<std::pair<int,int> > offsets = { {0, 0}, {3, -2}, {-5, 7}, {40, 0} };
+        for (bool premultiplied : { true, false })
+        {
+            mapnik::image_rgba8 src(37, 29);
+            mapnik::image_rgba8 dst(41, 23);
+            detail::fill_random(src, rng, premultiplied);
+            detail::fill_random(dst, rng, premultiplied);
+            for (auto mode : modes)
+            {
+                for (float opacity : opacities)
+                {
+                    for (auto const& offset : offsets)
+                    {
+                        mapnik::image_rgba8 expected(dst);
+                        mapnik::image_rgba8 actual(dst);
+                        detail::reference(expected, src, mode, opacity, offset.first, offset.second);
+                        mapnik::composite(actual, src, mode, opacity, offset.first, offset.second);
+                        BOOST_TEST(std::equal(expected.getBytes(), expected.getBytes() + expected.getSize(),
+                                              actual.getBytes()));
+                    }
+                }
+            }
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ image compositing: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,145 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/label_collision_detector.hpp>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// linear scan with the semantics of the detector, labels without text
+// have empty text
+struct brute_force_detector
+{
+    using label = std::pair<mapnik::box2d<double>, mapnik::value_unicode_string>;
+
+    bool has_placement(mapnik::box2d<double> const& box, double margin,
+                       mapnik::value_unicode_string const& text, double repeat_distance) const
+    {
+        mapnik::box2d<double> margin_box = box;
+        if (margin > 0)
+        {
+            margin_box.init(box.minx() - margin, box.miny() - margin, box.maxx() + margin, box.maxy() + margin);
+        }
+        mapnik::box2d<double> repeat_box(box.minx() - repeat_distance, box.miny() - repeat_distance,
+                                         box.maxx() + repeat_distance, box.maxy() + repeat_distance);
+        bool repeat = repeat_distance > margin;
+        for (auto const& lab : labels)
+        {
+            if (lab.first.intersects(margin_box)) return false;
+            if (repeat && lab.second == text && lab.first.intersects(repeat_box)) return false;
+        }
+        return true;
+    }
+
+    std::vector<label> labels;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        using mapnik::box2d;
+        mapnik::label_collision_detector4 detector(box2d<double>(-64, -64, 1088, 1088));
+        mapnik::value_unicode_string main_street("Main Street");
+        mapnik::value_unicode_string high_street("High Street");
+
+        // a label spanning several grid cells
+        box2d<double> wide(100, 100, 400, 120);
+        BOOST_TEST(detector.has_placement(wide));
+        detector.insert(wide, main_street);
+        BOOST_TEST(!detector.has_placement(box2d<double>(350, 110, 360, 130)));
+        BOOST_TEST(detector.has_placement(box2d<double>(350, 125, 360, 130)));
+        BOOST_TEST(!detector.has_placement(box2d<double>(350, 125, 360, 130), 10));
+
+        // repeat distance only applies to labels with the same text
+        box2d<double> nearby(100, 200, 200, 220);
+        BOOST_TEST(!detector.has_placement(nearby, 0, main_street, 100));
+        BOOST_TEST(detector.has_placement(nearby, 0, high_street, 100));
+        BOOST_TEST(detector.has_placement(nearby, 0, main_street, 50));
+
+        // boxes partly outside the extent still collide
+        box2d<double> edge(-100, 1000, -10, 1100);
+        detector.insert(edge);
+        BOOST_TEST(!detector.has_placement(box2d<double>(-90, 1050, -80, 1200)));
+
+        unsigned count = 0;
+        for (auto itr = detector.begin(); itr != detector.end(); ++itr) ++count;
+        BOOST_TEST_EQ(count, 2u);
+
+        // empty text repeats labels inserted without text
+        mapnik::value_unicode_string empty;
+        BOOST_TEST(!detector.has_placement(box2d<double>(-100, 900, -10, 950), 0, empty, 100));
+        BOOST_TEST(detector.has_placement(box2d<double>(-100, 900, -10, 950), 0, main_street, 100));
+
+        detector.clear();
+        BOOST_TEST(detector.begin() == detector.end());
+        BOOST_TEST(detector.has_placement(nearby, 0, main_street, 100));
+        BOOST_TEST(detector.has_placement(wide));
+
+        // the grid agrees with a linear scan, including boxes crossing the
+        // extent and labels inserted with and without text
+        {
+            std::mt19937 gen(1234);
+            std::uniform_real_distribution<double> pos(-200, 1200);
+            std::uniform_real_distribution<double> size(1, 150);
+            std::uniform_int_distribution<int> pick(0, 3);
+            std::vector<mapnik::value_unicode_string> texts = {
+                mapnik::value_unicode_string(), main_street, high_street,
+                mapnik::value_unicode_string("Elm Street")
+            };
+            mapnik::label_collision_detector4 grid(box2d<double>(-64, -64, 1088, 1088));
+            brute_force_detector reference;
+            unsigned mismatches = 0;
+            for (int i = 0; i < 4000; ++i)
+            {
+                double x = pos(gen);
+                double y = pos(gen);
+                box2d<double> box(x, y, x + size(gen), y + size(gen) / 4);
+                mapnik::value_unicode_string const& text = texts[pick(gen)];
+                double margin = pick(gen) * 5.0;
+                double repeat_distance = pick(gen) * 40.0;
+                bool expected = reference.has_placement(box, margin, text, repeat_distance);
+                if (grid.has_placement(box, margin, text, repeat_distance) != expected) ++mismatches;
+                if (repeat_distance == 0 && grid.has_placement(box, margin) != expected) ++mismatches;
+                if (margin == 0 && repeat_distance == 0 && grid.has_placement(box) != expected) ++mismatches;
+                if (expected)
+                {
+                    if (text.isEmpty()) grid.insert(box);
+                    else grid.insert(box, text);
+                    reference.labels.emplace_back(box, text);
+                }
+            }
+            BOOST_TEST_EQ(mismatches, 0u);
+            BOOST_TEST(reference.labels.size() > 100);
+            unsigned count = 0;
+            for (auto itr = grid.begin(); itr != grid.end(); ++itr) ++count;
+            BOOST_TEST_EQ(count, reference.labels.size());
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ label collision detector: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,230 @@
+#include <iostream>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/marker_cache.hpp>
+#include <mapnik/parse_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+mapnik::image_rgba8 render(mapnik::Map const& m)
+{
+    mapnik::image_rgba8 image(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, image);
+    ren.apply();
+    return image;
+}
+
+// largest difference of any channel of any pixel
+int max_difference(mapnik::image_rgba8 const& a, mapnik::image_rgba8 const& b)
+{
+    int diff = 0;
+    unsigned char const* pa = a.getBytes();
+    unsigned char const* pb = b.getBytes();
+    for (std::size_t i = 0; i < a.getSize(); ++i)
+    {
+        diff = std::max(diff, std::abs(static_cast<int>(pa[i]) - static_cast<int>(pb[i])));
+    }
+    return diff;
+}
+
+// pixels with a channel differing by more than threshold
+unsigned differing_pixels(mapnik::image_rgba8 const& a, mapnik::image_rgba8 const& b, int threshold)
+{
+    unsigned count = 0;
+    for (unsigned y = 0; y < a.height(); ++y)
+    {
+        for (unsigned x = 0; x < a.width(); ++x)
+        {
+            unsigned pa = a(x, y);
+            unsigned pb = b(x, y);
+            for (unsigned shift = 0; shift < 32; shift += 8)
+            {
+                int diff = static_cast<int>((pa >> shift) & 0xff) - static_cast<int>((pb >> shift) & 0xff);
+                if (std::abs(diff) > threshold)
+                {
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// pixels that are not the white background
+unsigned marked_pixels(mapnik::image_rgba8 const& image)
+{
+    unsigned count = 0;
+    for (unsigned y = 0; y < image.height(); ++y)
+    {
+        for (unsigned x = 0; x < image.width(); ++x)
+        {
+            if (image(x, y) != 0xffffffff) ++count;
+        }
+    }
+    return count;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q") != args.end();
+
+    using namespace mapnik;
+
+    try
+    {
+        datasource_cache::instance().register_datasources("plugins/input/csv.input");
+
+        // one map unit per pixel
+        Map m(256, 256);
+        m.set_background(color(255, 255, 255));
+
+        feature_type_style style;
+        {
+            rule r;
+            markers_symbolizer arrow;
+            put(arrow, keys::file, std::string("shape://arrow"));
+            put(arrow, keys::image_transform, parse_transform("rotate([angle])"));
+            put(arrow, keys::allow_overlap, true);
+            put(arrow, keys::ignore_placement, true);
+            r.append(std::move(arrow));
+            markers_symbolizer faded;
+            put(faded, keys::file, std::string("shape://arrow"));
+            put(faded, keys::image_transform, parse_transform("rotate([angle] + 90) scale(1.5)"));
+            put(faded, keys::opacity, 0.4);
+            put(faded, keys::allow_overlap, true);
+            put(faded, keys::ignore_placement, true);
+            r.append(std::move(faded));
+            style.add_rule(std::move(r));
+        }
+        m.insert_style("markers", std::move(style));
+
+        // markers on a 48 pixel grid at varying subpixel offsets, some
+        // repeating so later ones come from the sprite cache
+        double const fractions[] = { 0.0, 0.25, 0.3, 0.5, 0.71, 0.9375 };
+        double const angles[] = { 0, 30, 45, 90, 200, 315 };
+        std::ostringstream csv;
+        csv << "x,y,angle\n";
+        for (int i = 0; i < 5; ++i)
+        {
+            for (int j = 0; j < 5; ++j)
+            {
+                csv << 24 + 48 * i + fractions[(i + j) % 6] << ","
+                    << 24 + 48 * j + fractions[(i * 2 + j) % 6] << ","
+                    << angles[(i + j * 3) % 6] << "\n";
+            }
+        }
+        parameters p;
+        p.emplace("type", std::string("csv"));
+        p.emplace("inline", csv.str());
+        layer lyr("layer");
+        lyr.set_datasource(datasource_cache::instance().create(p));
+        lyr.add_style("markers");
+        m.add_layer(lyr);
+        m.zoom_to_box(box2d<double>(0, 0, 256, 256));
+
+        marker_cache & cache = marker_cache::instance();
+        std::size_t capacity = cache.sprite_capacity();
+
+        // a capacity of zero disables sprites
+        cache.set_sprite_capacity(0);
+        image_rgba8 direct = render(m);
+        BOOST_TEST(marked_pixels(direct) > 25 * 100);
+
+        // sprites only differ from the rasterized markers by the 1/16
+        // pixel snapping of their offset and compositing round off
+        cache.set_sprite_capacity(capacity);
+        cache.clear();
+        image_rgba8 sprites = render(m);
+        BOOST_TEST(max_difference(direct, sprites) <= 16);
+
+        // rendering again from a warm cache is identical
+        image_rgba8 cached = render(m);
+        BOOST_TEST(std::equal(sprites.getBytes(), sprites.getBytes() + sprites.getSize(), cached.getBytes()));
+
+        // markers rotated along lines use sprites too, at their exact
+        // angle or snapped to rotation buckets
+        Map lines(256, 256);
+        lines.set_background(color(255, 255, 255));
+        feature_type_style line_style;
+        {
+            rule r;
+            markers_symbolizer arrow;
+            put(arrow, keys::file, std::string("shape://arrow"));
+            put(arrow, keys::markers_placement_type, MARKER_LINE_PLACEMENT);
+            put(arrow, keys::spacing, 40.0);
+            put(arrow, keys::allow_overlap, true);
+            put(arrow, keys::ignore_placement, true);
+            r.append(std::move(arrow));
+            line_style.add_rule(std::move(r));
+        }
+        lines.insert_style("markers", std::move(line_style));
+        parameters lp;
+        lp.emplace("type", std::string("csv"));
+        lp.emplace("inline", std::string("wkt\n"
+                                         "\"LINESTRING(10 20,246 40)\"\n"
+                                         "\"LINESTRING(20 240,60 100,240 200)\"\n"
+                                         "\"LINESTRING(30 60,128 128,100 230)\"\n"));
+        layer line_layer("lines");
+        line_layer.set_datasource(datasource_cache::instance().create(lp));
+        line_layer.add_style("markers");
+        lines.add_layer(line_layer);
+        lines.zoom_to_box(box2d<double>(0, 0, 256, 256));
+
+        cache.set_sprite_capacity(0);
+        image_rgba8 line_direct = render(lines);
+        BOOST_TEST(marked_pixels(line_direct) > 10 * 50);
+        cache.set_sprite_capacity(capacity);
+        cache.clear();
+        BOOST_TEST_EQ(cache.sprite_rotation_steps(), 0u);
+        image_rgba8 line_sprites = render(lines);
+        BOOST_TEST(max_difference(line_direct, line_sprites) <= 16);
+        image_rgba8 line_cached = render(lines);
+        BOOST_TEST(std::equal(line_sprites.getBytes(), line_sprites.getBytes() + line_sprites.getSize(), line_cached.getBytes()));
+        // half a degree off moves the edges of the arrows by a fraction
+        // of a pixel
+        cache.set_sprite_rotation_steps(360);
+        cache.clear();
+        image_rgba8 line_buckets = render(lines);
+        BOOST_TEST(differing_pixels(line_direct, line_buckets, 64) * 20 < marked_pixels(line_direct));
+        cache.set_sprite_rotation_steps(0);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << std::endl;
+        BOOST_TEST(false);
+    }
+
+    if (::boost::detail::test_errors())
+    {
+        return ::boost::report_errors();
+    }
+    else
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ marker sprites: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+}
@@ -0,0 +1,101 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/map.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/metatile.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/palette.hpp>
+#include <mapnik/image_util.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // tiles are snapped to the metatile grid
+        mapnik::metatile mt(5, 13, 22, 8);
+        BOOST_TEST_EQ(mt.x(), 8u);
+        BOOST_TEST_EQ(mt.y(), 16u);
+        BOOST_TEST_EQ(mt.columns(), 8u);
+        BOOST_TEST_EQ(mt.rows(), 8u);
+        BOOST_TEST_EQ(mt.width(), 2048u);
+        double span = mapnik::EARTH_CIRCUMFERENCE / 32;
+        mapnik::box2d<double> ext = mt.extent();
+        BOOST_TEST(std::fabs(ext.minx() - (-mapnik::MAXEXTENT + 8 * span)) < 1e-6);
+        BOOST_TEST(std::fabs(ext.maxy() - (mapnik::MAXEXTENT - 16 * span)) < 1e-6);
+        BOOST_TEST(std::fabs(ext.width() - 8 * span) < 1e-6);
+
+        // low zooms have fewer tiles than the metatile size
+        mapnik::metatile world(1, 1, 0, 8);
+        BOOST_TEST_EQ(world.columns(), 2u);
+        BOOST_TEST_EQ(world.rows(), 2u);
+        BOOST_TEST(std::fabs(world.extent().minx() + mapnik::MAXEXTENT) < 1e-6);
+        BOOST_TEST(std::fabs(world.extent().maxx() - mapnik::MAXEXTENT) < 1e-6);
+
+        bool thrown = false;
+        try
+        {
+            mapnik::metatile invalid(2, 4, 0);
+        }
+        catch (std::exception const&)
+        {
+            thrown = true;
+        }
+        BOOST_TEST(thrown);
+
+        mapnik::Map m(256,256,mapnik::MAPNIK_GMERC_PROJ);
+        m.set_background(mapnik::color("green"));
+        std::vector<mapnik::metatile_tile> tiles = mapnik::render_metatile(m, world, mapnik::attributes(), 1.0, "png");
+        BOOST_TEST_EQ(tiles.size(), 4u);
+        if (tiles.size() == 4)
+        {
+            BOOST_TEST_EQ(tiles[1].x, 1u);
+            BOOST_TEST_EQ(tiles[1].y, 0u);
+            BOOST_TEST_EQ(tiles[2].x, 0u);
+            BOOST_TEST_EQ(tiles[2].y, 1u);
+            for (mapnik::metatile_tile const& tile : tiles)
+            {
+                BOOST_TEST_EQ(tile.z, 1u);
+                BOOST_TEST_EQ(tile.image.width(), 256u);
+                BOOST_TEST_EQ(tile.image.height(), 256u);
+                BOOST_TEST_EQ(tile.image(255,255), mapnik::color("green").rgba());
+                BOOST_TEST(tile.encoded.size() > 0);
+            }
+        }
+
+        // all tiles share one fixed palette
+        mapnik::rgba_palette palette(std::string("\x00\x80\x00\xff\xff\xff\xff\xff", 8));
+        std::vector<mapnik::metatile_tile> paletted = mapnik::render_metatile(m, world, "png8:p=2", palette);
+        BOOST_TEST_EQ(paletted.size(), 4u);
+        for (mapnik::metatile_tile const& tile : paletted)
+        {
+            BOOST_TEST(tile.encoded.size() > 0);
+            BOOST_TEST(tile.encoded == mapnik::save_to_string(tile.image, "png8", palette));
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ metatile rendering: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
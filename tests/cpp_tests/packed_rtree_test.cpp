@@ -0,0 +1,189 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <mapnik/box2d.hpp>
+#include <mapnik/geom_util.hpp>
+#include "../../utils/shapeindex/packed_rtree.hpp"
+#include "../../plugins/input/shape/shp_index.hpp"
+
+namespace {
+
+using mapnik::filter_in_box;
+using index_type = shp_index<filter_in_box, std::istringstream>;
+
+std::string write_index(std::vector<box2d<double> > const& items, int node_size)
+{
+    box2d<double> extent;
+    for (auto const& b : items)
+    {
+        if (extent.valid()) extent.expand_to_include(b);
+        else extent = b;
+    }
+    packed_rtree<int> tree(extent, node_size);
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        tree.insert(static_cast<int>(i), items[i]);
+    }
+    std::ostringstream out;
+    tree.write(out);
+    return out.str();
+}
+
+std::vector<int> brute_force(std::vector<box2d<double> > const& items, box2d<double> const& box)
+{
+    filter_in_box filter(box);
+    std::vector<int> ids;
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        if (filter.pass(items[i])) ids.push_back(static_cast<int>(i));
+    }
+    return ids;
+}
+
+std::vector<int> to_ids(std::vector<std::streampos> const& pos)
+{
+    std::vector<int> ids;
+    for (auto p : pos) ids.push_back(static_cast<int>(p));
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// query the index both through a stream and in memory
+bool matches(std::string const& data, std::vector<box2d<double> > const& items, box2d<double> const& box)
+{
+    std::vector<int> expected = brute_force(items, box);
+    filter_in_box filter(box);
+    std::istringstream in(data);
+    std::vector<std::streampos> from_stream;
+    index_type::query(filter, in, from_stream);
+    std::vector<std::streampos> from_memory;
+    index_type::query(filter, data.data(), data.data() + data.size(), from_memory);
+    return to_ids(from_stream) == expected && to_ids(from_memory) == expected;
+}
+
+// every item box, its corners and boxes just touching its edges
+bool matches_all_boundaries(std::string const& data, std::vector<box2d<double> > const& items)
+{
+    for (auto const& b : items)
+    {
+        if (!matches(data, items, b)) return false;
+        if (!matches(data, items, box2d<double>(b.minx(), b.miny(), b.minx(), b.miny()))) return false;
+        if (!matches(data, items, box2d<double>(b.maxx(), b.maxy(), b.maxx(), b.maxy()))) return false;
+        if (!matches(data, items, box2d<double>(b.maxx(), b.miny(), b.maxx() + 1, b.maxy()))) return false;
+        if (!matches(data, items, box2d<double>(b.minx() - 1, b.maxy(), b.maxx(), b.maxy() + 1))) return false;
+    }
+    return true;
+}
+
+std::vector<box2d<double> > grid(int cols, int rows, int count)
+{
+    std::vector<box2d<double> > items;
+    for (int i = 0; i < count; ++i)
+    {
+        double x = (i % cols) * 10.0;
+        double y = ((i / cols) % rows) * 10.0;
+        items.emplace_back(x, y, x + 10, y + 10);
+    }
+    return items;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // empty index
+        {
+            std::vector<box2d<double> > items;
+            std::string data = write_index(items, 16);
+            BOOST_TEST(data.size() == 16 + 8);
+            BOOST_TEST(matches(data, items, box2d<double>(-1e9, -1e9, 1e9, 1e9)));
+        }
+
+        // a single item and a single leaf node
+        {
+            std::vector<box2d<double> > items = grid(1, 1, 1);
+            std::string data = write_index(items, 16);
+            BOOST_TEST(matches(data, items, box2d<double>(5, 5, 6, 6)));
+            BOOST_TEST(matches(data, items, box2d<double>(20, 20, 30, 30)));
+            BOOST_TEST(matches_all_boundaries(data, items));
+        }
+        {
+            std::vector<box2d<double> > items = grid(4, 4, 16);
+            std::string data = write_index(items, 16);
+            BOOST_TEST(matches_all_boundaries(data, items));
+            BOOST_TEST(matches(data, items, box2d<double>(-5, -5, 45, 45)));
+        }
+
+        // partial last node on every level: 53 items with 4 children per node
+        // gives 14, 4 and 1 nodes above the leaves
+        {
+            std::vector<box2d<double> > items = grid(8, 7, 53);
+            std::string data = write_index(items, 4);
+            BOOST_TEST(matches_all_boundaries(data, items));
+            BOOST_TEST(matches(data, items, box2d<double>(-5, -5, 100, 100)));
+            BOOST_TEST(matches(data, items, box2d<double>(200, 200, 300, 300)));
+            // rows and columns along the shared edges of the items
+            for (int i = 0; i <= 80; i += 10)
+            {
+                BOOST_TEST(matches(data, items, box2d<double>(i, -5, i, 100)));
+                BOOST_TEST(matches(data, items, box2d<double>(-5, i, 100, i)));
+            }
+        }
+
+        // overlapping items of random size against random queries
+        {
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<double> pos(0, 1000);
+            std::uniform_real_distribution<double> size(0, 50);
+            for (int node_size : {2, 3, 16})
+            {
+                std::vector<box2d<double> > items;
+                for (int i = 0; i < 500; ++i)
+                {
+                    double x = pos(gen);
+                    double y = pos(gen);
+                    items.emplace_back(x, y, x + size(gen), y + size(gen));
+                }
+                std::string data = write_index(items, node_size);
+                bool ok = true;
+                for (int i = 0; i < 200 && ok; ++i)
+                {
+                    double x = pos(gen);
+                    double y = pos(gen);
+                    ok = matches(data, items, box2d<double>(x, y, x + 4 * size(gen), y + 4 * size(gen)));
+                }
+                BOOST_TEST(ok);
+                BOOST_TEST(matches_all_boundaries(data, items));
+            }
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ packed rtree: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
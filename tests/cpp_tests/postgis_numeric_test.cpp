@@ -0,0 +1,152 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include "../../plugins/input/postgis/numeric2string.hpp"
+
+namespace {
+
+void put_int16(std::string & buf, int value)
+{
+    buf += static_cast<char>((value >> 8) & 0xff);
+    buf += static_cast<char>(value & 0xff);
+}
+
+// binary numeric as sent by postgres: ndigits, weight, sign and dscale
+// followed by base 10000 digits, all big endian int16
+std::string make_numeric(std::vector<int> const& digits, int weight, int sign = 0x0000, int dscale = 0)
+{
+    std::string buf;
+    put_int16(buf, static_cast<int>(digits.size()));
+    put_int16(buf, weight);
+    put_int16(buf, sign);
+    put_int16(buf, dscale);
+    for (int digit : digits) put_int16(buf, digit);
+    return buf;
+}
+
+bool to_double(std::string const& buf, double & value)
+{
+    return numeric2double(buf.data(), value);
+}
+
+// numeric2double must agree with correctly rounded parsing of the text form
+bool matches_string(std::string const& buf)
+{
+    double value = 0;
+    if (!to_double(buf, value)) return true;
+    return value == std::strtod(numeric2string(buf.data()).c_str(), nullptr);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        double value = 0;
+
+        // 1234.5678
+        BOOST_TEST(to_double(make_numeric({1234, 5678}, 0, 0x0000, 4), value));
+        BOOST_TEST_EQ(value, 1234.5678);
+
+        // negative values
+        BOOST_TEST(to_double(make_numeric({12, 5000}, 0, 0x4000, 1), value));
+        BOOST_TEST_EQ(value, -12.5);
+        BOOST_TEST(to_double(make_numeric({1}, 2, 0x4000), value));
+        BOOST_TEST_EQ(value, -1e8);
+
+        // weights below zero: 0.0001, 0.00000025 and 5e-17
+        BOOST_TEST(to_double(make_numeric({1}, -1, 0x0000, 4), value));
+        BOOST_TEST_EQ(value, 0.0001);
+        BOOST_TEST(to_double(make_numeric({25}, -2, 0x0000, 8), value));
+        BOOST_TEST_EQ(value, 0.00000025);
+        BOOST_TEST(to_double(make_numeric({5000}, -5, 0x0000, 17), value));
+        BOOST_TEST_EQ(value, 5e-17);
+        BOOST_TEST(to_double(make_numeric({1234}, -3, 0x4000, 12), value));
+        BOOST_TEST_EQ(value, -1.234e-9);
+
+        // ndigits == 0 is zero whatever the weight
+        BOOST_TEST(to_double(make_numeric({}, 0), value));
+        BOOST_TEST_EQ(value, 0.0);
+        BOOST_TEST(to_double(make_numeric({}, 10, 0x0000, 3), value));
+        BOOST_TEST_EQ(value, 0.0);
+
+        // mantissas up to 2^53 are exact, one more falls back
+        BOOST_TEST(to_double(make_numeric({9007, 1992, 5474, 992}, 3), value));
+        BOOST_TEST_EQ(value, 9007199254740992.0);
+        BOOST_TEST(!to_double(make_numeric({9007, 1992, 5474, 993}, 3), value));
+        BOOST_TEST(to_double(make_numeric({9007, 1992, 5474, 992}, 3, 0x4000), value));
+        BOOST_TEST_EQ(value, -9007199254740992.0);
+
+        // scaling by up to 1e22 is exact, 1e23 falls back
+        BOOST_TEST(to_double(make_numeric({1}, 5), value));
+        BOOST_TEST_EQ(value, 1e20);
+        BOOST_TEST(to_double(make_numeric({100}, 5), value));
+        BOOST_TEST_EQ(value, 1e22);
+        BOOST_TEST(to_double(make_numeric({9007, 1992, 5474, 992}, 8), value));
+        BOOST_TEST_EQ(value, 9007199254740992e20);
+        BOOST_TEST(!to_double(make_numeric({1}, 6), value));
+        BOOST_TEST(to_double(make_numeric({1}, -5, 0x0000, 20), value));
+        BOOST_TEST_EQ(value, 1e-20);
+        BOOST_TEST(!to_double(make_numeric({1}, -6, 0x0000, 24), value));
+        BOOST_TEST(!to_double(make_numeric({1, 0, 0, 1}, -3, 0x0000, 24), value));
+
+        // NaN, unknown signs and more than 4 digits fall back
+        BOOST_TEST(!to_double(make_numeric({}, 0, 0xC000), value));
+        BOOST_TEST(!to_double(make_numeric({1}, 0, 0x1234), value));
+        BOOST_TEST(!to_double(make_numeric({1, 2, 3, 4, 5}, 4), value));
+
+        // whenever the fast path is taken it matches parsing the text form
+        std::mt19937 gen(22);
+        std::uniform_int_distribution<int> ndigits(0, 5);
+        std::uniform_int_distribution<int> digit(0, 9999);
+        std::uniform_int_distribution<int> weight(-8, 8);
+        std::uniform_int_distribution<int> sign(0, 1);
+        unsigned fast = 0;
+        bool all_match = true;
+        for (int i = 0; i < 20000; ++i)
+        {
+            std::vector<int> digits(ndigits(gen));
+            for (int & d : digits) d = digit(gen);
+            // postgres strips leading and trailing zero digits
+            if (!digits.empty() && digits.front() == 0) digits.front() = 1;
+            if (!digits.empty() && digits.back() == 0) digits.back() = 1;
+            int w = weight(gen);
+            int dscale = std::max(0, 4 * (static_cast<int>(digits.size()) - w - 1));
+            std::string buf = make_numeric(digits, w, sign(gen) ? 0x4000 : 0x0000, dscale);
+            if (to_double(buf, value)) ++fast;
+            if (!matches_string(buf)) all_match = false;
+        }
+        BOOST_TEST(all_match);
+        BOOST_TEST(fast > 1000);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ postgis numeric: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/metatile.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+mapnik::image_rgba8 render(mapnik::Map const& m)
+{
+    mapnik::image_rgba8 image(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, image);
+    ren.apply();
+    return image;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q") != args.end();
+
+    using namespace mapnik;
+
+    try
+    {
+        datasource_cache::instance().register_datasources("plugins/input/csv.input");
+
+        // utm map of longlat layers, reprojected through proj4 by every layer
+        Map m(256, 256, "+proj=utm +zone=31 +datum=WGS84 +units=m +no_defs");
+
+        feature_type_style style;
+        {
+            rule r;
+            polygon_symbolizer poly_sym;
+            put(poly_sym, keys::fill_opacity, 0.5);
+            r.append(std::move(poly_sym));
+            line_symbolizer line_sym;
+            r.append(std::move(line_sym));
+            style.add_rule(std::move(r));
+        }
+        m.insert_style("style", std::move(style));
+
+        for (int i = 0; i < 8; ++i)
+        {
+            std::ostringstream wkt;
+            double x = 0.5 + i * 0.6;
+            double y = 42.0 + i * 0.7;
+            wkt << "wkt\n\"POLYGON((" << x << " " << y << "," << x + 1.5 << " " << y << ","
+                << x + 1.5 << " " << y + 2 << "," << x << " " << y + 2 << "," << x << " " << y << "))\"\n"
+                << "\"LINESTRING(" << x << " " << y + 3 << "," << x + 2 << " " << y - 1 << ")\"";
+            parameters p;
+            p.emplace("type", std::string("csv"));
+            p.emplace("inline", wkt.str());
+            layer lyr("layer", MAPNIK_LONGLAT_PROJ);
+            lyr.set_datasource(datasource_cache::instance().create(p));
+            lyr.add_style("style");
+            m.add_layer(lyr);
+        }
+        m.zoom_all();
+
+        image_rgba8 serial = render(m);
+        BOOST_TEST_EQ(serial.painted(), true);
+
+        // layers queried concurrently render the same image
+        m.set_query_threads(4);
+        for (int i = 0; i < 10; ++i)
+        {
+            image_rgba8 parallel = render(m);
+            BOOST_TEST(std::equal(serial.getBytes(), serial.getBytes() + serial.getSize(), parallel.getBytes()));
+        }
+
+        // metatiles query their layers the same way
+        m.set_srs(MAPNIK_GMERC_PROJ);
+        metatile mt(5, 16, 11, 2);
+        m.set_query_threads(1);
+        std::vector<metatile_tile> serial_tiles = render_metatile(m, mt);
+        m.set_query_threads(4);
+        std::vector<metatile_tile> parallel_tiles = render_metatile(m, mt);
+        BOOST_TEST_EQ(serial_tiles.size(), 4u);
+        BOOST_TEST_EQ(parallel_tiles.size(), serial_tiles.size());
+        bool painted = false;
+        bool same = parallel_tiles.size() == serial_tiles.size();
+        for (std::size_t i = 0; same && i < serial_tiles.size(); ++i)
+        {
+            image_rgba8 const& a = serial_tiles[i].image;
+            image_rgba8 const& b = parallel_tiles[i].image;
+            painted = painted || std::any_of(a.getData(), a.getData() + a.width() * a.height(),
+                                             [](image_rgba8::pixel_type pixel) { return pixel != 0; });
+            same = std::equal(a.getBytes(), a.getBytes() + a.getSize(), b.getBytes());
+        }
+        BOOST_TEST(painted);
+        BOOST_TEST(same);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << std::endl;
+        BOOST_TEST(false);
+    }
+
+    if (::boost::detail::test_errors())
+    {
+        return ::boost::report_errors();
+    }
+    else
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ query threads: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+}
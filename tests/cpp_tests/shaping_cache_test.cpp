@@ -0,0 +1,107 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/text/shaping_cache.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace detail {
+
+std::string const dejavu("fonts/dejavu-fonts-ttf-2.34/ttf/DejaVuSans.ttf");
+
+mapnik::shaping_key make_key(std::string const& text,
+                             long size = 10 * 64,
+                             std::string const& font_file = dejavu,
+                             int face_index = 0)
+{
+    mapnik::shaping_key key;
+    key.text = mapnik::value_unicode_string::fromUTF8(text);
+    key.start = 0;
+    key.end = key.text.length();
+    key.size = size;
+    key.faces = font_file + '\0' + std::to_string(face_index) + '\0';
+    key.script = HB_SCRIPT_LATIN;
+    key.direction = HB_DIRECTION_LTR;
+    return key;
+}
+
+mapnik::shaped_run_ptr make_run(unsigned glyph_index)
+{
+    auto run = std::make_shared<mapnik::shaped_run>();
+    mapnik::shaped_glyph glyph = mapnik::shaped_glyph();
+    glyph.glyph_index = glyph_index;
+    run->glyphs.push_back(glyph);
+    return run;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::shaping_cache & cache = mapnik::shaping_cache::instance();
+        std::size_t capacity = cache.capacity();
+        cache.clear();
+        cache.set_capacity(2);
+
+        // miss, then hit once inserted
+        BOOST_TEST(!cache.find(detail::make_key("Main Street")));
+        auto main_run = detail::make_run(1);
+        cache.insert(detail::make_key("Main Street"), main_run);
+        BOOST_TEST(cache.find(detail::make_key("Main Street")) == main_run);
+        BOOST_TEST(!cache.find(detail::make_key("Main St")));
+
+        // the same text at another size or in another face is a different entry
+        BOOST_TEST(!cache.find(detail::make_key("Main Street", 12 * 64)));
+        BOOST_TEST(!cache.find(detail::make_key("Main Street", 10 * 64, "fonts/other/DejaVuSans.ttf")));
+        BOOST_TEST(!cache.find(detail::make_key("Main Street", 10 * 64, detail::dejavu, 1)));
+
+        // a shorter item of the same text is a different entry
+        mapnik::shaping_key item = detail::make_key("Main Street");
+        item.end = 4;
+        BOOST_TEST(!cache.find(item));
+
+        // least recently used run is evicted first
+        auto elm_run = detail::make_run(2);
+        cache.insert(detail::make_key("Elm Street"), elm_run);
+        BOOST_TEST(cache.find(detail::make_key("Main Street")) == main_run);
+        cache.insert(detail::make_key("Oak Street"), detail::make_run(3));
+        BOOST_TEST_EQ(cache.size(), 2u);
+        BOOST_TEST(cache.find(detail::make_key("Main Street")) == main_run);
+        BOOST_TEST(!cache.find(detail::make_key("Elm Street")));
+        BOOST_TEST(cache.find(detail::make_key("Oak Street")));
+
+        // shrinking the capacity evicts, zero disables caching
+        cache.set_capacity(1);
+        BOOST_TEST_EQ(cache.size(), 1u);
+        cache.set_capacity(0);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        cache.insert(detail::make_key("Main Street"), main_run);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        cache.set_capacity(capacity);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ shaping cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
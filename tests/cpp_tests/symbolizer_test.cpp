@@ -23,6 +23,53 @@ int main(int argc, char** argv)
         BOOST_TEST_EQ(sym.properties.count(keys::markers_multipolicy),static_cast<unsigned long>(1));
         marker_multi_policy_enum policy_out = get<mapnik::marker_multi_policy_enum>(sym, keys::markers_multipolicy);
         BOOST_TEST_EQ(policy_out,MARKER_WHOLE_MULTI);
+
+        // properties stay ordered by key and copies are independent
+        line_symbolizer line;
+        put(line, keys::stroke_width, 2.0);
+        put(line, keys::file, std::string("a"));
+        put(line, keys::gamma, 0.5);
+        put(line, keys::stroke_width, 3.0);
+        BOOST_TEST_EQ(line.properties.size(), 3u);
+        BOOST_TEST(line.properties.begin()->first == keys::gamma);
+        line_symbolizer copy(line);
+        line.properties.erase(keys::file);
+        BOOST_TEST_EQ(line.properties.count(keys::file), 0u);
+        BOOST_TEST_EQ(copy.properties.count(keys::file), 1u);
+        BOOST_TEST_EQ(get<std::string>(copy, keys::file), std::string("a"));
+        BOOST_TEST_EQ(get<value_double>(copy, keys::stroke_width), 3.0);
+        BOOST_TEST(!(copy == line));
+        put(line, keys::file, std::string("a"));
+        BOOST_TEST(copy == line);
+
+        // symbolizers moved within a vector, as when a rule removes one,
+        // still report exactly the properties they hold
+        std::vector<symbolizer> syms;
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            line_symbolizer ls;
+            put(ls, keys::stroke_width, static_cast<value_double>(i));
+            if (i % 2) put(ls, keys::file, std::string("f") + std::to_string(i));
+            syms.emplace_back(std::move(ls));
+        }
+        syms.erase(syms.begin());
+        syms.erase(syms.begin() + 1);
+        BOOST_TEST_EQ(syms.size(), 2u);
+        line_symbolizer const& first = syms[0].get<line_symbolizer>();
+        line_symbolizer const& second = syms[1].get<line_symbolizer>();
+        BOOST_TEST_EQ(first.properties.size(), 2u);
+        BOOST_TEST_EQ(std::distance(first.properties.begin(), first.properties.end()), 2);
+        BOOST_TEST_EQ(first.properties.count(keys::file), 1u);
+        BOOST_TEST_EQ(get<std::string>(first, keys::file), std::string("f1"));
+        BOOST_TEST_EQ(get<value_double>(first, keys::stroke_width), 1.0);
+        BOOST_TEST_EQ(second.properties.size(), 2u);
+        BOOST_TEST_EQ(std::distance(second.properties.begin(), second.properties.end()), 2);
+        BOOST_TEST_EQ(second.properties.count(keys::file), 1u);
+        BOOST_TEST_EQ(get<std::string>(second, keys::file), std::string("f3"));
+        BOOST_TEST_EQ(get<value_double>(second, keys::stroke_width), 3.0);
+        BOOST_TEST_EQ(second.properties.count(keys::gamma), 0u);
+        BOOST_TEST(second.properties.find(keys::gamma) == second.properties.end());
+        BOOST_TEST_EQ(get<value_double>(second, keys::gamma, 1.0), 1.0);
     }
     catch (std::exception const & ex)
     {
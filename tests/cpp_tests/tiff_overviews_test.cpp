@@ -0,0 +1,145 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mapnik/image.hpp>
+#include <mapnik/image_any.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/tiff_tile_cache.hpp>
+#include <mapnik/util/variant.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "utils.hpp"
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        BOOST_TEST(set_working_dir(args));
+#if defined(HAVE_TIFF)
+        mapnik::tiff_tile_cache & cache = mapnik::tiff_tile_cache::instance();
+        cache.clear();
+
+        // 256x256 tiled image with 128x128 and 64x64 internal overviews
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader("./tests/cpp_tests/data/tiff_overviews.tiff", "tiff"));
+        BOOST_TEST_EQ(reader->levels(), 3u);
+        BOOST_TEST_EQ(reader->level_width(1), 128u);
+        BOOST_TEST_EQ(reader->level_height(2), 64u);
+        BOOST_TEST_EQ(reader->level_for_factor(1.0), 0u);
+        BOOST_TEST_EQ(reader->level_for_factor(3.0), 1u);
+        BOOST_TEST_EQ(reader->level_for_factor(4.0), 2u);
+        BOOST_TEST_EQ(reader->level_for_factor(100.0), 2u);
+
+        mapnik::image_any level1 = reader->read_level(1, 0, 0, 128, 128);
+        BOOST_TEST(level1.is<mapnik::image_gray8>());
+        if (level1.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(level1)(100, 100)), 20u);
+        }
+        mapnik::image_any level2 = reader->read_level(2, 10, 10, 20, 20);
+        if (level2.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(level2)(0, 0)), 30u);
+        }
+
+        // reading an overview leaves the full resolution image selected
+        mapnik::image_any full = reader->read(60, 70, 10, 10);
+        BOOST_TEST(full.is<mapnik::image_gray8>());
+        if (full.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(full)(5, 5)), 140u);
+        }
+
+        // decoded tiles are shared with later readers of the same file
+        std::size_t cached = cache.size();
+        BOOST_TEST(cached > 0);
+        std::unique_ptr<mapnik::image_reader> reader2(mapnik::get_image_reader("./tests/cpp_tests/data/tiff_overviews.tiff", "tiff"));
+        mapnik::image_any full2 = reader2->read(60, 70, 10, 10);
+        BOOST_TEST_EQ(cache.size(), cached);
+        if (full2.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(full2)(5, 5)), 140u);
+        }
+
+        // tiles decoded concurrently match a serial read, from file and memory
+        cache.clear();
+        mapnik::image_any serial = reader->read(30, 20, 200, 180);
+        cache.clear();
+        reader2->set_threads(4);
+        mapnik::image_any threaded = reader2->read(30, 20, 200, 180);
+        BOOST_TEST(threaded.getSize() == serial.getSize() &&
+                   std::equal(serial.getBytes(), serial.getBytes() + serial.getSize(), threaded.getBytes()));
+        std::ifstream file("./tests/cpp_tests/data/tiff_overviews.tiff", std::ios::binary);
+        std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::unique_ptr<mapnik::image_reader> memory(mapnik::get_image_reader(buffer.data(), buffer.size()));
+        memory->set_threads(4);
+        mapnik::image_any from_memory = memory->read(30, 20, 200, 180);
+        BOOST_TEST(from_memory.getSize() == serial.getSize() &&
+                   std::equal(serial.getBytes(), serial.getBytes() + serial.getSize(), from_memory.getBytes()));
+
+        // overviews in a .ovr file next to the image
+        std::unique_ptr<mapnik::image_reader> external(mapnik::get_image_reader("./tests/cpp_tests/data/tiff_external_overviews.tiff", "tiff"));
+        BOOST_TEST_EQ(external->levels(), 3u);
+        BOOST_TEST_EQ(external->level_width(1), 64u);
+        BOOST_TEST_EQ(external->level_width(2), 32u);
+        mapnik::image_any ovr = external->read_level(2, 0, 0, 32, 32);
+        if (ovr.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(ovr)(31, 31)), 30u);
+        }
+        mapnik::image_any base = external->read(0, 0, 16, 16);
+        if (base.is<mapnik::image_gray8>())
+        {
+            BOOST_TEST_EQ(unsigned(mapnik::util::get<mapnik::image_gray8>(base)(15, 15)), 10u);
+        }
+        // the thread count reaches the reader of the .ovr file
+        cache.clear();
+        mapnik::image_any ovr_serial = external->read_level(1, 0, 0, 64, 64);
+        cache.clear();
+        external->set_threads(4);
+        BOOST_TEST_EQ(external->threads(), 4u);
+        mapnik::image_any ovr_threaded = external->read_level(1, 0, 0, 64, 64);
+        BOOST_TEST(ovr_threaded.getSize() == ovr_serial.getSize() &&
+                   std::equal(ovr_serial.getBytes(), ovr_serial.getBytes() + ovr_serial.getSize(), ovr_threaded.getBytes()));
+
+        // reads of the whole image use cached tiles but don't add theirs
+        cache.clear();
+        mapnik::image_any whole = reader->read(0, 0, 256, 256);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        reader->read(0, 0, 128, 128);
+        cached = cache.size();
+        BOOST_TEST(cached > 0);
+        mapnik::image_any whole2 = reader->read(0, 0, 256, 256);
+        BOOST_TEST_EQ(cache.size(), cached);
+        BOOST_TEST(whole2.getSize() == whole.getSize() &&
+                   std::equal(whole.getBytes(), whole.getBytes() + whole.getSize(), whole2.getBytes()));
+        cache.clear();
+#endif
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ tiff overviews: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
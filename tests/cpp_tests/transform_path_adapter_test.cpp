@@ -0,0 +1,294 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <mapnik/vertex.hpp>
+#include <mapnik/transform_path_adapter.hpp>
+#include <mapnik/view_transform.hpp>
+
+namespace {
+
+struct test_vertex
+{
+    unsigned cmd;
+    double x;
+    double y;
+    bool operator==(test_vertex const& rhs) const
+    {
+        return cmd == rhs.cmd && x == rhs.x && y == rhs.y;
+    }
+};
+
+struct test_path
+{
+    explicit test_path(std::vector<test_vertex> const& vertices)
+        : vertices_(vertices), pos_(0) {}
+
+    unsigned vertex(double * x, double * y) const
+    {
+        if (pos_ >= vertices_.size()) return mapnik::SEG_END;
+        test_vertex const& v = vertices_[pos_++];
+        *x = v.x;
+        *y = v.y;
+        return v.cmd;
+    }
+
+    void rewind(unsigned) const
+    {
+        pos_ = 0;
+    }
+
+    int type() const
+    {
+        return 2;
+    }
+
+    std::vector<test_vertex> vertices_;
+    mutable std::size_t pos_;
+};
+
+struct scale_transform
+{
+    void forward(double * x, double * y) const
+    {
+        *x *= 2;
+        *y *= 2;
+    }
+};
+
+// scale_transform that also transforms whole arrays
+struct bulk_scale_transform : scale_transform
+{
+    bulk_scale_transform()
+        : bulk_calls(0) {}
+
+    using scale_transform::forward;
+
+    void forward(double * x, double * y, std::size_t size) const
+    {
+        ++bulk_calls;
+        for (std::size_t i = 0; i < size; ++i) forward(x + i, y + i);
+    }
+
+    mutable int bulk_calls;
+};
+
+// shifts x by one and fails on points with a negative x, either by marking
+// them with HUGE_VAL like proj4 does in bulk calls or by failing the call
+struct test_proj_transform
+{
+    test_proj_transform(bool equal, bool fail_bulk)
+        : equal_(equal), fail_bulk_(fail_bulk), bulk_calls(0), vertex_calls(0) {}
+
+    bool equal() const
+    {
+        return equal_;
+    }
+
+    bool backward(double * x, double * y, double *, int point_count) const
+    {
+        ++bulk_calls;
+        bool failed = false;
+        for (int i = 0; i < point_count; ++i)
+        {
+            if (x[i] < 0) failed = true;
+        }
+        if (failed && fail_bulk_) return false;
+        for (int i = 0; i < point_count; ++i)
+        {
+            if (x[i] < 0)
+            {
+                x[i] = HUGE_VAL;
+                y[i] = HUGE_VAL;
+            }
+            else
+            {
+                x[i] += 1;
+            }
+        }
+        return true;
+    }
+
+    bool backward(double & x, double &, double &) const
+    {
+        ++vertex_calls;
+        if (x < 0) return false;
+        x += 1;
+        return true;
+    }
+
+    bool equal_;
+    bool fail_bulk_;
+    mutable int bulk_calls;
+    mutable int vertex_calls;
+};
+
+using adapter_type = mapnik::transform_path_adapter<scale_transform, test_path, test_proj_transform>;
+
+template <typename Adapter>
+std::vector<test_vertex> read_all(Adapter const& adapter)
+{
+    std::vector<test_vertex> out;
+    test_vertex v;
+    while ((v.cmd = adapter.vertex(&v.x, &v.y)) != mapnik::SEG_END)
+    {
+        out.push_back(v);
+    }
+    return out;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    using mapnik::SEG_MOVETO;
+    using mapnik::SEG_LINETO;
+
+    // y holds the vertex index, points with a negative x fail to reproject
+    std::vector<test_vertex> input = {
+        { SEG_MOVETO, 0, 0 },
+        { SEG_LINETO, 1, 1 },
+        { SEG_LINETO, -1, 2 },
+        { SEG_LINETO, 2, 3 },
+        { SEG_LINETO, 3, 4 },
+        { SEG_MOVETO, -1, 5 },
+        { SEG_LINETO, 4, 6 },
+        { SEG_LINETO, -1, 7 },
+        { SEG_MOVETO, 5, 8 },
+        { SEG_LINETO, 6, 9 }
+    };
+
+    // the vertex after a dropped one starts a new sub path
+    std::vector<test_vertex> expected = {
+        { SEG_MOVETO, 2, 0 },
+        { SEG_LINETO, 4, 2 },
+        { SEG_MOVETO, 6, 6 },
+        { SEG_LINETO, 8, 8 },
+        { SEG_MOVETO, 10, 12 },
+        { SEG_MOVETO, 12, 16 },
+        { SEG_LINETO, 14, 18 }
+    };
+
+    try
+    {
+        // bulk reprojection marks failed points with HUGE_VAL
+        {
+            test_path path(input);
+            test_proj_transform prj_trans(false, false);
+            scale_transform tr;
+            adapter_type adapter(tr, path, prj_trans);
+            BOOST_TEST(read_all(adapter) == expected);
+            BOOST_TEST_EQ(prj_trans.bulk_calls, 1);
+            BOOST_TEST_EQ(prj_trans.vertex_calls, 0);
+            adapter.rewind(0);
+            BOOST_TEST(read_all(adapter) == expected);
+            BOOST_TEST_EQ(prj_trans.bulk_calls, 2);
+        }
+
+        // a failed bulk call re-reads the path and reprojects per vertex
+        {
+            test_path path(input);
+            test_proj_transform prj_trans(false, true);
+            scale_transform tr;
+            adapter_type adapter(tr, path, prj_trans);
+            BOOST_TEST(read_all(adapter) == expected);
+            BOOST_TEST_EQ(prj_trans.bulk_calls, 1);
+            BOOST_TEST_EQ(prj_trans.vertex_calls, static_cast<int>(input.size()));
+        }
+
+        // a path that fully reprojects is not read twice
+        {
+            std::vector<test_vertex> valid = {
+                { SEG_MOVETO, 0, 0 },
+                { SEG_LINETO, 1, 1 }
+            };
+            test_path path(valid);
+            test_proj_transform prj_trans(false, true);
+            scale_transform tr;
+            adapter_type adapter(tr, path, prj_trans);
+            std::vector<test_vertex> out = read_all(adapter);
+            BOOST_TEST_EQ(out.size(), 2u);
+            BOOST_TEST(out[0] == (test_vertex{ SEG_MOVETO, 2, 0 }));
+            BOOST_TEST(out[1] == (test_vertex{ SEG_LINETO, 4, 2 }));
+            BOOST_TEST_EQ(prj_trans.vertex_calls, 0);
+        }
+
+        // transforms over arrays are called once per path
+        {
+            test_path path(input);
+            test_proj_transform prj_trans(false, false);
+            bulk_scale_transform tr;
+            mapnik::transform_path_adapter<bulk_scale_transform, test_path, test_proj_transform> adapter(tr, path, prj_trans);
+            BOOST_TEST(read_all(adapter) == expected);
+            BOOST_TEST_EQ(tr.bulk_calls, 1);
+        }
+
+        // the view transform gives the same results over arrays and per point
+        {
+            mapnik::view_transform tr(256, 256, mapnik::box2d<double>(-180, -85, 180, 85), 3.5, -2.25);
+            tr.set_offset(2);
+            std::vector<double> xs;
+            std::vector<double> ys;
+            for (int i = 0; i < 37; ++i)
+            {
+                xs.push_back(-180 + i * 9.7);
+                ys.push_back(-85 + i * 4.3);
+            }
+            std::vector<double> bulk_xs(xs);
+            std::vector<double> bulk_ys(ys);
+            tr.forward(bulk_xs.data(), bulk_ys.data(), bulk_xs.size());
+            bool same = true;
+            for (std::size_t i = 0; i < xs.size(); ++i)
+            {
+                tr.forward(&xs[i], &ys[i]);
+                same = same && xs[i] == bulk_xs[i] && ys[i] == bulk_ys[i];
+            }
+            BOOST_TEST(same);
+        }
+
+        // equal projections skip reprojection and stream the source
+        {
+            test_path path(input);
+            test_proj_transform prj_trans(true, false);
+            scale_transform tr;
+            adapter_type adapter(tr, path, prj_trans);
+            std::vector<test_vertex> out = read_all(adapter);
+            BOOST_TEST_EQ(out.size(), input.size());
+            bool same = out.size() == input.size();
+            for (std::size_t i = 0; same && i < out.size(); ++i)
+            {
+                same = out[i] == (test_vertex{ input[i].cmd, input[i].x * 2, input[i].y * 2 });
+            }
+            BOOST_TEST(same);
+            BOOST_TEST_EQ(prj_trans.bulk_calls, 0);
+            BOOST_TEST_EQ(prj_trans.vertex_calls, 0);
+            adapter.rewind(0);
+            BOOST_TEST_EQ(read_all(adapter).size(), input.size());
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ transform path adapter: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
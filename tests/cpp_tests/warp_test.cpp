@@ -0,0 +1,109 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/warp.hpp>
+#include <mapnik/warp_mesh_cache.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::warp_mesh_cache & cache = mapnik::warp_mesh_cache::instance();
+        std::size_t capacity = cache.capacity();
+        cache.clear();
+
+        mapnik::image_rgba8 source(256, 256);
+        for (unsigned y = 0; y < source.height(); ++y)
+        {
+            for (unsigned x = 0; x < source.width(); ++x)
+            {
+                source(x, y) = 0xff000000 | (y << 8) | x;
+            }
+        }
+        mapnik::projection merc(mapnik::MAPNIK_GMERC_PROJ);
+        mapnik::projection longlat(mapnik::MAPNIK_LONGLAT_PROJ);
+        mapnik::proj_transform prj_trans(merc, longlat);
+        mapnik::box2d<double> source_ext(-10, 30, 20, 60);
+        mapnik::box2d<double> target_ext(source_ext);
+        prj_trans.backward(target_ext, 20);
+
+        // mesh points on the grid lines of the raster are cached in blocks
+        mapnik::image_rgba8 serial(300, 300);
+        mapnik::warp_image(serial, source, prj_trans, target_ext, source_ext, 0.0, 0.0, 16, mapnik::SCALING_BILINEAR, 1.0);
+        std::size_t blocks = cache.size();
+        BOOST_TEST(blocks > 0u);
+        BOOST_TEST(serial(150, 150) != 0u);
+
+        // the mesh is reused and bands rendered concurrently match serial output
+        mapnik::image_rgba8 banded(300, 300);
+        mapnik::warp_image(banded, source, prj_trans, target_ext, source_ext, 0.0, 0.0, 16, mapnik::SCALING_BILINEAR, 1.0, 4);
+        BOOST_TEST_EQ(cache.size(), blocks);
+        BOOST_TEST(std::equal(serial.getBytes(), serial.getBytes() + serial.getSize(), banded.getBytes()));
+
+        // a window cropped from the same raster at another pixel offset,
+        // as read for a neighbouring tile, shares the cached blocks
+        double res = 30.0 / 256;
+        mapnik::image_rgba8 window(128, 128);
+        for (unsigned y = 0; y < window.height(); ++y)
+        {
+            for (unsigned x = 0; x < window.width(); ++x)
+            {
+                window(x, y) = source(x + 61, y + 37);
+            }
+        }
+        mapnik::box2d<double> window_ext(-10 + 61 * res, 60 - 165 * res, -10 + 189 * res, 60 - 37 * res);
+        mapnik::image_rgba8 cropped(300, 300);
+        mapnik::warp_image(cropped, window, prj_trans, target_ext, window_ext, 0.0, 0.0, 16, mapnik::SCALING_BILINEAR, 1.0);
+        BOOST_TEST_EQ(cache.size(), blocks);
+        BOOST_TEST(cropped(150, 150) != 0u);
+
+        // mesh size is part of the key
+        mapnik::image_rgba8 coarse(300, 300);
+        mapnik::warp_image(coarse, source, prj_trans, target_ext, source_ext, 0.0, 0.0, 32, mapnik::SCALING_NEAR, 1.0);
+        BOOST_TEST(cache.size() > blocks);
+
+        // the capacity is a budget in bytes
+        std::size_t usage = cache.memory_usage();
+        BOOST_TEST(usage > 0u);
+        cache.set_capacity(usage / 2);
+        BOOST_TEST(cache.memory_usage() <= usage / 2);
+        BOOST_TEST(cache.size() > 0u);
+
+        // zero capacity disables caching
+        cache.set_capacity(0);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        mapnik::image_rgba8 uncached(300, 300);
+        mapnik::warp_image(uncached, source, prj_trans, target_ext, source_ext, 0.0, 0.0, 16, mapnik::SCALING_BILINEAR, 1.0, 2);
+        BOOST_TEST_EQ(cache.size(), 0u);
+        BOOST_TEST(std::equal(serial.getBytes(), serial.getBytes() + serial.getSize(), uncached.getBytes()));
+        cache.set_capacity(capacity);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ raster warping: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
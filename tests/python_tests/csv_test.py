@@ -214,6 +214,42 @@ if 'csv' in mapnik.DatasourceCache.plugin_names():
         eq_(desc['type'],mapnik.DataType.Vector)
         eq_(desc['encoding'],'utf-8')
 
+    def test_bbox_query_and_features_at_point(**kwargs):
+        ds = get_csv_ds('points.csv')
+        query = mapnik.Query(mapnik.Box2d(-1,-1,1,1))
+        for fld in ds.fields():
+            query.add_property_name(fld)
+        fs = ds.features(query).features
+        eq_(len(fs),1)
+        eq_(fs[0]['label'],"0,0")
+        # features are returned in file order
+        query = mapnik.Query(mapnik.Box2d(0,0,5,0))
+        fs = ds.features(query).features
+        eq_(len(fs),2)
+        eq_(fs[0].id(),1)
+        eq_(fs[1].id(),4)
+        fs = ds.features_at_point(mapnik.Coord(2,2)).features
+        eq_(len(fs),1)
+        eq_(fs[0]['label'],"2.5,2.5")
+        fs = ds.features_at_point(mapnik.Coord(5,4),1.1).features
+        eq_(len(fs),1)
+        eq_(fs[0]['label'],"5,5")
+
+    def test_uncached_features_match_cached(**kwargs):
+        for filename in ['points.csv','nypd.csv','wkt.csv','windows_newlines.csv','mac_newlines.csv']:
+            ds = get_csv_ds(filename)
+            ds_uncached = mapnik.Datasource(type='csv',file=os.path.join('../data/csv/',filename),cache_features=False)
+            eq_(ds_uncached.envelope(),ds.envelope())
+            eq_(ds_uncached.fields(),ds.fields())
+            eq_(ds_uncached.describe()['geometry_type'],ds.describe()['geometry_type'])
+            feats = ds.all_features()
+            feats_uncached = ds_uncached.all_features()
+            eq_(len(feats_uncached),len(feats))
+            for feat, feat_uncached in zip(feats, feats_uncached):
+                eq_(feat_uncached.id(),feat.id())
+                eq_(feat_uncached.attributes,feat.attributes)
+                eq_(feat_uncached.geometries().to_wkt(),feat.geometries().to_wkt())
+
     def test_reading_windows_newlines(**kwargs):
         ds = get_csv_ds('windows_newlines.csv')
         eq_(len(ds.fields()),3)
@@ -492,6 +528,15 @@ if 'csv' in mapnik.DatasourceCache.plugin_names():
         eq_(desc['geometry_type'],mapnik.DataGeometryType.Point)
         eq_(len(ds.all_features()),2)
 
+    def test_that_feature_ids_follow_rows(**kwargs):
+        # a row with too many columns keeps its id, a row without a geometry does not
+        filename = os.path.join('../data/csv/warns','feature_id_rows.csv')
+        for cache_features in [True,False]:
+            ds = mapnik.Datasource(type='csv',file=filename,cache_features=cache_features)
+            feats = ds.all_features()
+            eq_([feat.id() for feat in feats],[1,3,4])
+            eq_([feat['label'] for feat in feats],['a','c','e'])
+
     def test_dynamically_defining_headers1(**kwargs):
         ds = mapnik.Datasource(type='csv',
                                file=os.path.join('../data/csv/fails','needs_headers_two_lines.csv'),
@@ -63,6 +63,24 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
                 fail_im.save('/tmp/mapnik-style-image-filter-' + filename + '.fail.png','png32')
         eq_(len(fails), 0, '\n'+'\n'.join(fails))
 
+    def test_style_level_image_filter_threads():
+        m = mapnik.Map(256, 256)
+        mapnik.load_map(m, '../data/good_maps/style_level_image_filter.xml')
+        m.zoom_all()
+        eq_(m.filter_threads,0)
+        for name in ("agg-stack-blur(2,3)", "blur sharpen", "sobel invert",
+                     "scale-hsla(0,1,0.2,0.8,0,1,0,1) color-to-alpha(#fff) invert gray blur"):
+            style_markers = m.find_style("markers")
+            style_markers.image_filters = name
+            replace_style(m, "markers", style_markers)
+            m.filter_threads = 0
+            im = mapnik.Image(m.width, m.height)
+            mapnik.render(m, im)
+            m.filter_threads = 4
+            im2 = mapnik.Image(m.width, m.height)
+            mapnik.render(m, im2)
+            eq_(im.tostring('png32'),im2.tostring('png32'), 'filter-threads changed the output of "%s"' % name)
+
 if __name__ == "__main__":
     setup()
     exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
@@ -157,6 +157,28 @@ if mapnik.has_png():
         eq_(len(im.tostring('png8:t=0')) == len(im_in.tostring('png8')), True)
         eq_(len(im.tostring('png8:t=0:m=o')) == len(im_in.tostring('png8:m=o')), True)
 
+    def test_parallel_encoding():
+        im = mapnik.Image.open('./images/support/transparency/aerial_rgba.png')
+        for opt in ['png32','png32:t=0','png32:z=9','png32:s=rle']:
+            expected = im.tostring(opt)
+            for threads in [2,3,8]:
+                t0 = tmp_dir + 'png-encoding-parallel.png'
+                im.save(t0, opt + ':p=%d' % threads)
+                eq_(mapnik.Image.open(t0).tostring('png32'),
+                    mapnik.Image.fromstring(expected).tostring('png32'),
+                    '%s:p=%d does not match %s' % (opt, threads, opt))
+
+    def test_parallel_quantization():
+        im = mapnik.Image.open('./images/support/transparency/aerial_rgba.png')
+        pal = mapnik.Palette(open('../data/palettes/palette256.act', 'rb').read(), 'act')
+        for opt in ['png8','png8:c=16','png8:t=0','png8:t=1']:
+            expected = im.tostring(opt)
+            for threads in [2,3,8]:
+                eq_(im.tostring(opt + ':p=%d' % threads), expected,
+                    '%s:p=%d does not match %s' % (opt, threads, opt))
+        expected = im.tostring('png8', pal)
+        eq_(im.tostring('png8:p=4', pal), expected)
+
     def test_9_colors_hextree():
         expected = './images/support/encoding-opts/png8-9cols.png'
         im = mapnik.Image.open(expected)
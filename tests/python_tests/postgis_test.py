@@ -679,6 +679,58 @@ if 'postgis' in mapnik.DatasourceCache.plugin_names() \
         eq_(meta.get('key_field'),None)
         eq_(meta['geometry_type'],mapnik.DataGeometryType.Point)
 
+    def test_binary_attribute_types():
+        ds = mapnik.PostGIS(dbname=MAPNIK_TEST_DBNAME,
+                            table='''(select ST_MakePoint(0,0) as g,
+                                             1.5::numeric as n1,
+                                             -0.001::numeric as n2,
+                                             123456789.125::numeric as n3,
+                                             12345678901234567890.5::numeric as n4,
+                                             2.5::float4 as f4,
+                                             true as b,
+                                             'ab '::char(4) as c,
+                                             'text'::text as t) as w''',
+                            geometry_field='g')
+        feat = ds.featureset().next()
+        eq_(feat['n1'],1.5)
+        eq_(feat['n2'],-0.001)
+        eq_(feat['n3'],123456789.125)
+        eq_(feat['n4'],12345678901234567890.5)
+        eq_(feat['f4'],2.5)
+        eq_(feat['b'],True)
+        eq_(feat['c'],u'ab')
+        eq_(feat['t'],u'text')
+
+    def test_prepared_statements():
+        table = '''(select geom, fips, !scale_denominator! as sd,
+                          !pixel_width! as pw, !pixel_height! as ph
+                   from world_merc where geom && !bbox!) as w'''
+        def render(**kwargs):
+            m = mapnik.Map(256,256)
+            s = mapnik.Style()
+            r = mapnik.Rule()
+            r.symbols.append(mapnik.PolygonSymbolizer())
+            r.filter = mapnik.Filter("[sd] > 0 and [pw] > 0 and [ph] > 0")
+            s.rules.append(r)
+            m.append_style('style',s)
+            lyr = mapnik.Layer('prepared')
+            lyr.datasource = mapnik.PostGIS(dbname=MAPNIK_TEST_DBNAME,table=table,
+                                            geometry_field='geom',simplify_geometries=True,**kwargs)
+            lyr.styles.append('style')
+            m.layers.append(lyr)
+            m.zoom_all()
+            images = []
+            # render twice so the second query reuses the prepared statement
+            for i in range(2):
+                im = mapnik.Image(m.width,m.height)
+                mapnik.render(m,im)
+                images.append(im.tostring('png32'))
+            eq_(images[0],images[1])
+            return images[0]
+        expected = render()
+        eq_(render(prepared_statements=True),expected)
+        eq_(render(prepared_statements=True,max_size=2,max_async_connection=2),expected)
+
     def test_persist_connection_off():
         # NOTE: max_size should be equal or greater than
         #       the pool size. There's currently no API to
@@ -0,0 +1,59 @@
+#!/usr/bin/env python
+
+from nose.tools import eq_
+from utilities import execution_path, run_all
+import os, mapnik
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+def render_overviews(size):
+    srs = '+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs'
+    lyr = mapnik.Layer('raster', srs)
+    # 256x256 tiff with 128x128 (all 20) and 64x64 (all 30) overviews
+    lyr.datasource = mapnik.Raster(
+        file = '../cpp_tests/data/tiff_overviews.tiff',
+        lox = 0,
+        loy = 0,
+        hix = 256,
+        hiy = 256
+        )
+    sym = mapnik.RasterSymbolizer()
+    sym.colorizer = mapnik.RasterColorizer(mapnik.COLORIZER_DISCRETE, mapnik.Color(0,0,0,0))
+    sym.colorizer.add_stop(0, mapnik.Color(255,0,0))
+    sym.colorizer.add_stop(25, mapnik.Color(0,255,0))
+    sym.colorizer.add_stop(35, mapnik.Color(0,0,255))
+    rule = mapnik.Rule()
+    rule.symbols.append(sym)
+    style = mapnik.Style()
+    style.rules.append(rule)
+    _map = mapnik.Map(size, size, srs)
+    _map.append_style('foo', style)
+    lyr.styles.append('foo')
+    _map.layers.append(lyr)
+    _map.zoom_to_box(lyr.envelope())
+    im = mapnik.Image(size, size)
+    mapnik.render(_map, im)
+    return im
+
+def test_raster_reads_matching_overview():
+    if 'raster' in mapnik.DatasourceCache.plugin_names() and mapnik.has_tiff():
+        # full resolution holds a gradient of x + y
+        im = render_overviews(256)
+        eq_(im.view(10,10,1,1).tostring(), '\xff\x00\x00\xff')
+        eq_(im.view(15,15,1,1).tostring(), '\x00\xff\x00\xff')
+        eq_(im.view(20,20,1,1).tostring(), '\x00\x00\xff\xff')
+        # two raster pixels per output pixel read the 128x128 overview
+        im = render_overviews(128)
+        for x, y in [(0,0), (64,64), (127,127)]:
+            eq_(im.view(x,y,1,1).tostring(), '\xff\x00\x00\xff')
+        # four raster pixels per output pixel read the 64x64 overview
+        im = render_overviews(64)
+        for x, y in [(0,0), (32,32), (63,63)]:
+            eq_(im.view(x,y,1,1).tostring(), '\x00\xff\x00\xff')
+
+if __name__ == "__main__":
+    setup()
+    exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
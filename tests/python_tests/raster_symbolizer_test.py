@@ -179,6 +179,13 @@ def test_raster_warping():
         expected = mapnik.Image.open(expected_file)
         eq_(actual.tostring('png32'),expected.tostring('png32'), 'failed comparing actual (%s) and expected (%s)' % (actual_file,expected_file))
 
+        # warping row bands concurrently gives the same result
+        eq_(_map.warp_threads,0)
+        _map.warp_threads = 4
+        im2 = mapnik.Image(_map.width,_map.height)
+        mapnik.render(_map, im2)
+        eq_(im.tostring('png32'),im2.tostring('png32'))
+
 def test_raster_warping_does_not_overclip_source():
     lyrSrs = "+init=epsg:32630"
     mapSrs = '+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs'
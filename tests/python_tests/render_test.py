@@ -235,6 +235,17 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
             actual = mapnik.Image.open(actual_file)
             expected = mapnik.Image.open(expected_file)
             eq_(actual.tostring('png32'),expected.tostring('png32'), 'failed comparing actual (%s) and expected (%s)' % (actual_file,expected_file))
+    def test_render_with_query_threads():
+        m = mapnik.Map(256,256)
+        mapnik.load_map(m,'../data/good_maps/marker-text-line.xml')
+        m.zoom_all()
+        im = mapnik.Image(256, 256)
+        mapnik.render(m,im)
+        eq_(m.query_threads,0)
+        m.query_threads = 4
+        im2 = mapnik.Image(256, 256)
+        mapnik.render(m,im2)
+        eq_(im.tostring('png32'),im2.tostring('png32'))
 
 if __name__ == "__main__":
     setup()
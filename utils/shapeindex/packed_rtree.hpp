@@ -0,0 +1,198 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef PACKED_RTREE_HPP
+#define PACKED_RTREE_HPP
+// stl
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+// mapnik
+#include <mapnik/box2d.hpp>
+
+using mapnik::box2d;
+using mapnik::coord2d;
+
+// Static R-tree bulk loaded from items sorted along a Hilbert curve.
+//
+// Written as version 2 of the shapefile .index format:
+//
+//   header        16 bytes, "mapnik" followed by the version byte (2)
+//   node_size     int32, maximum number of children per node
+//   num_levels    int32
+//   level_ends    int32 * num_levels, end of each level in the entry array
+//   entries       (box2d<double>, int32) records, leaves first, root last
+//
+// Leaf entries hold shape record offsets, entries on upper levels hold the
+// index of their first child; children of a node are contiguous.
+template <typename T>
+class packed_rtree
+{
+public:
+    explicit packed_rtree(box2d<double> const& extent, int node_size = 16)
+        : extent_(extent),
+          node_size_(std::max(node_size, 2)),
+          items_() {}
+
+    void insert(T const& data, box2d<double> const& item_ext)
+    {
+        items_.push_back(item(item_ext, data, 0));
+    }
+
+    int count() const
+    {
+        int count = 0;
+        std::size_t level_size = items_.size();
+        while (level_size > 1)
+        {
+            level_size = (level_size + node_size_ - 1) / node_size_;
+            count += level_size;
+        }
+        return count;
+    }
+
+    void write(std::ostream& out)
+    {
+        char header[16];
+        std::memset(header,0,16);
+        header[0]='m';
+        header[1]='a';
+        header[2]='p';
+        header[3]='n';
+        header[4]='i';
+        header[5]='k';
+        header[6]=2;
+        out.write(header,16);
+
+        sort_items();
+
+        std::vector<entry> entries;
+        std::vector<std::int32_t> level_ends;
+        entries.reserve(items_.size() + count());
+        for (item const& i : items_)
+        {
+            entries.push_back(entry(i.ext, i.data));
+        }
+        if (!entries.empty())
+        {
+            level_ends.push_back(entries.size());
+        }
+        // build upper levels until a single root remains
+        std::size_t level_start = 0;
+        while (!entries.empty() && entries.size() - level_start > 1)
+        {
+            std::size_t level_end = entries.size();
+            for (std::size_t i = level_start; i < level_end; i += node_size_)
+            {
+                std::size_t last = std::min(i + node_size_, level_end);
+                box2d<double> ext = entries[i].ext;
+                for (std::size_t j = i + 1; j < last; ++j)
+                {
+                    ext.expand_to_include(entries[j].ext);
+                }
+                entries.push_back(entry(ext, static_cast<std::int32_t>(i)));
+            }
+            level_start = level_end;
+            level_ends.push_back(entries.size());
+        }
+
+        std::int32_t node_size = node_size_;
+        std::int32_t num_levels = level_ends.size();
+        out.write(reinterpret_cast<char const*>(&node_size), 4);
+        out.write(reinterpret_cast<char const*>(&num_levels), 4);
+        for (std::int32_t end : level_ends)
+        {
+            out.write(reinterpret_cast<char const*>(&end), 4);
+        }
+        for (entry const& e : entries)
+        {
+            out.write(reinterpret_cast<char const*>(&e.ext), sizeof(box2d<double>));
+            out.write(reinterpret_cast<char const*>(&e.value), 4);
+        }
+    }
+
+private:
+    struct item
+    {
+        item(box2d<double> const& ext_, T const& data_, std::uint32_t hilbert_)
+            : ext(ext_), data(data_), hilbert(hilbert_) {}
+        box2d<double> ext;
+        T data;
+        std::uint32_t hilbert;
+    };
+
+    struct entry
+    {
+        entry(box2d<double> const& ext_, std::int32_t value_)
+            : ext(ext_), value(value_) {}
+        box2d<double> ext;
+        std::int32_t value;
+    };
+
+    void sort_items()
+    {
+        double const max_coord = 65535.0;
+        double width = extent_.width() > 0 ? extent_.width() : 1.0;
+        double height = extent_.height() > 0 ? extent_.height() : 1.0;
+        for (item & i : items_)
+        {
+            coord2d c = i.ext.center();
+            double x = std::min(std::max((c.x - extent_.minx()) / width, 0.0), 1.0);
+            double y = std::min(std::max((c.y - extent_.miny()) / height, 0.0), 1.0);
+            i.hilbert = hilbert(static_cast<std::uint32_t>(x * max_coord),
+                                static_cast<std::uint32_t>(y * max_coord));
+        }
+        std::stable_sort(items_.begin(), items_.end(),
+                         [] (item const& a, item const& b) { return a.hilbert < b.hilbert; });
+    }
+
+    // position of (x,y) on a 16 bit Hilbert curve
+    static std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t d = 0;
+        for (std::uint32_t s = 1 << 15; s > 0; s >>= 1)
+        {
+            std::uint32_t rx = (x & s) > 0 ? 1 : 0;
+            std::uint32_t ry = (y & s) > 0 ? 1 : 0;
+            d += s * s * ((3 * rx) ^ ry);
+            // rotate quadrant
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    x = 0xffff - x;
+                    y = 0xffff - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    box2d<double> extent_;
+    const int node_size_;
+    std::vector<item> items_;
+};
+
+#endif // PACKED_RTREE_HPP
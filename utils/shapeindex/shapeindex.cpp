@@ -26,6 +26,7 @@
 #include <string>
 #include <mapnik/util/fs.hpp>
 #include "quadtree.hpp"
+#include "packed_rtree.hpp"
 #include "shapefile.hpp"
 #include "shape_io.hpp"
 
@@ -39,6 +40,7 @@
 
 const int DEFAULT_DEPTH = 8;
 const double DEFAULT_RATIO=0.55;
+const int DEFAULT_NODE_SIZE = 16;
 
 int main (int argc,char** argv)
 {
@@ -52,6 +54,8 @@ int main (int argc,char** argv)
     bool verbose=false;
     unsigned int depth=DEFAULT_DEPTH;
     double ratio=DEFAULT_RATIO;
+    bool use_rtree=false;
+    int node_size=DEFAULT_NODE_SIZE;
     vector<string> shape_files;
 
     try
@@ -63,6 +67,8 @@ int main (int argc,char** argv)
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("rtree","write a packed Hilbert R-tree index (format v2) instead of a quadtree")
+            ("node-size,n",po::value<int>(),"R-tree node fan-out\n(default 16)")
             ("shape_files",po::value<vector<string> >(),"shape files to index: file1 file2 ...fileN")
             ;
 
@@ -95,6 +101,14 @@ int main (int argc,char** argv)
         {
             ratio = vm["ratio"].as<double>();
         }
+        if (vm.count("rtree"))
+        {
+            use_rtree = true;
+        }
+        if (vm.count("node-size"))
+        {
+            node_size = vm["node-size"].as<int>();
+        }
 
         if (vm.count("shape_files"))
         {
@@ -107,8 +121,15 @@ int main (int argc,char** argv)
         return -1;
     }
 
-    clog << "max tree depth:" << depth << endl;
-    clog << "split ratio:" << ratio << endl;
+    if (use_rtree)
+    {
+        clog << "packed rtree node size:" << node_size << endl;
+    }
+    else
+    {
+        clog << "max tree depth:" << depth << endl;
+        clog << "split ratio:" << ratio << endl;
+    }
 
     vector<string>::const_iterator itr = shape_files.begin();
     if (itr == shape_files.end())
@@ -155,6 +176,7 @@ int main (int argc,char** argv)
         int pos=50;
         shp.seek(pos*2);
         quadtree<int> tree(extent,depth,ratio);
+        packed_rtree<int> rtree(extent,node_size);
         int count=0;
         while (true) {
 
@@ -220,7 +242,14 @@ int main (int argc,char** argv)
                 shp.read_envelope(item_ext);
                 shp.skip(2*content_length-4*8-4);
             }
-            tree.insert(offset,item_ext);
+            if (use_rtree)
+            {
+                rtree.insert(offset,item_ext);
+            }
+            else
+            {
+                tree.insert(offset,item_ext);
+            }
             if (verbose)
             {
                 clog << "record number " << record_number << " box=" << item_ext << endl;
@@ -240,10 +269,18 @@ int main (int argc,char** argv)
             clog << "cannot open index file for writing file \""
                  << (shapename+".index") << "\"" << endl;
         } else {
-            tree.trim();
-            std::clog<<" number nodes="<<tree.count()<<std::endl;
             file.exceptions(std::ios::failbit | std::ios::badbit);
-            tree.write(file);
+            if (use_rtree)
+            {
+                std::clog<<" number nodes="<<rtree.count()<<std::endl;
+                rtree.write(file);
+            }
+            else
+            {
+                tree.trim();
+                std::clog<<" number nodes="<<tree.count()<<std::endl;
+                tree.write(file);
+            }
             file.flush();
             file.close();
         }